@@ -0,0 +1,165 @@
+#include "bench.h"
+#include "parallel.h"
+#include "sample.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+using namespace rlwe;
+using namespace rlwe::bench;
+
+bool Runner::IsSelected(const std::string & scheme, const std::string & params) const {
+  // A filter without a slash may name just an operation, so only Run can rule it out
+  std::string prefix = scheme + "/" + params + "/";
+  return options.filter.find('/') == std::string::npos || 
+    prefix.find(options.filter) != std::string::npos || 
+    options.filter.compare(0, prefix.size(), prefix) == 0;
+}
+
+void Runner::Run(const std::string & scheme, const std::string & params, const std::string & operation, 
+    const std::function<void()> & body) {
+  Run(scheme, params, operation, [] {}, body);
+}
+
+void Runner::Run(const std::string & scheme, const std::string & params, const std::string & operation, 
+    const std::function<void()> & setup, const std::function<void()> & body) {
+  std::string name = scheme + "/" + params + "/" + operation;
+  if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+    return;
+  }
+
+  setup();
+  body();
+
+  std::vector<double> times;
+  double total = 0;
+  for (size_t run = 0; run < options.runs; run++) {
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    double time = std::chrono::duration<double, std::nano>(end - start).count();
+    times.push_back(time);
+    total += time;
+  }
+  std::sort(times.begin(), times.end());
+
+  // The p99 is the smallest time that at least 99% of the calls stayed within
+  size_t p99_index = (size_t) ceil(BENCH_PERCENTILE * times.size()) - 1;
+  Result result = {scheme, params, operation, times.size(), 
+    times[times.size() / 2], times[p99_index], 1e9 * times.size() / total};
+  results.push_back(result);
+}
+
+void Runner::WriteTable(std::ostream & stream) const {
+  stream << std::left << std::setw(10) << "scheme" << std::setw(28) << "params" << std::setw(24) << "operation" << 
+    std::right << std::setw(14) << "median (ns)" << std::setw(14) << "p99 (ns)" << std::setw(14) << "ops/sec" << std::endl;
+  for (const Result & result : results) {
+    stream << std::left << std::setw(10) << result.scheme << std::setw(28) << result.params << std::setw(24) << result.operation << 
+      std::right << std::fixed << std::setprecision(0) << 
+      std::setw(14) << result.median_ns << std::setw(14) << result.p99_ns << 
+      std::setprecision(1) << std::setw(14) << result.ops_per_sec << std::endl;
+  }
+}
+
+void Runner::WriteJSON(std::ostream & stream) const {
+  // None of the names contain characters that would need escaping
+  stream << "{" << std::endl;
+  stream << "  \"threads\": " << ThreadPool::GetInstance().GetThreadCount() << "," << std::endl;
+  stream << "  \"runs\": " << options.runs << "," << std::endl;
+  stream << "  \"benchmarks\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result & result = results[i];
+    stream << std::fixed << std::setprecision(1) << 
+      "    {\"scheme\": \"" << result.scheme << 
+      "\", \"params\": \"" << result.params << 
+      "\", \"operation\": \"" << result.operation << 
+      "\", \"runs\": " << result.runs << 
+      ", \"median_ns\": " << result.median_ns << 
+      ", \"p99_ns\": " << result.p99_ns << 
+      ", \"ops_per_sec\": " << result.ops_per_sec << 
+      "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  stream << "  ]" << std::endl;
+  stream << "}" << std::endl;
+}
+
+static void PrintUsage(const char * program) {
+  std::cerr << "Usage: " << program << " [--runs N] [--filter TEXT] [--json FILE] [--trace FILE]" << std::endl;
+  std::cerr << "  --runs N       timed calls per operation (default " << BENCH_DEFAULT_RUN_COUNT << ")" << std::endl;
+  std::cerr << "  --filter TEXT  only run operations whose scheme/params/operation name contains TEXT" << std::endl;
+  std::cerr << "  --json FILE    also write the results as JSON to FILE (- for standard output)" << std::endl;
+  std::cerr << "  --trace FILE   write the library's stage traces as JSON to FILE (needs a build with RLWE_TRACE)" << std::endl;
+}
+
+int main(int argc, char ** argv) {
+  Options options = {BENCH_DEFAULT_RUN_COUNT, ""};
+  const char * json_path = NULL;
+  const char * trace_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      options.runs = strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options.filter = argv[++i];
+    }
+    else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    }
+    else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.runs == 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // A fixed seed keeps runs comparable
+  uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH] = {0};
+  RandomStream::GetInstance().SetSeed(seed);
+
+  Runner runner(options);
+  RunSamplerBenchmarks(runner);
+  RunFVBenchmarks(runner);
+  RunNewHopeBenchmarks(runner);
+  RunTESLABenchmarks(runner);
+
+  bool json_to_stdout = json_path && strcmp(json_path, "-") == 0;
+  runner.WriteTable(json_to_stdout ? std::cerr : std::cout);
+  if (json_to_stdout) {
+    runner.WriteJSON(std::cout);
+  }
+  else if (json_path) {
+    std::ofstream file(json_path);
+    if (!file) {
+      std::cerr << "Could not open " << json_path << std::endl;
+      return 1;
+    }
+    runner.WriteJSON(file);
+  }
+
+  if (trace_path) {
+    if (!trace::IsEnabled()) {
+      std::cerr << "The library was built without RLWE_TRACE, so there is no trace to write" << std::endl;
+      return 1;
+    }
+    std::ofstream file(trace_path);
+    if (!file) {
+      std::cerr << "Could not open " << trace_path << std::endl;
+      return 1;
+    }
+    trace::WriteJSON(file);
+  }
+  return 0;
+}
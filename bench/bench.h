@@ -0,0 +1,66 @@
+#ifndef RLWE_BENCH_H
+#define RLWE_BENCH_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define BENCH_DEFAULT_RUN_COUNT 101
+#define BENCH_PERCENTILE 0.99
+
+namespace rlwe {
+  namespace bench {
+    // Timing statistics of one operation, taken over the wall-clock times of its individual calls
+    struct Result {
+      std::string scheme;
+      std::string params;
+      std::string operation;
+      size_t runs;
+      double median_ns;
+      double p99_ns;
+      double ops_per_sec;
+    };
+
+    // Settings shared by every benchmark
+    struct Options {
+      size_t runs;
+      std::string filter;
+    };
+
+    // Times operations one call at a time and collects their results
+    class Runner {
+      private:
+        Options options;
+        std::vector<Result> results;
+      public:
+        /* Constructors */
+        Runner(const Options & options) : options(options) {}
+
+        /* Checks whether any benchmark of the scheme and parameter set can pass the filter, so that their setup can be skipped */
+        bool IsSelected(const std::string & scheme, const std::string & params) const;
+
+        /* Times the given number of runs of body, after one untimed warm-up call, unless the filter excludes it */
+        /* If given, setup is called before every call of body without being timed (e.g. to restore a mutated input) */
+        void Run(const std::string & scheme, const std::string & params, const std::string & operation, 
+            const std::function<void()> & body);
+        void Run(const std::string & scheme, const std::string & params, const std::string & operation, 
+            const std::function<void()> & setup, const std::function<void()> & body);
+
+        /* Getters */
+        const std::vector<Result> & GetResults() const { return results; }
+
+        /* Output, either as an aligned table or as JSON meant to be diffed between releases */
+        void WriteTable(std::ostream & stream) const;
+        void WriteJSON(std::ostream & stream) const;
+    };
+
+    // Benchmarks of each scheme, which live in their own translation units since their headers cannot be combined
+    void RunFVBenchmarks(Runner & runner);
+    void RunNewHopeBenchmarks(Runner & runner);
+    void RunTESLABenchmarks(Runner & runner);
+    void RunSamplerBenchmarks(Runner & runner);
+  }
+}
+
+#endif
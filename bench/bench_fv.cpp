@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "fv.h"
+#include "sample.h"
+
+using namespace rlwe;
+using namespace rlwe::fv;
+using namespace rlwe::bench;
+
+#define BENCH_RELINEARIZATION_LEVEL 2
+
+static void RunWithParameters(Runner & runner, const std::string & name, const KeyParameters & params) {
+  if (!runner.IsSelected("fv", name)) {
+    return;
+  }
+
+  // Keys and inputs shared by the operations
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+  EvaluationKey elk = GenerateEvaluationKey(priv, BENCH_RELINEARIZATION_LEVEL);
+  Plaintext ptx1(params);
+  ptx1.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Plaintext ptx2(params);
+  ptx2.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Ciphertext ctx1 = Encrypt(ptx1, pub);
+  Ciphertext ctx2 = Encrypt(ptx2, pub);
+  Ciphertext product = ctx1 * ctx2;
+
+  // Outputs, which are kept across calls so that they are already sized
+  PrivateKey priv_out(params);
+  PublicKey pub_out(params);
+  EvaluationKey elk_out(params);
+  Ciphertext ctx(params);
+  Plaintext ptx(params);
+
+  runner.Run("fv", name, "keygen_private", [&] {
+    GeneratePrivateKey(priv_out);
+  });
+  runner.Run("fv", name, "keygen_public", [&] {
+    GeneratePublicKey(pub_out, priv);
+  });
+  runner.Run("fv", name, "keygen_evaluation", [&] {
+    GenerateEvaluationKey(elk_out, priv, BENCH_RELINEARIZATION_LEVEL);
+  });
+  runner.Run("fv", name, "encrypt", [&] {
+    Encrypt(ctx, ptx1, pub);
+  });
+  runner.Run("fv", name, "decrypt", [&] {
+    Decrypt(ptx, ctx1, priv);
+  });
+
+  // The in-place operations start over from a copy of their input, which is not timed
+  runner.Run("fv", name, "add", [&] {
+    ctx = ctx1;
+  }, [&] {
+    ctx += ctx2;
+  });
+  runner.Run("fv", name, "multiply", [&] {
+    ctx = ctx1;
+  }, [&] {
+    ctx *= ctx2;
+  });
+  runner.Run("fv", name, "relinearize", [&] {
+    ctx = product;
+  }, [&] {
+    ctx.Relinearize(elk);
+  });
+}
+
+void bench::RunFVBenchmarks(Runner & runner) {
+  // The library's defaults, and the smaller parameters that the tests use for homomorphic multiplication
+  KeyParameters default_params;
+  RunWithParameters(runner, "default", default_params);
+  KeyParameters test_params(1024, ZZ(1152921504606830600ULL), ZZ(7));
+  RunWithParameters(runner, "test", test_params);
+}
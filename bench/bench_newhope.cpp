@@ -0,0 +1,40 @@
+#include "bench.h"
+#include "newhope.h"
+
+#include <vector>
+
+using namespace rlwe;
+using namespace rlwe::newhope;
+using namespace rlwe::bench;
+
+void bench::RunNewHopeBenchmarks(Runner & runner) {
+  if (!runner.IsSelected("newhope", "default")) {
+    return;
+  }
+
+  KeyParameters params;
+  Server server = CreateServer(params);
+  Client client = CreateClient(params);
+  std::vector<uint8_t> clientbound(params.GetServerPacketLength());
+  std::vector<uint8_t> serverbound(params.GetClientPacketLength());
+  WritePacket(clientbound.data(), server);
+  ReadPacket(client, clientbound.data());
+  WritePacket(serverbound.data(), client);
+
+  // The four steps of a key exchange, each over caller-provided buffers
+  runner.Run("newhope", "default", "server_init", [&] {
+    Initialize(server);
+  });
+  runner.Run("newhope", "default", "server_write", [&] {
+    WritePacket(clientbound.data(), server);
+  });
+  runner.Run("newhope", "default", "client_read", [&] {
+    ReadPacket(client, clientbound.data());
+  });
+  runner.Run("newhope", "default", "client_write", [&] {
+    WritePacket(serverbound.data(), client);
+  });
+  runner.Run("newhope", "default", "server_read", [&] {
+    ReadPacket(server, serverbound.data());
+  });
+}
@@ -0,0 +1,50 @@
+#include "bench.h"
+#include "sample.h"
+
+#include <sstream>
+#include <vector>
+
+#define BENCH_SAMPLE_COUNT 1024
+
+using namespace rlwe;
+using namespace rlwe::bench;
+
+// The default standard deviation of each scheme (their headers cannot share a translation unit)
+struct Scheme {
+  const char * name;
+  float sigma;
+};
+
+static const Scheme schemes[] = {
+  {"fv", 3.192f},
+  {"newhope", 2.828f},
+  {"tesla", 52.0f}
+};
+
+void bench::RunSamplerBenchmarks(Runner & runner) {
+  const GaussianSamplerType types[] = {KNUTH_YAO_SAMPLER, CDT_SAMPLER, BINOMIAL_SAMPLER};
+  const char * type_names[] = {"knuth-yao", "cdt", "binomial"};
+
+  // Each call fills a polynomial's worth of coefficients
+  std::vector<int32_t> values(BENCH_SAMPLE_COUNT);
+  for (const Scheme & scheme : schemes) {
+    std::stringstream params;
+    params << "sigma=" << scheme.sigma;
+    if (!runner.IsSelected("sampler", params.str())) {
+      continue;
+    }
+
+    for (size_t i = 0; i < 3; i++) {
+      GaussianSampler * sampler = GaussianSampler::Create(types[i], scheme.sigma);
+      runner.Run("sampler", params.str(), type_names[i], [&] {
+        sampler->Sample(values.data(), values.size());
+      });
+      delete sampler;
+    }
+
+    runner.Run("sampler", params.str(), "uniform", [&] {
+      Poly<uint32_t> poly;
+      UniformSample(poly, BENCH_SAMPLE_COUNT, (uint32_t) 12289);
+    });
+  }
+}
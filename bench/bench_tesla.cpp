@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "tesla.h"
+
+using namespace rlwe;
+using namespace rlwe::tesla;
+using namespace rlwe::bench;
+
+void bench::RunTESLABenchmarks(Runner & runner) {
+  if (!runner.IsSelected("tesla", "default")) {
+    return;
+  }
+
+  KeyParameters params;
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+  std::string message = "The quick brown fox jumps over the lazy dog.";
+  Signature sig = Sign(message, signer);
+
+  // Outputs, which are kept across calls so that they are already sized
+  SigningKey signer_out(params);
+  VerificationKey verif_out(params);
+  Signature sig_out(params);
+
+  runner.Run("tesla", "default", "keygen_signing", [&] {
+    GenerateSigningKey(signer_out);
+  });
+  runner.Run("tesla", "default", "keygen_verification", [&] {
+    GenerateVerificationKey(verif_out, signer);
+  });
+
+  // Signing repeats until an attempt passes the rejection conditions, so its p99 sits well above its median
+  runner.Run("tesla", "default", "sign", [&] {
+    Sign(sig_out, message, signer);
+  });
+  runner.Run("tesla", "default", "verify", [&] {
+    Verify(message, sig, verif);
+  });
+}
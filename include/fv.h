@@ -2,9 +2,16 @@
 #include <NTL/ZZX.h>
 #include <NTL/pair.h>
 
+#include "ring.h"
+#include "sample.h"
+
+#include <utility>
+#include <vector>
+
 #define DEFAULT_POLY_MODULUS_DEGREE 1024
 #define DEFAULT_COEFF_MODULUS 40961
 #define DEFAULT_PLAINTEXT_MODULUS 7
+#define DEFAULT_GAUSSIAN_SAMPLER CDT_SAMPLER
 #define DEFAULT_ERROR_STANDARD_DEVIATION 3.192f
 #define DEFAULT_DECOMPOSITION_BIT_COUNT 32
 
@@ -51,10 +58,18 @@ namespace rlwe {
     void Encrypt(Ciphertext & ctx, const Plaintext & ptx, const PublicKey & pub);
     void Decrypt(Plaintext & ptx, const Ciphertext & ctx, const PrivateKey & priv);
 
+    /* Batched encryption of many plaintexts under one public key, spread across the library's thread pool */
+    void EncryptBatch(Ciphertext * ctxs, const Plaintext * ptxs, size_t count, const PublicKey & pub);
+
     /* Object-oriented variants */
     Ciphertext Encrypt(const Plaintext & ptx, const PublicKey & pub);
+    std::vector<Ciphertext> EncryptBatch(const std::vector<Plaintext> & ptxs, const PublicKey & pub);
     Plaintext Decrypt(const Ciphertext & ctx, const PrivateKey & priv);
 
+    /* Homomorphic arithmetic into an existing ciphertext, whose polynomials are reused; out may be either operand */
+    void Add(Ciphertext & out, const Ciphertext & a, const Ciphertext & b);
+    void Multiply(Ciphertext & out, const Ciphertext & a, const Ciphertext & b);
+
     class KeyParameters {
       private:
         /* Given parameters */ 
@@ -64,26 +79,24 @@ namespace rlwe {
         uint32_t log_w;
         float sigma;
         /* Calculated */
-        ZZ_pXModulus phi;
+        RingContext<uint64_t> ring;
         ZZ delta;
         ZZ w;
         ZZ w_mask;
         uint32_t l;
-        uint8_t ** pmat;
-        size_t pmat_rows; 
+        GaussianSampler * sampler;
       public:
         /* Constructors */
+        /* Ciphertext coefficients are 64-bit words, so q must be below 2^63 (std::invalid_argument is thrown otherwise) */
         KeyParameters();
         KeyParameters(size_t n, uint32_t q, uint32_t t);
         KeyParameters(size_t n, const ZZ & q, const ZZ & t);
         KeyParameters(size_t n, const ZZ & q, const ZZ & t, uint32_t log_w, float sigma);
+        KeyParameters(size_t n, const ZZ & q, const ZZ & t, uint32_t log_w, float sigma, GaussianSamplerType sampler_type);
         
         /* Destructors */
         ~KeyParameters() {
-          for (size_t i = 0; i < pmat_rows; i++) {
-            free(pmat[i]);
-          }
-          free(pmat);
+          delete sampler;
         }
 
         /* Getters */
@@ -91,14 +104,14 @@ namespace rlwe {
         const ZZ & GetPlainModulus() const { return t; }
         const ZZ & GetPlainToCoeffScalar() const { return delta; }
         size_t GetPolyModulusDegree() const { return n; }
-        const ZZ_pXModulus & GetPolyModulus() const { return phi; }
+        const ZZX & GetPolyModulus() const { return ring.GetPolyModulus(); }
+        const RingContext<uint64_t> & GetRing() const { return ring; }
         float GetErrorStandardDeviation() const { return sigma; }
         const ZZ & GetDecompositionBase() const { return w; }
         const ZZ & GetDecompositionBitMask() const { return w_mask; }
         uint32_t GetDecompositionBitCount() const { return log_w; }
         uint32_t GetDecompositionTermCount() const { return l; }
-        uint8_t ** GetProbabilityMatrix() const { return pmat; }
-        size_t GetProbabilityMatrixRows() const { return pmat_rows; }
+        const GaussianSampler & GetGaussianSampler() const { return *sampler; }
 
         /* Equality */
         bool operator== (const KeyParameters & kp) const {
@@ -113,14 +126,14 @@ namespace rlwe {
 
     class PrivateKey {
       private:
-        ZZX s;
+        Poly<uint64_t> s;
         const KeyParameters & params;
       public:
         /* Constructors */
         PrivateKey(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const ZZX & GetSecret() const { 
+        /* Getters (the secret is kept in the evaluation domain whenever the ring has one) */
+        const Poly<uint64_t> & GetSecret() const { 
           return s; 
         }
         const KeyParameters & GetParameters() const { 
@@ -128,7 +141,7 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetSecret(const ZZX & secret) {
+        void SetSecret(const Poly<uint64_t> & secret) {
           this->s = secret;
         }
 
@@ -140,14 +153,14 @@ namespace rlwe {
 
     class PublicKey {
       private:
-        Pair<ZZX, ZZX> p;
+        Pair<Poly<uint64_t>, Poly<uint64_t>> p;
         const KeyParameters & params;
       public:
         /* Constructors */
         PublicKey(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const Pair<ZZX, ZZX> & GetValues() const {
+        /* Getters (both polynomials are kept in the evaluation domain whenever the ring has one) */
+        const Pair<Poly<uint64_t>, Poly<uint64_t>> & GetValues() const {
           return p;
         }
         const KeyParameters & GetParameters() const { 
@@ -155,7 +168,7 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetValues(const ZZX & p0, const ZZX & p1) {
+        void SetValues(const Poly<uint64_t> & p0, const Poly<uint64_t> & p1) {
           this->p.a = p0;
           this->p.b = p1;
         }
@@ -168,15 +181,15 @@ namespace rlwe {
 
     class EvaluationKey {
       private:
-        Vec<Pair<ZZX, ZZX>> r;
+        Vec<Pair<Poly<uint64_t>, Poly<uint64_t>>> r;
         unsigned long level;
         const KeyParameters & params;
       public:
         /* Constructors */
         EvaluationKey(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const Pair<ZZX, ZZX> & operator[] (int index) const {
+        /* Getters (all polynomials are kept in the evaluation domain whenever the ring has one) */
+        const Pair<Poly<uint64_t>, Poly<uint64_t>> & operator[] (int index) const {
           return r[index]; 
         }
         size_t GetLength() const { 
@@ -190,7 +203,7 @@ namespace rlwe {
         }
 
         /* Setters */
-        Pair<ZZX, ZZX> & operator[] (int index) {
+        Pair<Poly<uint64_t>, Poly<uint64_t>> & operator[] (int index) {
           return r[index]; 
         }
         void SetLevel(unsigned long level) {
@@ -241,32 +254,52 @@ namespace rlwe {
 
     class Ciphertext {
       private:
-        Vec<ZZX> c;
-        const KeyParameters & params;
+        Vec<Poly<uint64_t>> c;
+        /* Held by pointer so that ciphertexts can be assigned; the parameters must outlive the ciphertext */
+        const KeyParameters * params;
       public:
         /* Constructors */
-        Ciphertext(const KeyParameters & params) : params(params) {}
+        Ciphertext(const KeyParameters & params) : params(&params) {}
         Ciphertext(const Ciphertext & ct) : c(ct.c), params(ct.params) {}
+        Ciphertext(Ciphertext && ct) : params(ct.params) {
+          c.swap(ct.c);
+        }
+
+        /* Assignment (copies reuse the polynomials this ciphertext already has, while moves take over the other's) */
+        Ciphertext & operator= (const Ciphertext & ct) {
+          c = ct.c;
+          params = ct.params;
+          return *this;
+        }
+        Ciphertext & operator= (Ciphertext && ct) {
+          c.swap(ct.c);
+          params = ct.params;
+          return *this;
+        }
 
         /* Getters */
-        const ZZX & operator[] (int index) const {
+        const Poly<uint64_t> & operator[] (int index) const {
           return c[index]; 
         }
         size_t GetLength() const { 
           return c.length(); 
         }
         const KeyParameters & GetParameters() const { 
-          return params; 
+          return *params; 
         }
 
         /* Setters */
-        ZZX & operator[] (int index) {
+        Poly<uint64_t> & operator[] (int index) {
           return c[index];
         }
         void SetLength(size_t len) {
           this->c.SetLength(len);
         }
 
+        /* Ternary forms, which the operators below are built on */
+        friend void Add(Ciphertext & out, const Ciphertext & a, const Ciphertext & b);
+        friend void Multiply(Ciphertext & out, const Ciphertext & a, const Ciphertext & b);
+
         /* Somewhat homomorphic encryption */
         Ciphertext & Negate();
         Ciphertext & operator+= (const Ciphertext & ct);
@@ -274,25 +307,54 @@ namespace rlwe {
         Ciphertext & Relinearize(const EvaluationKey & elk);
 
         /* Arithmetic overloading */
+        /* Temporaries are worked on in place, so that chained expressions only allocate for their first result */
         friend Ciphertext operator- (const Ciphertext & ct) {
           Ciphertext result(ct);
           result.Negate();
           return result;
         }
+        friend Ciphertext operator- (Ciphertext && ct) {
+          ct.Negate();
+          return std::move(ct);
+        }
         friend Ciphertext operator+ (const Ciphertext & ct1, const Ciphertext & ct2) {
-          Ciphertext result(ct1); 
-          result += ct2;
+          Ciphertext result(*ct1.params); 
+          Add(result, ct1, ct2);
           return result;
         }
+        friend Ciphertext operator+ (Ciphertext && ct1, const Ciphertext & ct2) {
+          ct1 += ct2;
+          return std::move(ct1);
+        }
+        friend Ciphertext operator+ (const Ciphertext & ct1, Ciphertext && ct2) {
+          Add(ct2, ct1, ct2);
+          return std::move(ct2);
+        }
+        friend Ciphertext operator+ (Ciphertext && ct1, Ciphertext && ct2) {
+          ct1 += ct2;
+          return std::move(ct1);
+        }
         friend Ciphertext operator* (const Ciphertext & ct1, const Ciphertext & ct2) {
-          Ciphertext result(ct1);
-          result *= ct2;
+          Ciphertext result(*ct1.params);
+          Multiply(result, ct1, ct2);
           return result;
         }
+        friend Ciphertext operator* (Ciphertext && ct1, const Ciphertext & ct2) {
+          ct1 *= ct2;
+          return std::move(ct1);
+        }
+        friend Ciphertext operator* (const Ciphertext & ct1, Ciphertext && ct2) {
+          Multiply(ct2, ct1, ct2);
+          return std::move(ct2);
+        }
+        friend Ciphertext operator* (Ciphertext && ct1, Ciphertext && ct2) {
+          ct1 *= ct2;
+          return std::move(ct1);
+        }
 
         /* Equality */
         bool operator== (const Ciphertext & ct) const {
-          if (c.length() != ct.c.length() || !(params == ct.params)) {
+          if (c.length() != ct.c.length() || !(*params == *ct.params)) {
             return false;
           }
 
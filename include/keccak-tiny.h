@@ -21,6 +21,31 @@ decsha3(256)
 decsha3(384)
 decsha3(512)
 
+/*** The Keccak-f[1600] permutation on a single state ***/
+void keccakf1600(uint64_t state[25]);
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+/*** The permutation on four states at once, where word i of state k is states[4 * i + k] (requires AVX2) ***/
+void keccakf1600x4_avx2(uint64_t states[100]);
+#endif
+
+/*** Incremental SHAKE: absorb any number of times, then squeeze any number of times ***/
+#define SHAKE128_RATE 168
+#define SHAKE256_RATE 136
+
+typedef struct {
+  uint64_t a[25];
+  size_t rate;
+  size_t pos;
+  int squeezing;
+} keccak_state;
+
+void shake128_init(keccak_state* state);
+void shake256_init(keccak_state* state);
+void shake_absorb(keccak_state* state, const uint8_t* in, size_t inlen);
+void shake_squeeze(keccak_state* state, uint8_t* out, size_t outlen);
+void shake_squeezeblocks(keccak_state* state, uint8_t* out, size_t nblocks);
+
 #ifdef __cplusplus
 }
 #endif
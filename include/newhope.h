@@ -2,18 +2,32 @@
 #include <NTL/ZZX.h>
 #include <NTL/pair.h>
 
+#include "ring.h"
+#include "sample.h"
+
+#include <array>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
 #define DEFAULT_POLY_MODULUS_DEGREE 1024
 #define DEFAULT_COEFF_MODULUS 12289
+#define DEFAULT_COEFF_MODULUS_BIT_LENGTH 14
+#define DEFAULT_GAUSSIAN_SAMPLER BINOMIAL_SAMPLER // psi_16, as in the reference implementation
 #define DEFAULT_ERROR_STANDARD_DEVIATION 2.828f
 
 #define SEED_BYTE_LENGTH 32
 #define SHARED_KEY_BYTE_LENGTH 32
+#define DEFAULT_SEED_CACHE_CAPACITY 0
+#define CIPHERTEXT_COEFF_BIT_LENGTH 3 // NHSCompress keeps 3 bits of each ciphertext coefficient
 
 using namespace NTL;
 
 namespace rlwe {
   namespace newhope {
     class KeyParameters;
+    class SeedCache;
     class Server;
     class Client;
     class Packet;
@@ -36,6 +50,32 @@ namespace rlwe {
     Packet CreatePacket(const Server & server);
     Packet CreatePacket(const Client & client);
 
+    /* Batched decoding of many client packets answering one server ephemeral, spread across the library's thread pool */
+    /* The i-th shared key is written to shared_keys + i * SHARED_KEY_BYTE_LENGTH; the server itself is left unchanged */
+    void ReadPacketBatch(uint8_t * shared_keys, const Server & server, const uint8_t * const * inputs, size_t count);
+    void ReadPacketBatch(uint8_t * shared_keys, const Server & server, const Packet * packets, size_t count);
+
+    /* Object-oriented variant */
+    typedef std::array<uint8_t, SHARED_KEY_BYTE_LENGTH> SharedKey;
+    std::vector<SharedKey> ReadPacketBatch(const Server & server, const std::vector<Packet> & packets);
+
+    /* Variants on caller-provided buffers of GetServerPacketLength() or GetClientPacketLength() bytes, returning the bytes written */
+    size_t WritePacket(uint8_t * output, const Server & server);
+    void ReadPacket(Client & client, const uint8_t * input);
+    size_t WritePacket(uint8_t * output, const Client & client);
+    void ReadPacket(Server & server, const uint8_t * input);
+
+    /* Packet lengths in bytes, known at compile time for a given degree and coefficient modulus bit length */
+    constexpr size_t PackedPolyLength(size_t n, size_t coeff_bit_length) {
+      return (n * coeff_bit_length + 8 - 1) / 8;
+    }
+    constexpr size_t ServerPacketLength(size_t n, size_t q_bit_length) {
+      return SEED_BYTE_LENGTH + PackedPolyLength(n, q_bit_length);
+    }
+    constexpr size_t ClientPacketLength(size_t n, size_t q_bit_length) {
+      return PackedPolyLength(n, q_bit_length) + PackedPolyLength(n, CIPHERTEXT_COEFF_BIT_LENGTH);
+    }
+
     /* Util functions */
     void Parse(ZZX & a, size_t len, const ZZ & q, const uint8_t seed[SEED_BYTE_LENGTH]);
     size_t CompressPoly(uint8_t * output, size_t coeff_bit_length, const ZZX & poly);
@@ -45,6 +85,60 @@ namespace rlwe {
     void NHSCompress(ZZX & cc, const ZZX & c, const ZZ & q);
     void NHSDecompress(ZZX & c, const ZZX & cc, const ZZ & q);
 
+    /* Word-based variants */
+    void Parse(Poly<uint32_t> & a, size_t len, uint32_t q, const uint8_t seed[SEED_BYTE_LENGTH]);
+
+    /* Parses count seeds (stored back to back) at once, running four SHAKE-128 instances side by side */
+    void ParseBatch(Poly<uint32_t> * as, const uint8_t * seeds, size_t count, size_t len, uint32_t q);
+
+    /* Parses a seed into the public polynomial a in the evaluation domain, going through the parameters' seed cache */
+    void ExpandSeed(Poly<uint32_t> & a, const KeyParameters & params, const uint8_t seed[SEED_BYTE_LENGTH]);
+
+    /* Same, without consulting or filling the cache, for seeds that won't be seen again (e.g. a server's fresh seed) */
+    void ExpandSeedUncached(Poly<uint32_t> & a, const KeyParameters & params, const uint8_t seed[SEED_BYTE_LENGTH]);
+
+    // Bounded, thread-safe LRU cache of expanded public polynomials, keyed by the seed they were parsed from
+    class SeedCache {
+      private:
+        typedef std::array<uint8_t, SEED_BYTE_LENGTH> Seed;
+        typedef std::list<std::pair<Seed, Poly<uint32_t>>> EntryList;
+        size_t capacity;
+        EntryList entries;
+        std::map<Seed, EntryList::iterator> index;
+        size_t hits;
+        size_t misses;
+        std::mutex mutex;
+      public:
+        /* Constructors (a capacity of 0 disables the cache) */
+        SeedCache(size_t capacity) : capacity(capacity), hits(0), misses(0) {}
+
+        /* Copies the polynomial cached for the seed into a, marking it as most recently used; returns false on a miss */
+        /* (or right away, without counting a miss, if the cache is disabled) */
+        bool Lookup(Poly<uint32_t> & a, const uint8_t seed[SEED_BYTE_LENGTH]);
+
+        /* Caches the polynomial for the seed, evicting the least recently used entry if the cache is full */
+        void Insert(const uint8_t seed[SEED_BYTE_LENGTH], const Poly<uint32_t> & a);
+
+        /* Changes the capacity, evicting entries as needed */
+        void SetCapacity(size_t capacity);
+
+        /* Drops every entry */
+        void Clear();
+
+        /* Getters */
+        size_t GetCapacity();
+        size_t GetSize();
+        size_t GetHitCount();
+        size_t GetMissCount();
+    };
+
+    size_t CompressPoly(uint8_t * output, size_t coeff_bit_length, const Poly<uint32_t> & poly);
+    size_t DecompressPoly(Poly<uint32_t> & poly, size_t polylen, const uint8_t * output, size_t coeff_bit_length);
+    void NHSEncode(Poly<uint32_t> & k, const uint8_t v[SHARED_KEY_BYTE_LENGTH], uint32_t q);
+    void NHSDecode(uint8_t v[SHARED_KEY_BYTE_LENGTH], const Poly<uint32_t> & k, uint32_t q);
+    void NHSCompress(Poly<uint32_t> & cc, const Poly<uint32_t> & c, uint32_t q);
+    void NHSDecompress(Poly<uint32_t> & c, const Poly<uint32_t> & cc, uint32_t q);
+
     class KeyParameters {
       private:
         /* Given parameters */ 
@@ -52,30 +146,35 @@ namespace rlwe {
         ZZ q;
         float sigma;
         /* Calculated */
-        ZZ_pXModulus phi;
-        uint8_t ** pmat;
-        size_t pmat_rows; 
+        size_t q_bit_length;
+        RingContext<uint32_t> ring;
+        GaussianSampler * sampler;
+        mutable SeedCache seed_cache;
       public:
         /* Constructors */
         KeyParameters();
         KeyParameters(size_t n, const ZZ & q); 
         KeyParameters(size_t n, const ZZ & q, float sigma);
+        KeyParameters(size_t n, const ZZ & q, float sigma, GaussianSamplerType sampler_type);
         
         /* Destructors */
         ~KeyParameters() {
-          for (size_t i = 0; i < pmat_rows; i++) {
-            free(pmat[i]);
-          }
-          free(pmat);
+          delete sampler;
         }
 
         /* Getters */
         const ZZ & GetCoeffModulus() const { return q; }
         size_t GetPolyModulusDegree() const { return n; }
-        const ZZ_pXModulus & GetPolyModulus() const { return phi; }
+        const ZZX & GetPolyModulus() const { return ring.GetPolyModulus(); }
+        const RingContext<uint32_t> & GetRing() const { return ring; }
         float GetErrorStandardDeviation() const { return sigma; }
-        uint8_t ** GetProbabilityMatrix() const { return pmat; }
-        size_t GetProbabilityMatrixRows() const { return pmat_rows; }
+        const GaussianSampler & GetGaussianSampler() const { return *sampler; }
+        size_t GetCoeffModulusBitLength() const { return q_bit_length; }
+        size_t GetServerPacketLength() const { return ServerPacketLength(n, q_bit_length); }
+        size_t GetClientPacketLength() const { return ClientPacketLength(n, q_bit_length); }
+
+        /* Cache of expanded seeds, which is disabled until it is given a capacity */
+        SeedCache & GetSeedCache() const { return seed_cache; }
 
         /* Display to output stream */
         friend std::ostream& operator<< (std::ostream& stream, const KeyParameters& params) {
@@ -90,8 +189,8 @@ namespace rlwe {
 
     class Server {
       private:
-        ZZX s;
-        ZZX b;
+        Poly<uint32_t> s;
+        Poly<uint32_t> b;
         uint8_t seed[SEED_BYTE_LENGTH];
         uint8_t shared[SHARED_KEY_BYTE_LENGTH];
         const KeyParameters & params;
@@ -99,11 +198,11 @@ namespace rlwe {
         /* Constructors */
         Server(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const ZZX & GetSecretKey() const {
+        /* Getters (the secret key is kept in the evaluation domain) */
+        const Poly<uint32_t> & GetSecretKey() const {
           return s;
         }
-        const ZZX & GetPublicKey() const {
+        const Poly<uint32_t> & GetPublicKey() const {
           return b;
         }
         const uint8_t * GetSeed() const {
@@ -117,10 +216,10 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetSecretKey(const ZZX & s) {
+        void SetSecretKey(const Poly<uint32_t> & s) {
           this->s = s;
         }
-        void SetPublicKey(const ZZX & b) {
+        void SetPublicKey(const Poly<uint32_t> & b) {
           this->b = b;
         }
         void SetSeed(const uint8_t seed[SEED_BYTE_LENGTH]) {
@@ -142,27 +241,27 @@ namespace rlwe {
 
     class Client {
       private:
-        ZZX s;
-        ZZX u;
-        ZZX c;
-        Pair<ZZX, ZZX> e;
+        Poly<uint32_t> s;
+        Poly<uint32_t> u;
+        Poly<uint32_t> c;
+        Pair<Poly<uint32_t>, Poly<uint32_t>> e;
         uint8_t shared[SHARED_KEY_BYTE_LENGTH];
         const KeyParameters & params;
       public:
         /* Constructors */
         Client(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const ZZX & GetSecretKey() const {
+        /* Getters (the secret key is kept in the evaluation domain) */
+        const Poly<uint32_t> & GetSecretKey() const {
           return s;
         }
-        const ZZX & GetPublicKey() const {
+        const Poly<uint32_t> & GetPublicKey() const {
           return u;
         }
-        const ZZX & GetCiphertext() const {
+        const Poly<uint32_t> & GetCiphertext() const {
           return c;
         }
-        const Pair<ZZX, ZZX> & GetErrors() const {
+        const Pair<Poly<uint32_t>, Poly<uint32_t>> & GetErrors() const {
           return e;
         }
         const uint8_t * GetSharedKey() const {
@@ -173,16 +272,16 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetSecretKey(const ZZX & s) {
+        void SetSecretKey(const Poly<uint32_t> & s) {
           this->s = s;
         }
-        void SetPublicKey(const ZZX & u) {
+        void SetPublicKey(const Poly<uint32_t> & u) {
           this->u = u;
         }
-        void SetCiphertext(const ZZX & c) {
+        void SetCiphertext(const Poly<uint32_t> & c) {
           this->c = c;
         }
-        void SetErrors(const ZZX & e1, const ZZX & e2) {
+        void SetErrors(const Poly<uint32_t> & e1, const Poly<uint32_t> & e2) {
           this->e.a = e1;
           this->e.b = e2;
         }
@@ -200,19 +299,34 @@ namespace rlwe {
         }
     };
 
-    /* Repesents a fixed, heap-allocated array of bytes */
+    /* Repesents a fixed array of bytes, either heap-allocated or borrowed from the caller (e.g. an I/O buffer) */
     /* Unlike other classes here, the array is directly modifiable */
     class Packet {
       private:
         uint8_t * bytes;
         size_t len;
+        bool owned;
       public:
-        Packet(size_t len) : len(len) {
-          bytes = (uint8_t *) malloc(len);
+        /* Owned packets take their bytes from the calling thread's pool */
+        Packet(size_t len) : len(len), owned(true) {
+          bytes = (uint8_t *) pool::Allocate(len);
         }
 
+        /* Wraps a buffer of at least len bytes without copying it; the buffer must outlive the packet */
+        Packet(uint8_t * bytes, size_t len) : bytes(bytes), len(len), owned(false) {}
+
+        Packet(Packet && packet) noexcept : bytes(packet.bytes), len(packet.len), owned(packet.owned) {
+          packet.bytes = nullptr;
+          packet.owned = false;
+        }
+
+        Packet(const Packet & packet) = delete;
+        Packet & operator= (const Packet & packet) = delete;
+
         ~Packet() {
-          free(bytes);
+          if (owned) {
+            pool::Release(bytes, len);
+          }
         }
 
         size_t GetLength() const {
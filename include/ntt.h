@@ -0,0 +1,106 @@
+#ifndef RLWE_NTT_H
+#define RLWE_NTT_H
+
+#include <NTL/ZZ.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace NTL;
+
+namespace rlwe {
+  // Double-width integer type that can hold the product of two coefficients
+  template <typename T> struct WideWord;
+  template <> struct WideWord<uint32_t> { typedef uint64_t Type; };
+  template <> struct WideWord<uint64_t> { typedef unsigned __int128 Type; };
+
+  // Computes (a + b) mod q, where a and b are already reduced modulo q
+  template <typename T>
+  inline T ModAdd(T a, T b, T q) {
+    T c = a + b;
+    return c >= q ? c - q : c;
+  }
+
+  // Computes (a - b) mod q, where a and b are already reduced modulo q
+  template <typename T>
+  inline T ModSub(T a, T b, T q) {
+    return a >= b ? a - b : a + (q - b);
+  }
+
+  // Computes (a * b) mod q using a double-width product
+  template <typename T>
+  inline T ModMul(T a, T b, T q) {
+    return (T) (((typename WideWord<T>::Type) a * b) % q);
+  }
+
+  // Precomputes floor(b * 2^w / q) so that multiplications by the constant b avoid a division (Shoup's trick)
+  template <typename T>
+  inline T ModMulPrecompute(T b, T q) {
+    return (T) (((typename WideWord<T>::Type) b << (8 * sizeof(T))) / q);
+  }
+
+  // Computes (a * b) mod q given the precomputed constant for b
+  template <typename T>
+  inline T ModMulShoup(T a, T b, T b_precomp, T q) {
+    T estimate = (T) (((typename WideWord<T>::Type) a * b_precomp) >> (8 * sizeof(T)));
+    T r = a * b - estimate * q;
+    return r >= q ? r - q : r;
+  }
+
+  // Computes base^exponent mod q by repeated squaring
+  template <typename T>
+  T ModPow(T base, uint64_t exponent, T q);
+
+  // Computes the inverse of a modulo a prime q
+  template <typename T>
+  T ModInv(T a, T q);
+
+  // Deterministic Miller-Rabin test, valid for any word
+  template <typename T>
+  bool IsPrime(T q);
+
+  // Negacyclic number-theoretic transform over Z_q[x]/(x^n + 1)
+  // Requires n to be a power of 2 and q to be a prime with q = 1 mod 2n
+  template <typename T>
+  class NTT {
+    private:
+      size_t n;
+      T q;
+      /* Calculated */
+      T n_inv;
+      T n_inv_precomp;
+      T * roots;
+      T * roots_precomp;
+      T * inv_roots;
+      T * inv_roots_precomp;
+    public:
+      /* Constructors */
+      NTT(size_t n, T q);
+
+      /* Destructors */
+      ~NTT();
+
+      /* Tables are owned by the transform and are never shared */
+      NTT(const NTT & ntt) = delete;
+      NTT & operator= (const NTT & ntt) = delete;
+
+      /* Getters */
+      size_t GetLength() const { return n; }
+      T GetModulus() const { return q; }
+
+      /* Transforms (performed in-place on n coefficients reduced modulo q) */
+      void Forward(T * values) const;
+      void Inverse(T * values) const;
+
+      /* Multiplication in the evaluation domain */
+      void PointwiseMultiply(T * result, const T * a, const T * b) const;
+
+      /* Multiplication in the coefficient domain; result may alias either input */
+      void Multiply(T * result, const T * a, const T * b) const;
+
+      /* Checks if the ring Z_q[x]/(x^n + 1) admits a negacyclic transform with this word size */
+      static bool IsSupported(size_t n, T q);
+  };
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef RLWE_PARALLEL_H
+#define RLWE_PARALLEL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rlwe {
+  // Fixed set of worker threads that split up the iterations of independent loops
+  // The calling thread always works alongside the pool, and loops started from inside a worker simply run inline
+  // Loops started from several outside threads at once share the workers, which take their chunks in order of arrival
+  class ThreadPool {
+    private:
+      /* One call to ParallelFor, split into chunk_count contiguous chunks; it lives on the calling thread's stack */
+      struct Loop {
+        const std::function<void(size_t, size_t)> * body;
+        size_t count;
+        size_t chunk_count;
+        size_t next_chunk;
+        size_t remaining_chunks;
+        std::exception_ptr error;
+      };
+
+      std::vector<std::thread> workers;
+      /* Guards everything below, as well as every queued loop */
+      std::mutex mutex;
+      std::condition_variable task_ready;
+      std::condition_variable task_done;
+      /* Loops that still have chunks left to claim, oldest first */
+      std::deque<Loop *> loops;
+      bool stopping;
+
+      void Work();
+      void RunChunks(Loop & loop, std::unique_lock<std::mutex> & lock);
+      void RunLoop(size_t count, size_t chunks, const std::function<void(size_t, size_t)> & body);
+    public:
+      /* Constructors */
+      explicit ThreadPool(size_t thread_count);
+
+      /* Destructors */
+      ~ThreadPool();
+
+      /* Threads are owned by the pool and are never shared */
+      ThreadPool(const ThreadPool & pool) = delete;
+      ThreadPool & operator= (const ThreadPool & pool) = delete;
+
+      /* Getters */
+      size_t GetThreadCount() const { return workers.size() + 1; }
+
+      /* Calls body(begin, end) over disjoint ranges covering [0, count) and waits for all of them to finish */
+      /* If any call throws, the first exception is rethrown on the calling thread once every range has finished */
+      void ParallelFor(size_t count, const std::function<void(size_t, size_t)> & body);
+
+      /* Same, but in chunks of at most grain_size iterations that threads claim as they free up, balancing uneven iterations */
+      void ParallelFor(size_t count, size_t grain_size, const std::function<void(size_t, size_t)> & body);
+
+      /* Pool shared by the whole library, with one thread per hardware thread */
+      static ThreadPool & GetInstance();
+  };
+}
+
+#endif
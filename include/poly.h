@@ -0,0 +1,250 @@
+#ifndef RLWE_POLY_H
+#define RLWE_POLY_H
+
+#include <NTL/ZZ.h>
+#include <NTL/ZZX.h>
+
+#include "pool.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ostream>
+#include <vector>
+
+// Coefficient blocks come from the calling thread's pool, and start on a cache line boundary by default
+#define POLY_BYTE_ALIGNMENT POOL_BYTE_ALIGNMENT
+
+using namespace NTL;
+
+namespace rlwe {
+  // Polynomials hold either their coefficients or their evaluations at the roots of x^n + 1 (i.e. their NTT)
+  enum PolyDomain {
+    COEFFICIENT_DOMAIN,
+    EVALUATION_DOMAIN
+  };
+
+  // Polynomial with a fixed number of word-sized coefficients, stored as one contiguous, aligned block
+  // Coefficients carry no modulus of their own; they are interpreted modulo whatever ring they are used in
+  template <typename T>
+  class Poly {
+    private:
+      T * coeffs;
+      size_t len;
+      PolyDomain domain;
+
+      /* Takes an uninitialized, aligned block for `len` coefficients from the pool, and gives it back */
+      static T * Allocate(size_t len) {
+        return (T *) pool::Allocate(len * sizeof(T));
+      }
+      static void Release(T * coeffs, size_t len) {
+        pool::Release(coeffs, len * sizeof(T));
+      }
+    public:
+      /* Constructors */
+      Poly() : coeffs(NULL), len(0), domain(COEFFICIENT_DOMAIN) {}
+      explicit Poly(size_t len) : coeffs(Allocate(len)), len(len), domain(COEFFICIENT_DOMAIN) {
+        Clear();
+      }
+      Poly(const Poly & poly) : coeffs(Allocate(poly.len)), len(poly.len), domain(poly.domain) {
+        if (len > 0) {
+          memcpy(coeffs, poly.coeffs, len * sizeof(T));
+        }
+      }
+      Poly(Poly && poly) : coeffs(poly.coeffs), len(poly.len), domain(poly.domain) {
+        poly.coeffs = NULL;
+        poly.len = 0;
+      }
+
+      /* Destructors */
+      ~Poly() {
+        Release(coeffs, len);
+      }
+
+      /* Assignment */
+      Poly & operator= (const Poly & poly) {
+        if (this != &poly) {
+          if (len != poly.len) {
+            Release(coeffs, len);
+            coeffs = Allocate(poly.len);
+            len = poly.len;
+          }
+          if (len > 0) {
+            memcpy(coeffs, poly.coeffs, len * sizeof(T));
+          }
+          domain = poly.domain;
+        }
+        return *this;
+      }
+      Poly & operator= (Poly && poly) {
+        T * tmp_coeffs = coeffs;
+        size_t tmp_len = len;
+        coeffs = poly.coeffs;
+        len = poly.len;
+        poly.coeffs = tmp_coeffs;
+        poly.len = tmp_len;
+        PolyDomain tmp_domain = domain;
+        domain = poly.domain;
+        poly.domain = tmp_domain;
+        return *this;
+      }
+
+      /* Getters */
+      size_t GetLength() const {
+        return len;
+      }
+      PolyDomain GetDomain() const {
+        return domain;
+      }
+      const T * GetData() const {
+        return coeffs;
+      }
+      const T & operator[] (size_t index) const {
+        return coeffs[index];
+      }
+
+      /* Setters */
+      T * GetData() {
+        return coeffs;
+      }
+      T & operator[] (size_t index) {
+        return coeffs[index];
+      }
+      void SetDomain(PolyDomain domain) {
+        this->domain = domain;
+      }
+      void SetLength(size_t new_len) {
+        if (new_len == len) {
+          return;
+        }
+
+        // Keep the existing prefix and zero out anything new
+        T * new_coeffs = Allocate(new_len);
+        size_t keep = new_len < len ? new_len : len;
+        if (keep > 0) {
+          memcpy(new_coeffs, coeffs, keep * sizeof(T));
+        }
+        if (new_len > keep) {
+          memset(new_coeffs + keep, 0, (new_len - keep) * sizeof(T));
+        }
+
+        Release(coeffs, len);
+        coeffs = new_coeffs;
+        len = new_len;
+      }
+      void Clear() {
+        if (len > 0) {
+          memset(coeffs, 0, len * sizeof(T));
+        }
+      }
+
+      /* Equality */
+      bool operator== (const Poly & poly) const {
+        return len == poly.len && domain == poly.domain && (len == 0 || memcmp(coeffs, poly.coeffs, len * sizeof(T)) == 0);
+      }
+      bool operator!= (const Poly & poly) const {
+        return !(*this == poly);
+      }
+
+      /* Display to output stream (same format as NTL) */
+      friend std::ostream & operator<< (std::ostream & stream, const Poly & poly) {
+        stream << "[";
+        for (size_t i = 0; i < poly.len; i++) {
+          if (i > 0) {
+            stream << " ";
+          }
+          stream << (unsigned long long) poly.coeffs[i];
+        }
+        return stream << "]";
+      }
+  };
+
+  // Converts a word-based polynomial into an integer polynomial, with each coefficient lying in [0, q)
+  // Polynomials in the evaluation domain have to be brought back through their ring first
+  template <typename T>
+  void conv(ZZX & result, const Poly<T> & poly) {
+    assert(poly.GetDomain() == COEFFICIENT_DOMAIN);
+    result.SetLength(poly.GetLength());
+    for (size_t i = 0; i < poly.GetLength(); i++) {
+      conv(result[i], (unsigned long) poly[i]);
+    }
+    result.normalize();
+  }
+
+  // Nonzero coefficient of a sparse ternary polynomial
+  struct SparseTerm {
+    uint32_t index;
+    bool negative;
+  };
+
+  // Polynomial whose few nonzero coefficients are all +1 or -1, stored as (index, sign) pairs (e.g. the ring-TESLA challenge)
+  // Multiplying a dense polynomial by one takes a shifted addition or subtraction per term, with no transform at all
+  class SparseTernaryPoly {
+    private:
+      size_t len;
+      std::vector<SparseTerm> terms;
+    public:
+      /* Constructors */
+      SparseTernaryPoly() : len(0) {}
+      explicit SparseTernaryPoly(size_t len) : len(len) {}
+
+      /* Getters */
+      size_t GetLength() const {
+        return len;
+      }
+      size_t GetWeight() const {
+        return terms.size();
+      }
+      const SparseTerm & operator[] (size_t i) const {
+        return terms[i];
+      }
+      bool Contains(uint32_t index) const {
+        for (const SparseTerm & term : terms) {
+          if (term.index == index) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      /* Setters (terms are kept in the order they were added, and each index may appear at most once) */
+      void SetLength(size_t len) {
+        this->len = len;
+        terms.clear();
+      }
+      void AddTerm(uint32_t index, bool negative) {
+        assert(index < len && !Contains(index));
+        terms.push_back({index, negative});
+      }
+      void Clear() {
+        terms.clear();
+      }
+
+      /* Writes out every coefficient, with -1 represented as q - 1 */
+      template <typename T>
+      void ToDense(Poly<T> & result, T mod) const {
+        result.SetLength(len);
+        result.SetDomain(COEFFICIENT_DOMAIN);
+        result.Clear();
+        for (const SparseTerm & term : terms) {
+          result[term.index] = term.negative ? mod - 1 : 1;
+        }
+      }
+
+      /* Equality */
+      bool operator== (const SparseTernaryPoly & poly) const {
+        if (len != poly.len || terms.size() != poly.terms.size()) {
+          return false;
+        }
+        for (size_t i = 0; i < terms.size(); i++) {
+          if (terms[i].index != poly.terms[i].index || terms[i].negative != poly.terms[i].negative) {
+            return false;
+          }
+        }
+        return true;
+      }
+  };
+}
+
+#endif
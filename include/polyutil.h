@@ -2,6 +2,8 @@
 #include <NTL/ZZX.h>
 #include <NTL/RR.h>
 
+#include "poly.h"
+
 using namespace NTL;
 
 namespace rlwe {
@@ -19,4 +21,26 @@ namespace rlwe {
 
   // Checks to see if all coefficients are in the range [lower, upper]
   bool IsInRange(const ZZX & poly, const ZZ & lower, const ZZ & upper);
-}
+
+  // Centers each coefficient modulo the divisor, then scales it by scalar / divisor, rounds it and reduces it modulo mod
+  template <typename T>
+  void RoundPoly(Poly<T> & result, const Poly<T> & poly, T scalar, T divisor, T mod);
+
+  // The word-based element-wise operations below run on the widest vector instructions the CPU supports (see simd.h)
+
+  // Applies a right shift to each coefficient
+  template <typename T>
+  void RightShiftPoly(Poly<T> & result, const Poly<T> & poly, unsigned long bits);
+
+  // Applies an AND bitmask to each coefficient
+  template <typename T>
+  void AndPoly(Poly<T> & result, const Poly<T> & poly, T bitmask);
+
+  // Checks to see if all coefficients are in the range [lower, upper]
+  template <typename T>
+  bool IsInRange(const Poly<T> & poly, T lower, T upper);
+
+  // Checks to see if all coefficients, once centered modulo q, are in the range [-bound, bound]
+  template <typename T>
+  bool IsInCenteredRange(const Poly<T> & poly, T bound, T mod);
+}
\ No newline at end of file
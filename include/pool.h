@@ -0,0 +1,45 @@
+#ifndef RLWE_POOL_H
+#define RLWE_POOL_H
+
+#include <stddef.h>
+
+// Every block starts on a cache line boundary unless the library is built with another alignment (a power of two)
+#ifndef POOL_BYTE_ALIGNMENT
+#define POOL_BYTE_ALIGNMENT 64
+#endif
+#define POOL_BLOCK_LIMIT 64 // Free blocks of each size that a thread keeps, unless it has reserved more
+#define POOL_HUGE_PAGE_BYTE_LENGTH (2 * 1024 * 1024)
+
+namespace rlwe {
+  // Per-thread pool of the memory blocks behind ring elements (polynomial coefficients, packets and transform tables)
+  // Released blocks are kept by the releasing thread and handed back out for the next block of the same size, so that
+  // code creating and destroying many polynomials of one degree stops going to the system allocator once warmed up
+  namespace pool {
+    /* Blocks of at least the given number of bytes, aligned to POOL_BYTE_ALIGNMENT */
+    /* A block may be released on any thread, with the same byte length it was allocated with */
+    void * Allocate(size_t bytes);
+    void Release(void * block, size_t bytes);
+
+    /* Fills the calling thread's pool with count free blocks of the given size, and keeps up to that many from then on */
+    void Reserve(size_t bytes, size_t count);
+
+    /* Same, for count polynomials of n coefficients (e.g. n = KeyParameters::GetPolyModulusDegree()) */
+    template <typename T>
+    void Reserve(size_t n, size_t count) {
+      Reserve(n * sizeof(T), count);
+    }
+
+    /* Gives the calling thread's free blocks back to the system */
+    void Clear();
+
+    /* Number of free blocks that the calling thread holds */
+    size_t GetFreeBlockCount();
+
+    /* Blocks of at least the threshold (in bytes) are aligned to whole huge pages and advised to be backed by them */
+    /* (e.g. large evaluation keys and transform tables); the threshold is shared by every thread, and 0 turns this off */
+    void SetHugePageThreshold(size_t bytes);
+    size_t GetHugePageThreshold();
+  }
+}
+
+#endif
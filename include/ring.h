@@ -0,0 +1,80 @@
+#ifndef RLWE_RING_H
+#define RLWE_RING_H
+
+#include <NTL/ZZ.h>
+#include <NTL/ZZX.h>
+
+#include "ntt.h"
+#include "poly.h"
+#include "rns.h"
+
+using namespace NTL;
+
+namespace rlwe {
+  // Arithmetic on word-based polynomials in Z_q[x]/(x^n + 1), where q fits in a single word
+  // All modulus-dependent state lives in the context itself rather than in NTL's thread-local ZZ_p modulus,
+  // so a context is immutable once built and can be shared freely between threads
+  // Multiplications go through the NTT whenever the ring admits one; otherwise, moduli made up of distinct NTT-friendly primes
+  // get a full-RNS representation (which also serves the tensor products of FV), and any other modulus falls back to an
+  // auxiliary RNS base with Garner's algorithm
+  // Operands that are reused across many multiplications (e.g. keys) can be kept in the evaluation domain,
+  // in which case their forward transform is skipped; without a transform the evaluation domain is the coefficient domain
+  template <typename T>
+  class RingContext {
+    private:
+      /* Given parameters */
+      size_t n;
+      T q;
+      /* Calculated */
+      ZZ q_zz;
+      ZZX phi;
+      NTT<T> * ntt;
+      RNSModulus * rns_modulus;
+      RNSBase * rns;
+    public:
+      /* Constructors; q must be at least 2 and fit in one bit less than a word, or std::invalid_argument is thrown */
+      RingContext(size_t n, const ZZ & q);
+
+      /* Destructors */
+      ~RingContext();
+
+      /* Transform tables are owned by the context and are never shared */
+      RingContext(const RingContext & ring) = delete;
+      RingContext & operator= (const RingContext & ring) = delete;
+
+      /* Getters */
+      size_t GetDegree() const { return n; }
+      T GetModulus() const { return q; }
+      const ZZX & GetPolyModulus() const { return phi; }
+      const NTT<T> * GetNTT() const { return ntt; }
+      const RNSModulus * GetRNSModulus() const { return rns_modulus; }
+      const RNSBase * GetRNSBase() const { return rns; }
+
+      /* Conversions between integer and word-based polynomials */
+      void Reduce(Poly<T> & result, const ZZX & poly) const;
+      void Reduce(Poly<T> & result, const Poly<T> & poly) const;
+      void Center(ZZX & result, const Poly<T> & poly) const;
+      void Lift(ZZX & result, const Poly<T> & poly) const;
+
+      /* Conversions between the coefficient and evaluation domains (the result may alias the input) */
+      void ToEvaluationDomain(Poly<T> & result, const Poly<T> & poly) const;
+      void ToCoefficientDomain(Poly<T> & result, const Poly<T> & poly) const;
+
+      /* Ring arithmetic (the result may alias any of the inputs) */
+      /* Sums need both operands in the same domain; products stay in the evaluation domain only if both operands are in it */
+      void Add(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const;
+      void Subtract(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const;
+      void Negate(Poly<T> & result, const Poly<T> & a) const;
+      void Multiply(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const;
+      void MultiplyScalar(Poly<T> & result, const Poly<T> & a, T scalar) const;
+
+      /* Negacyclic product with a sparse ternary polynomial in O(weight * n) word operations; a must be in the coefficient domain */
+      void Multiply(Poly<T> & result, const Poly<T> & a, const SparseTernaryPoly & c) const;
+
+      /* Computes the tensor product of two vectors of polynomials over the integers and then scales it by scalar / q */
+      /* The m-th entry of the result is round(scalar * (a_0 * b_m + a_1 * b_(m-1) + ...) / q) mod q */
+      void TensorScaleRound(Vec<Poly<T>> & result, const Vec<Poly<T>> & a, const Vec<Poly<T>> & b, T scalar) const;
+  };
+}
+
+#endif
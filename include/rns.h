@@ -0,0 +1,144 @@
+#ifndef RLWE_RNS_H
+#define RLWE_RNS_H
+
+#include "ntt.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Primes in the base are chosen just below 2^RNS_PRIME_BIT_COUNT
+#define RNS_PRIME_BIT_COUNT 61
+// Upper bound on the number of primes in a base (which caps the dynamic range at about 488 bits)
+#define RNS_MAX_PRIMES 8
+
+namespace rlwe {
+  // Residue number system made up of word-sized NTT-friendly primes p_0, ..., p_(k-1)
+  // Products of polynomials in Z[x]/(x^n + 1) are computed exactly as long as their centered coefficients
+  // stay within the dynamic range P = p_0 * ... * p_(k-1)
+  // On its own, a base only serves as the fallback for arbitrary (e.g. even) q: inputs are lifted from Z_q and every
+  // output coefficient is rebuilt with Garner's algorithm into a k-word integer, which is then reduced (and scaled)
+  // modulo q with multi-word arithmetic, at a cost of O(k^2) word operations and k + 1 128-bit divisions per coefficient
+  // Residues are laid out prime by prime, i.e. the residues modulo p_i occupy [i * n, (i + 1) * n)
+  class RNSBase {
+    private:
+      size_t n;
+      size_t len;
+      uint64_t * primes;
+      NTT<uint64_t> ** ntts;
+      /* Calculated */
+      uint64_t * garner;
+      uint64_t * garner_precomp;
+      uint64_t * range;
+      uint64_t * half_range;
+
+      /* Builds the transforms and Garner's constants once the primes are set */
+      void Initialize();
+
+      /* Rebuilds a single centered coefficient from its residues */
+      bool Reconstruct(uint64_t * x, const uint64_t * residues, size_t index) const;
+    public:
+      /* Constructors; the base either covers the given number of bits or is made up of the given primes */
+      RNSBase(size_t n, size_t bits);
+      RNSBase(size_t n, const uint64_t * primes, size_t len);
+
+      /* Destructors */
+      ~RNSBase();
+
+      /* Transform tables are owned by the base and are never shared */
+      RNSBase(const RNSBase & rns) = delete;
+      RNSBase & operator= (const RNSBase & rns) = delete;
+
+      /* Getters */
+      size_t GetDegree() const { return n; }
+      size_t GetLength() const { return len; }
+      uint64_t GetPrime(size_t index) const { return primes[index]; }
+      const NTT<uint64_t> & GetNTT(size_t index) const { return *ntts[index]; }
+
+      /* Conversions from coefficients modulo q (which are centered first) into residues */
+      template <typename T>
+      void Decompose(uint64_t * residues, const T * coeffs, T q) const;
+
+      /* Transforms of every residue polynomial */
+      void Forward(uint64_t * residues) const;
+      void Inverse(uint64_t * residues) const;
+
+      /* Pointwise products of transformed residues; the second variant accumulates into the result */
+      void PointwiseMultiply(uint64_t * result, const uint64_t * a, const uint64_t * b) const;
+      void PointwiseMultiplyAdd(uint64_t * result, const uint64_t * a, const uint64_t * b) const;
+
+      /* Conversions from residues back into coefficients modulo q */
+      template <typename T>
+      void Reduce(T * coeffs, const uint64_t * residues, T q) const;
+      template <typename T>
+      void ScaleRound(T * coeffs, const uint64_t * residues, T scalar, T q) const;
+  };
+
+  // Full-RNS representation of a modulus q = q_0 * ... * q_(k-1) made up of distinct NTT-friendly primes
+  // Since q fits in a word, an element of Z_q is stored as one word, which is exactly the CRT composition of its k limbs
+  // Ring products are computed limb by limb, one transform per q_i, and composed back into a word without any lifting
+  // Tensor products are computed in the extended base Q u P, where the auxiliary primes p_0, ..., p_(k'-1) leave room
+  // for the scaled result, and are scaled by t / q with the HPS scale-and-round: the residues modulo q_i contribute
+  // their fractional parts through 128-bit fixed-point constants, so the rounded result comes out directly modulo P
+  // and is then switched from P to q; all of this is O(k * k') word multiplications per coefficient and no divisions
+  // The rounding is exact: q is odd, so there are no ties, and the fixed-point error stays well below 1 / (2q)
+  class RNSModulus {
+    private:
+      size_t n;
+      uint64_t q;
+      size_t q_len;
+      size_t p_len;
+      RNSBase * q_base;
+      RNSBase * base;
+      /* Calculated for composition modulo q */
+      uint64_t * q_hat;
+      uint64_t * q_hat_precomp;
+      uint64_t * q_hat_inv;
+      uint64_t * q_hat_inv_precomp;
+      /* Calculated for scaling from Q u P down to P */
+      uint64_t * m_hat_inv;
+      uint64_t * floor_p_div_q;
+      uint64_t * floor_p_div_q_precomp;
+      uint64_t * frac_p_div_q;
+      uint64_t * q_inv;
+      uint64_t * one_precomp;
+      /* Calculated for switching from P to q */
+      uint64_t * p_hat;
+      uint64_t * p_hat_precomp;
+      uint64_t * p_hat_inv;
+      uint64_t * p_hat_inv_precomp;
+      double * p_inv;
+      uint64_t p_mod_q;
+      uint64_t p_mod_q_precomp;
+    public:
+      /* Constructors; the auxiliary primes P cover the given number of bits */
+      RNSModulus(size_t n, uint64_t q, size_t bits);
+
+      /* Destructors */
+      ~RNSModulus();
+
+      /* Transform tables are owned by the modulus and are never shared */
+      RNSModulus(const RNSModulus & rns) = delete;
+      RNSModulus & operator= (const RNSModulus & rns) = delete;
+
+      /* Checks if q factors into distinct NTT-friendly primes and the extended base still fits in RNS_MAX_PRIMES */
+      static bool IsSupported(size_t n, uint64_t q, size_t bits);
+
+      /* Getters */
+      size_t GetDegree() const { return n; }
+      uint64_t GetModulus() const { return q; }
+      size_t GetModulusLength() const { return q_len; }
+      size_t GetExtensionLength() const { return p_len; }
+      const RNSBase & GetModulusBase() const { return *q_base; }
+      const RNSBase & GetExtendedBase() const { return *base; }
+
+      /* Composes residues in the modulus base back into coefficients modulo q */
+      template <typename T>
+      void Compose(T * coeffs, const uint64_t * residues) const;
+
+      /* Computes round(scalar * x / q) mod q from the residues of x in the extended base */
+      template <typename T>
+      void ScaleRound(T * coeffs, const uint64_t * residues, T scalar) const;
+  };
+}
+
+#endif
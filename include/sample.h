@@ -1,13 +1,62 @@
+#ifndef RLWE_SAMPLE_H
+#define RLWE_SAMPLE_H
+
 #include <NTL/ZZ.h>
 #include <NTL/ZZX.h>
 
+#include <sys/types.h>
+
+#include "poly.h"
+
 using namespace NTL;
 
 #define PROBABILITY_MATRIX_BYTE_PRECISION 8
 #define PROBABILITY_MATRIX_BIT_PRECISION 64
 #define PROBABILITY_MATRIX_BOUNDS_SCALAR 6
+#define KNUTH_YAO_BLOCK_SIZE 64 // One sample per bit of a 64-bit random word
+#define CDT_BLOCK_SIZE 64
+#define BINOMIAL_BLOCK_SIZE 64
+#define RANDOM_STREAM_SEED_BYTE_LENGTH 32
+#define RANDOM_STREAM_BUFFER_BYTE_LENGTH 4096
 
 namespace rlwe {
+  // Cryptographically secure stream of random bytes, produced as the ChaCha20 keystream of a 256-bit seed
+  // Every sampler below draws from the calling thread's stream, so seeding it makes sampling on that thread reproducible
+  class RandomStream {
+    private:
+      uint8_t key[RANDOM_STREAM_SEED_BYTE_LENGTH];
+      uint64_t counter;
+      uint8_t buffer[RANDOM_STREAM_BUFFER_BYTE_LENGTH];
+      size_t position;
+      pid_t pid; // Process that the stream was seeded in
+
+      /* Generates the next buffer of keystream */
+      void Refill();
+    public:
+      /* Constructors (without a seed, the stream is seeded from the operating system) */
+      RandomStream();
+      RandomStream(const uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH]);
+
+      /* Restarts the stream from the given seed */
+      void SetSeed(const uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH]);
+
+      /* Restarts the stream from a fresh seed taken from the operating system */
+      void Reseed();
+
+      /* Fills the output with the next bytes of the stream; large requests are written straight from the keystream */
+      void GetBytes(void * output, size_t len);
+      uint32_t GetWord32();
+      uint64_t GetWord64();
+
+      /* Uniformly draws a value in [0, bound) by rejection sampling */
+      uint64_t Uniform(uint64_t bound);
+      void Uniform(ZZ & value, const ZZ & bound);
+
+      /* The calling thread's stream, which is reseeded from the operating system the first time it is used in a */
+      /* forked child, so that parent and child never share a keystream (even if the parent had seeded it) */
+      static RandomStream & GetInstance();
+  };
+
   // Uniformly samples a polynomial of the given length, where the coefficients lie in [min, max)
   void UniformSample(ZZX & poly, size_t len, const ZZ & minimum_inclusive, const ZZ & maximum_exclusive);
   ZZX UniformSample(size_t len, const ZZ & minimum_inclusive, const ZZ & maximum_exclusive);
@@ -16,11 +65,134 @@ namespace rlwe {
   void UniformSample(ZZX & poly, size_t len, const ZZ & maximum_exclusive);
   ZZX UniformSample(size_t len, const ZZ & maximum_exclusive);
 
+  // Uniformly samples a word-based polynomial of the given length, where the coefficients lie in [min, max) and are then reduced modulo q
+  template <typename T>
+  void UniformSample(Poly<T> & poly, size_t len, long minimum_inclusive, long maximum_exclusive, T mod);
+
+  // Uniformly samples a word-based polynomial of the given length, where the coefficients lie in [0, max)
+  template <typename T>
+  void UniformSample(Poly<T> & poly, size_t len, T maximum_exclusive);
+
   // Generates a compressed binary probability matrix for use in the Knuth-Yao sampling algorithm
   void KnuthYaoGaussianMatrix(uint8_t ** pmat, size_t pmat_rows, float sigma);
   uint8_t ** KnuthYaoGaussianMatrix(size_t pmat_rows, float sigma);
 
   // Samples a polynomial of the given length, where each coefficient is taken from a binary probability matrix 
+  // Coefficients are drawn KNUTH_YAO_BLOCK_SIZE at a time in constant time, i.e. the work done does not depend on the values sampled
   void KnuthYaoSample(ZZX & poly, size_t len, uint8_t ** pmat, size_t pmat_rows);
   ZZX KnuthYaoSample(size_t len, uint8_t ** pmat, size_t pmat_rows);
+
+  // Samples a word-based polynomial of the given length from a binary probability matrix, reducing each coefficient modulo q
+  template <typename T>
+  void KnuthYaoSample(Poly<T> & poly, size_t len, T mod, uint8_t ** pmat, size_t pmat_rows);
+
+  // Discrete Gaussian samplers that key parameters can draw their errors with
+  enum GaussianSamplerType {
+    KNUTH_YAO_SAMPLER,
+    CDT_SAMPLER,
+    BINOMIAL_SAMPLER
+  };
+
+  // Samples integers from a discrete Gaussian centered at 0, with tails cut off at PROBABILITY_MATRIX_BOUNDS_SCALAR * sigma
+  class GaussianSampler {
+    protected:
+      float sigma;
+      size_t bound;
+    public:
+      /* Constructors */
+      GaussianSampler(float sigma) : sigma(sigma), bound(sigma * PROBABILITY_MATRIX_BOUNDS_SCALAR) {}
+      GaussianSampler(float sigma, size_t bound) : sigma(sigma), bound(bound) {}
+      static GaussianSampler * Create(GaussianSamplerType type, float sigma);
+
+      /* Destructors */
+      virtual ~GaussianSampler() {}
+
+      /* Getters */
+      virtual GaussianSamplerType GetType() const = 0;
+      float GetStandardDeviation() const { return sigma; }
+      size_t GetBound() const { return bound; }
+
+      /* Samples len signed values, each with an absolute value below the bound */
+      virtual void Sample(int32_t * values, size_t len) const = 0;
+
+      /* Samples a polynomial of the given length */
+      void Sample(ZZX & poly, size_t len) const;
+      ZZX Sample(size_t len) const;
+
+      /* Samples a word-based polynomial of the given length, reducing each coefficient modulo q */
+      template <typename T>
+      void Sample(Poly<T> & poly, size_t len, T mod) const;
+  };
+
+  // Knuth-Yao sampler walking a binary probability matrix; see KnuthYaoSample
+  class KnuthYaoSampler : public GaussianSampler {
+    private:
+      uint8_t ** pmat;
+    public:
+      /* Constructors */
+      KnuthYaoSampler(float sigma);
+
+      /* Destructors */
+      ~KnuthYaoSampler();
+
+      /* The matrix is owned by the sampler */
+      KnuthYaoSampler(const KnuthYaoSampler & sampler) = delete;
+      KnuthYaoSampler & operator= (const KnuthYaoSampler & sampler) = delete;
+
+      /* Getters */
+      GaussianSamplerType GetType() const { return KNUTH_YAO_SAMPLER; }
+      uint8_t ** GetProbabilityMatrix() const { return pmat; }
+      size_t GetProbabilityMatrixRows() const { return bound; }
+
+      /* Sampling */
+      using GaussianSampler::Sample;
+      void Sample(int32_t * values, size_t len) const;
+  };
+
+  // Cumulative distribution table sampler, which compares one random 63-bit value against the whole table in constant time
+  // The scan costs one comparison per row no matter the precision, so it outpaces Knuth-Yao for large standard deviations
+  class CDTSampler : public GaussianSampler {
+    private:
+      int64_t * table;
+      size_t table_size;
+    public:
+      /* Constructors */
+      CDTSampler(float sigma);
+
+      /* Destructors */
+      ~CDTSampler();
+
+      /* The table is owned by the sampler */
+      CDTSampler(const CDTSampler & sampler) = delete;
+      CDTSampler & operator= (const CDTSampler & sampler) = delete;
+
+      /* Getters */
+      GaussianSamplerType GetType() const { return CDT_SAMPLER; }
+      const int64_t * GetTable() const { return table; }
+      size_t GetTableSize() const { return table_size; }
+
+      /* Sampling */
+      using GaussianSampler::Sample;
+      void Sample(int32_t * values, size_t len) const;
+  };
+
+  // Centered binomial sampler, which draws the difference of the Hamming weights of two random k-bit strings
+  // Its variance is k / 2, so taking k = 2 * sigma^2 matches the Gaussian (e.g. NewHope's psi_16 for sigma = sqrt(8))
+  class BinomialSampler : public GaussianSampler {
+    private:
+      size_t k;
+    public:
+      /* Constructors */
+      BinomialSampler(float sigma);
+
+      /* Getters */
+      GaussianSamplerType GetType() const { return BINOMIAL_SAMPLER; }
+      size_t GetBitCount() const { return k; }
+
+      /* Sampling */
+      using GaussianSampler::Sample;
+      void Sample(int32_t * values, size_t len) const;
+  };
 }
+
+#endif
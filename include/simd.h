@@ -0,0 +1,46 @@
+#ifndef RLWE_SIMD_H
+#define RLWE_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rlwe {
+  namespace simd {
+    // Instruction sets the element-wise kernels can run on, from least to most capable
+    enum InstructionSet {
+      SCALAR,
+      AVX2,
+      AVX512
+    };
+
+    // Most capable instruction set supported by the current CPU (detected once, on first use)
+    InstructionSet GetSupportedInstructionSet();
+
+    // Instruction set the kernels currently dispatch to; this starts out as the most capable supported one
+    InstructionSet GetInstructionSet();
+
+    // Restricts the kernels to the given instruction set (or the most capable supported one, if that is lower)
+    void SetInstructionSet(InstructionSet set);
+
+    // Computes result[i] = values[i] & mask (result may alias values)
+    template <typename T>
+    void And(T * result, const T * values, size_t len, T mask);
+
+    // Computes result[i] = values[i] >> bits, where shifting by the word size or more gives 0 (result may alias values)
+    template <typename T>
+    void RightShift(T * result, const T * values, size_t len, unsigned long bits);
+
+    // Checks that every value lies in [lower, upper]
+    template <typename T>
+    bool IsInRange(const T * values, size_t len, T lower, T upper);
+
+    // Checks that every value, once centered modulo mod, lies in [-bound, bound]
+    template <typename T>
+    bool IsInCenteredRange(const T * values, size_t len, T bound, T mod);
+
+    // Applies Keccak-f[1600] to four independent states, where word i of state k is states[4 * i + k]
+    void KeccakF1600x4(uint64_t states[100]);
+  }
+}
+
+#endif
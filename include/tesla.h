@@ -3,7 +3,14 @@
 #include <NTL/pair.h>
 #include <sodium.h>
 
+#include "ring.h"
+#include "sample.h"
+
+#include <istream>
+#include <vector>
+
 #define DEFAULT_POLY_MODULUS_DEGREE 512
+#define DEFAULT_GAUSSIAN_SAMPLER CDT_SAMPLER
 #define DEFAULT_ERROR_STANDARD_DEVIATION 52.0f 
 #define DEFAULT_ERROR_BOUND 2766
 #define DEFAULT_ENCODING_WEIGHT 19
@@ -11,6 +18,12 @@
 #define DEFAULT_SIGNATURE_BOUND_ADJUSTMENT 3173
 #define DEFAULT_LEAST_SIGNIFICANT_BITS 23
 #define DEFAULT_COEFF_MODULUS 39960577LL
+#define VERIFY_BATCH_GRAIN_SIZE 4
+#define DEFAULT_HASH_VERSION HASH_VERSION_BINARY
+#define HASH_BLOCK_SIZE 256 // Rounded coefficients serialized into the hash state at a time
+#define PREHASH_BYTE_LENGTH crypto_hash_sha256_BYTES
+#define PREHASH_BLOCK_BYTE_LENGTH 65536 // Bytes of a streamed message read at a time
+#define PREHASHED_VERSION_FLAG 0x80 // Set in the version byte of the hash input when the message is a digest
 
 using namespace NTL;
 
@@ -21,6 +34,12 @@ namespace rlwe {
     class VerificationKey;
     class Signature;
 
+    // Serializations of the hash input (the rounded v1 and v2, then the message), each of which fixes a signature format
+    enum HashVersion {
+      HASH_VERSION_TEXT = 1, // The rounded polynomials in NTL's text format, as in the original implementation
+      HASH_VERSION_BINARY = 2 // A version byte, then every rounded coefficient in a fixed number of little-endian bytes
+    };
+
     /* Key generation */
     void GenerateSigningKey(SigningKey & signer);
     void GenerateVerificationKey(VerificationKey & verif, const SigningKey & signer);
@@ -31,16 +50,52 @@ namespace rlwe {
 
     /* Signing & verifying */
     void Sign(Signature & sig, const std::string & message, const SigningKey & signer); 
+
+    /* Variants on raw bytes, which produce and accept the same signatures as the std::string variants */
+    void Sign(Signature & sig, const unsigned char * message, size_t len, const SigningKey & signer); 
+    bool Verify(const unsigned char * message, size_t len, const Signature & sig, const VerificationKey & verif);
+
+    /* Prehashed messages are digested once (from memory or streamed from any source), and only the digest enters each signing attempt */
+    /* Their signatures are kept apart from signatures of raw messages, and need a binary hash format */
+    void Prehash(unsigned char * digest, const unsigned char * message, size_t len);
+    /* Streaming returns false (and zeroes the digest) unless the whole stream was read up to a clean end of file */
+    bool Prehash(unsigned char * digest, std::istream & message);
+    void SignPrehashed(Signature & sig, const unsigned char * digest, const SigningKey & signer); 
+    bool VerifyPrehashed(const unsigned char * digest, const Signature & sig, const VerificationKey & verif);
+
+    /* Speculative signing, which evaluates candidate_count values of y at once across the library's thread pool */
+    /* and keeps one that passes the rejection conditions, so that a streak of rejections costs fewer rounds */
+    void Sign(Signature & sig, const std::string & message, const SigningKey & signer, size_t candidate_count); 
     bool Verify(const std::string & message, const Signature & sig, const VerificationKey & verif);
 
+    /* Batched verification of many signatures, spread across the library's thread pool */
+    /* results[i] tells whether sigs[i] is a valid signature of messages[i] under *verifs[i]; any number of items may share a key */
+    void VerifyBatch(bool * results, const std::string * messages, const Signature * sigs, 
+        const VerificationKey * const * verifs, size_t count);
+
     /* Object-oriented variants */
     Signature Sign(const std::string & message, const SigningKey & signer);
+    Signature Sign(const std::string & message, const SigningKey & signer, size_t candidate_count);
+    std::vector<bool> VerifyBatch(const std::vector<std::string> & messages, const std::vector<Signature> & sigs, 
+        const VerificationKey & verif);
 
     /* Util functions */
     void Hash(unsigned char * output, const ZZX & p1, const ZZX & p2, 
         const std::string & message, const KeyParameters & params);
     void Encode(ZZX & dest, const unsigned char * hash_val, const KeyParameters & params); 
 
+    /* Word-based variants */
+    void Hash(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+        const std::string & message, const KeyParameters & params);
+    void Hash(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+        const unsigned char * message, size_t len, const KeyParameters & params);
+    void HashPrehashed(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+        const unsigned char * digest, const KeyParameters & params);
+    void Encode(Poly<uint32_t> & dest, const unsigned char * hash_val, const KeyParameters & params); 
+
+    /* Sparse variant, holding just the w nonzero coefficients of the encoding */
+    void Encode(SparseTernaryPoly & dest, const unsigned char * hash_val, const KeyParameters & params); 
+
     class KeyParameters {
       private:
         /* Given parameters */ 
@@ -52,12 +107,13 @@ namespace rlwe {
         ZZ U;
         uint32_t d;
         ZZ q;
-        Pair<ZZX, ZZX> a;
+        Pair<Poly<uint32_t>, Poly<uint32_t>> a;
         /* Calculated */
         ZZ pow_2d;
-        ZZ_pXModulus phi;
-        uint8_t ** pmat;
-        size_t pmat_rows;
+        RingContext<uint32_t> ring;
+        GaussianSampler * sampler;
+        HashVersion hash_version;
+        size_t hash_coeff_bytes;
       public:
         /* Constructors */
         KeyParameters(); 
@@ -65,18 +121,24 @@ namespace rlwe {
         KeyParameters(const ZZX & a1, const ZZX & a2, 
             size_t n, float sigma, const ZZ & L, uint32_t w, 
             const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q); 
+        KeyParameters(const ZZX & a1, const ZZX & a2, 
+            size_t n, float sigma, const ZZ & L, uint32_t w, 
+            const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q,
+            GaussianSamplerType sampler_type); 
+        KeyParameters(const ZZX & a1, const ZZX & a2, 
+            size_t n, float sigma, const ZZ & L, uint32_t w, 
+            const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q,
+            GaussianSamplerType sampler_type, HashVersion hash_version); 
 
         /* Destructors */
         ~KeyParameters() {
-          for (size_t i = 0; i < pmat_rows; i++) {
-            free(pmat[i]);
-          }
-          free(pmat);
+          delete sampler;
         }
 
-        /* Getters */
-        const Pair<ZZX, ZZX> & GetPolyConstants() const { return a; }
-        const ZZ_pXModulus & GetPolyModulus() const { return phi; }
+        /* Getters (the polynomial constants are kept in the evaluation domain) */
+        const Pair<Poly<uint32_t>, Poly<uint32_t>> & GetPolyConstants() const { return a; }
+        const ZZX & GetPolyModulus() const { return ring.GetPolyModulus(); }
+        const RingContext<uint32_t> & GetRing() const { return ring; }
         size_t GetPolyModulusDegree() const { return n; }
         float GetErrorStandardDeviation() const { return sigma; }
         const ZZ & GetErrorBound() const { return L; }
@@ -86,13 +148,14 @@ namespace rlwe {
         uint32_t GetLSBCount() const { return d; }
         const ZZ & GetLSBValue() const { return pow_2d; }
         const ZZ & GetCoeffModulus() const { return q; }
-        uint8_t ** GetProbabilityMatrix() const { return pmat; }
-        size_t GetProbabilityMatrixRows() const { return pmat_rows; }
+        const GaussianSampler & GetGaussianSampler() const { return *sampler; }
+        HashVersion GetHashVersion() const { return hash_version; }
+        size_t GetHashCoeffByteLength() const { return hash_coeff_bytes; }
 
         /* Equality */
         bool operator== (const KeyParameters & kp) const {
           return n == kp.n && sigma == kp.sigma && L == kp.L && w == kp.w && 
-            B == kp.B && U == kp.U && d == kp.d && q == kp.q && a == kp.a;
+            B == kp.B && U == kp.U && d == kp.d && q == kp.q && a == kp.a && hash_version == kp.hash_version;
         }
 
         /* Display to output stream */
@@ -108,18 +171,18 @@ namespace rlwe {
 
     class SigningKey {
       private:
-        ZZX s;
-        Pair<ZZX, ZZX> e;
+        Poly<uint32_t> s;
+        Pair<Poly<uint32_t>, Poly<uint32_t>> e;
         const KeyParameters & params;
       public:
         /* Constructors */
         SigningKey(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const ZZX & GetSecret() const {
+        /* Getters (the secret and errors are kept in the coefficient domain, since they are only multiplied by the sparse c) */
+        const Poly<uint32_t> & GetSecret() const {
           return s;
         }
-        const Pair<ZZX, ZZX> GetErrors() const {
+        const Pair<Poly<uint32_t>, Poly<uint32_t>> & GetErrors() const {
           return e;
         }
         const KeyParameters & GetParameters() const {
@@ -127,10 +190,10 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetSecret(const ZZX & secret) {
+        void SetSecret(const Poly<uint32_t> & secret) {
           this->s = secret;
         }
-        void SetErrors(const ZZX & e1, const ZZX & e2) {
+        void SetErrors(const Poly<uint32_t> & e1, const Poly<uint32_t> & e2) {
           this->e.a = e1;
           this->e.b = e2;
         }
@@ -143,14 +206,14 @@ namespace rlwe {
 
     class VerificationKey {
       private:
-        Pair<ZZX, ZZX> t;
+        Pair<Poly<uint32_t>, Poly<uint32_t>> t;
         const KeyParameters & params;
       public:
         /* Constructors */
         VerificationKey(const KeyParameters & params) : params(params) {}
 
-        /* Getters */
-        const Pair<ZZX, ZZX> & GetValues() const {
+        /* Getters (both polynomials are kept in the coefficient domain, since they are only multiplied by the sparse c) */
+        const Pair<Poly<uint32_t>, Poly<uint32_t>> & GetValues() const {
           return t;
         }
         const KeyParameters & GetParameters() const {
@@ -158,7 +221,7 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetValues(const ZZX & t1, const ZZX & t2) {
+        void SetValues(const Poly<uint32_t> & t1, const Poly<uint32_t> & t2) {
           this->t.a = t1;
           this->t.b = t2;
         }
@@ -171,22 +234,15 @@ namespace rlwe {
 
     class Signature {
       private:
-        ZZX z;
-        unsigned char * c_prime;
+        Poly<uint32_t> z;
+        unsigned char c_prime[crypto_hash_sha256_BYTES];
         const KeyParameters & params;
       public:
         /* Constructors */
-        Signature(const KeyParameters & params) : params(params) {
-          c_prime = (unsigned char *) malloc(crypto_hash_sha256_BYTES);
-        }
-
-        /* Destructors */
-        ~Signature() {
-          delete c_prime;
-        }
+        Signature(const KeyParameters & params) : params(params) {}
 
         /* Getters */
-        const ZZX & GetValue() const {
+        const Poly<uint32_t> & GetValue() const {
           return z;
         }
         const unsigned char * GetHash() const {
@@ -197,7 +253,7 @@ namespace rlwe {
         }
 
         /* Setters */
-        void SetValue(const ZZX & value) {
+        void SetValue(const Poly<uint32_t> & value) {
           this->z = value;
         }
         void SetHash(const unsigned char * c_prime) {
@@ -0,0 +1,139 @@
+#ifndef RLWE_TRACE_H
+#define RLWE_TRACE_H
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_HISTOGRAM_BUCKET_COUNT 64
+
+namespace rlwe {
+  namespace trace {
+    // Stages of the library whose calls are timed; a stage that calls into another (e.g. a multiplication that
+    // transforms its operands) includes the time spent in it
+    enum Stage {
+      STAGE_SAMPLE, // Uniform, Knuth-Yao, CDT and binomial sampling
+      STAGE_RING_MULTIPLY, // Ring multiplications, including the sparse and tensor products
+      STAGE_TRANSFORM, // Moving polynomials between the coefficient and evaluation domains
+      STAGE_ROUND, // RoundPoly
+      STAGE_HASH, // SHA-256 hashing of ring-TESLA signing inputs and prehashed messages
+      STAGE_SHAKE, // SHAKE-128 expansion of NewHope seeds
+      STAGE_CONVERT, // Conversions between integer and word-based polynomials
+      STAGE_COUNT
+    };
+
+    // Per-call values, other than times, whose distribution is recorded
+    enum Distribution {
+      DISTRIBUTION_SIGN_ATTEMPTS, // Values of y tried by each ring-TESLA signature before one passed
+      DISTRIBUTION_SPECULATIVE_SIGN_ROUNDS, // Rounds of candidates evaluated by each speculative signature
+      DISTRIBUTION_COUNT
+    };
+
+    // Events that are only counted
+    enum Counter {
+      COUNTER_SIGN_REJECTED_Z, // Signing attempts rejected because z was out of range
+      COUNTER_SIGN_REJECTED_W, // Signing attempts rejected because w1 or w2 was out of range
+      COUNTER_PARSE_ACCEPTED, // SHAKE-128 candidates accepted as coefficients by Parse
+      COUNTER_PARSE_REJECTED, // SHAKE-128 candidates rejected by Parse for being at least 5q
+      COUNTER_COUNT
+    };
+
+    // Distribution of recorded values, where bucket 0 holds 0 and bucket k holds [2^(k - 1), 2^k)
+    struct Histogram {
+      uint64_t count;
+      uint64_t sum;
+      uint64_t min;
+      uint64_t max;
+      uint64_t buckets[TRACE_HISTOGRAM_BUCKET_COUNT];
+
+      /* Constructors */
+      Histogram();
+
+      /* Getters */
+      double GetMean() const { return count == 0 ? 0 : (double) sum / count; }
+
+      /* Combines the values recorded in another histogram into this one */
+      void Merge(const Histogram & histogram);
+
+      /* Bucket that a value falls into */
+      static size_t GetBucket(uint64_t value);
+    };
+
+    // Everything recorded on one thread (or, once merged, on several), with times in nanoseconds
+    struct ThreadTrace {
+      size_t thread_index;
+      Histogram stages[STAGE_COUNT];
+      Histogram distributions[DISTRIBUTION_COUNT];
+      uint64_t counters[COUNTER_COUNT];
+
+      /* Constructors */
+      ThreadTrace();
+
+      /* Getters */
+      double GetParseRejectionRate() const;
+
+      /* Combines the events recorded in another trace into this one */
+      void Merge(const ThreadTrace & trace);
+    };
+
+    /* Whether the library was built with RLWE_TRACE; if not, nothing is ever recorded */
+    bool IsEnabled();
+
+    /* Recording, which the RLWE_TRACE_* macros below compile down to */
+    void Record(Stage stage, uint64_t nanoseconds);
+    void Record(Distribution distribution, uint64_t value);
+    void Count(Counter counter, uint64_t amount);
+
+    /* Queries, which may run while other threads are still recording */
+    /* Threads are numbered in the order they first recorded something, and their traces outlive them */
+    std::vector<ThreadTrace> GetThreadTraces();
+    ThreadTrace GetTotal();
+    void Reset();
+
+    /* Exports every thread's trace and their total as JSON */
+    void WriteJSON(std::ostream & stream);
+
+    /* Names used in the JSON output */
+    const char * GetName(Stage stage);
+    const char * GetName(Distribution distribution);
+    const char * GetName(Counter counter);
+
+    // Times the enclosing scope and records it under the given stage
+    class ScopedTimer {
+      private:
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+      public:
+        /* Constructors */
+        explicit ScopedTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+        /* Destructors */
+        ~ScopedTimer() {
+          std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+          Record(stage, (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        /* Timers are tied to their scope */
+        ScopedTimer(const ScopedTimer & timer) = delete;
+        ScopedTimer & operator= (const ScopedTimer & timer) = delete;
+    };
+  }
+}
+
+// Instrumentation points, which compile to nothing (without evaluating their arguments) unless RLWE_TRACE is defined
+#define RLWE_TRACE_CONCAT_(a, b) a##b
+#define RLWE_TRACE_CONCAT(a, b) RLWE_TRACE_CONCAT_(a, b)
+#ifdef RLWE_TRACE
+#define RLWE_TRACE_SCOPE(stage) rlwe::trace::ScopedTimer RLWE_TRACE_CONCAT(rlwe_trace_timer_, __LINE__)(rlwe::trace::stage)
+#define RLWE_TRACE_RECORD(distribution, value) rlwe::trace::Record(rlwe::trace::distribution, (uint64_t) (value))
+#define RLWE_TRACE_COUNT(counter, amount) rlwe::trace::Count(rlwe::trace::counter, (uint64_t) (amount))
+#else
+#define RLWE_TRACE_SCOPE(stage) ((void) 0)
+#define RLWE_TRACE_RECORD(distribution, value) ((void) sizeof(value))
+#define RLWE_TRACE_COUNT(counter, amount) ((void) sizeof(amount))
+#endif
+
+#endif
@@ -1,77 +1,154 @@
 #include "fv.h"
 #include "sample.h"
 #include "polyutil.h"
+#include "parallel.h"
 
 #include <cassert>
+#include <string.h>
+
+// Messages of a batch whose noise is drawn in a single pass, which bounds the size of the noise buffers
+#define ENCRYPT_BATCH_NOISE_COUNT 16
 
 using namespace rlwe;
 using namespace rlwe::fv;
 
-void fv::Encrypt(Ciphertext & ctx, const Plaintext & ptx, const PublicKey & pub) {
+// Buffers that are reused when encrypting many messages in a row
+struct EncryptionBuffers {
+  Poly<uint64_t> m;
+  Poly<uint64_t> u;
+  Poly<uint64_t> e1;
+  Poly<uint64_t> e2;
+};
+
+// Noise for up to ENCRYPT_BATCH_NOISE_COUNT messages of a batch, laid out message by message
+struct BatchNoiseBuffers {
+  Poly<uint64_t> u;
+  Poly<uint64_t> e;
+};
+
+// Copies the n coefficients of one message's noise out of a batch of samples
+static void CopyNoise(Poly<uint64_t> & poly, const Poly<uint64_t> & samples, size_t offset, size_t n) {
+  poly.SetLength(n);
+  poly.SetDomain(COEFFICIENT_DOMAIN);
+  memcpy(poly.GetData(), samples.GetData() + offset, n * sizeof(uint64_t));
+}
+
+// Encrypts with the noise u, e1, e2 already drawn into the buffers
+static void EncryptWithBuffers(Ciphertext & ctx, const Plaintext & ptx, const PublicKey & pub, EncryptionBuffers & buffers) {
   const KeyParameters & params = pub.GetParameters();
   assert(params == ctx.GetParameters());
   assert(params == ptx.GetParameters());
 
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+  // All arithmetic happens in the ciphertext ring R_q
+  const RingContext<uint64_t> & ring = params.GetRing();
 
   // Upscale plaintext to be in ciphertext ring
-  ZZ_pX m = conv<ZZ_pX>(ptx.GetMessage()) * conv<ZZ_p>(params.GetPlainToCoeffScalar());
-
-  // Draw u from uniform distribution over {-1, 0, 1}
-  ZZ_pX u = conv<ZZ_pX>(UniformSample(params.GetPolyModulusDegree(), ZZ(-1), ZZ(2)));
+  Poly<uint64_t> & m = buffers.m;
+  ring.Reduce(m, ptx.GetMessage());
+  ring.MultiplyScalar(m, m, (uint64_t) to_ulong(params.GetPlainToCoeffScalar()));
 
-  // Draw error polynomials from discrete Gaussian distribution
-  ZZ_pX e1 = conv<ZZ_pX>(KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows())); 
-  ZZ_pX e2 = conv<ZZ_pX>(KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows()));
+  // u is transformed once for both products below
+  Poly<uint64_t> & u = buffers.u;
+  ring.ToEvaluationDomain(u, u);
+  const Poly<uint64_t> & e1 = buffers.e1;
+  const Poly<uint64_t> & e2 = buffers.e2;
 
-  // Set up a temporary buffer to hold the results of multiplications
-  ZZ_pX buffer;
+  // Extract information from public key, which is already in the evaluation domain
+  const Pair<Poly<uint64_t>, Poly<uint64_t>> & p = pub.GetValues();
 
-  // Extract information from public key
-  const Pair<ZZX, ZZX> & p = pub.GetValues();
+  ctx.SetLength(2);
 
   // c1 = p0 * u + e1 + m
-  MulMod(buffer, conv<ZZ_pX>(p.a), u, params.GetPolyModulus());
-  ZZ_pX c1 = buffer + e1 + m;
+  ring.Multiply(ctx[0], p.a, u);
+  ring.ToCoefficientDomain(ctx[0], ctx[0]);
+  ring.Add(ctx[0], ctx[0], e1);
+  ring.Add(ctx[0], ctx[0], m);
 
   // c2 = p1 * u + e2
-  MulMod(buffer, conv<ZZ_pX>(p.b), u, params.GetPolyModulus());
-  ZZ_pX c2 = buffer + e2;
+  ring.Multiply(ctx[1], p.b, u);
+  ring.ToCoefficientDomain(ctx[1], ctx[1]);
+  ring.Add(ctx[1], ctx[1], e2);
+}
 
-  ctx.SetLength(2);
-  ctx[0] = conv<ZZX>(c1);
-  ctx[1] = conv<ZZX>(c2);
+void fv::Encrypt(Ciphertext & ctx, const Plaintext & ptx, const PublicKey & pub) {
+  // Each thread keeps its buffers, so that encrypting into a ciphertext of the right size never allocates once warmed up
+  thread_local EncryptionBuffers buffers;
+  const KeyParameters & params = pub.GetParameters();
+  size_t n = params.GetPolyModulusDegree();
+  uint64_t q = params.GetRing().GetModulus();
+
+  // Draw u from uniform distribution over {-1, 0, 1}, and the errors from discrete Gaussian distribution
+  UniformSample(buffers.u, n, -1, 2, q);
+  params.GetGaussianSampler().Sample(buffers.e1, n, q);
+  params.GetGaussianSampler().Sample(buffers.e2, n, q);
+  EncryptWithBuffers(ctx, ptx, pub, buffers);
 }
 
+void fv::EncryptBatch(Ciphertext * ctxs, const Plaintext * ptxs, size_t count, const PublicKey & pub) {
+  const KeyParameters & params = pub.GetParameters();
+  size_t n = params.GetPolyModulusDegree();
+  uint64_t q = params.GetRing().GetModulus();
+
+  // Encryptions are independent, so each thread takes a contiguous range of messages and reuses its buffers across them
+  ThreadPool::GetInstance().ParallelFor(count, [&](size_t begin, size_t end) {
+    EncryptionBuffers buffers;
+    BatchNoiseBuffers noise;
+    for (size_t start = begin; start < end; start += ENCRYPT_BATCH_NOISE_COUNT) {
+      size_t group = end - start < ENCRYPT_BATCH_NOISE_COUNT ? end - start : ENCRYPT_BATCH_NOISE_COUNT;
+
+      // Each kind of noise for the whole group is drawn in one pass, instead of one sampler call per polynomial
+      UniformSample(noise.u, group * n, -1, 2, q);
+      params.GetGaussianSampler().Sample(noise.e, 2 * group * n, q);
+
+      for (size_t i = 0; i < group; i++) {
+        CopyNoise(buffers.u, noise.u, i * n, n);
+        CopyNoise(buffers.e1, noise.e, 2 * i * n, n);
+        CopyNoise(buffers.e2, noise.e, (2 * i + 1) * n, n);
+        EncryptWithBuffers(ctxs[start + i], ptxs[start + i], pub, buffers);
+      }
+    }
+  });
+}
+
+// Buffers that each thread reuses across decryptions
+struct DecryptionBuffers {
+  Poly<uint64_t> m;
+  Poly<uint64_t> power;
+  Poly<uint64_t> buffer;
+  ZZX message;
+};
+
 void fv::Decrypt(Plaintext & ptx, const Ciphertext & ctx, const PrivateKey & priv) {
   const KeyParameters & params = priv.GetParameters();
   assert(params == ptx.GetParameters());
   assert(params == ctx.GetParameters());
 
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
-  ZZ_pX secret = conv<ZZ_pX>(priv.GetSecret());
+  const RingContext<uint64_t> & ring = params.GetRing();
+  const Poly<uint64_t> & secret = priv.GetSecret();
 
   // m = c0 + c1 * s + c2 * s^2 + ...
-  ZZ_pX m;
-  ZZ_pX buffer0;
-  ZZ_pX buffer1;
-  for (long i = 0; i < ctx.GetLength(); i++) {
-    PowerMod(buffer0, secret, i, params.GetPolyModulus());
-    MulMod(buffer1, conv<ZZ_pX>(ctx[i]), buffer0, params.GetPolyModulus());
-    m += buffer1;
+  // The powers of s are built up incrementally (in the same domain as s) rather than recomputed for each term
+  thread_local DecryptionBuffers buffers;
+  Poly<uint64_t> & m = buffers.m;
+  Poly<uint64_t> & power = buffers.power;
+  Poly<uint64_t> & buffer = buffers.buffer;
+  m = ctx[0];
+  power = secret;
+  for (long i = 1; i < ctx.GetLength(); i++) {
+    ring.Multiply(buffer, ctx[i], power);
+    ring.Add(m, m, buffer);
+
+    if (i + 1 < ctx.GetLength()) {
+      ring.Multiply(power, power, secret);
+    }
   }
 
   // Downscale m to be in plaintext ring
-  ZZX message = conv<ZZX>(m);
-  CenterPoly(message, message, params.GetCoeffModulus());
-  RoundPoly(message, message, params.GetPlainModulus(), params.GetCoeffModulus(), params.GetPlainModulus());  
+  uint64_t t = (uint64_t) to_ulong(params.GetPlainModulus());
+  RoundPoly(m, m, t, ring.GetModulus(), t);
 
-  ptx.SetMessage(message);
+  conv(buffers.message, m);
+  ptx.SetMessage(buffers.message);
 }
 
 Ciphertext fv::Encrypt(const Plaintext & ptx, const PublicKey & pub) {
@@ -80,6 +157,16 @@ Ciphertext fv::Encrypt(const Plaintext & ptx, const PublicKey & pub) {
   return ctx;
 }
 
+std::vector<Ciphertext> fv::EncryptBatch(const std::vector<Plaintext> & ptxs, const PublicKey & pub) {
+  std::vector<Ciphertext> ctxs;
+  ctxs.reserve(ptxs.size());
+  for (size_t i = 0; i < ptxs.size(); i++) {
+    ctxs.push_back(Ciphertext(pub.GetParameters()));
+  }
+  EncryptBatch(ctxs.data(), ptxs.data(), ptxs.size(), pub);
+  return ctxs;
+}
+
 Plaintext fv::Decrypt(const Ciphertext & ctx, const PrivateKey & priv) {
   Plaintext ptx(priv.GetParameters());
   Decrypt(ptx, ctx, priv);
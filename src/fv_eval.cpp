@@ -1,104 +1,72 @@
 #include "fv.h"
-#include "polyutil.h"
 
 #include <cassert>
 
+using namespace rlwe;
 using namespace rlwe::fv;
 
 Ciphertext & Ciphertext::Negate() {
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+  const RingContext<uint64_t> & ring = params->GetRing();
 
-  Vec<ZZX> c_new;
-  c_new.SetLength(c.length());
   for (long index = 0; index < c.length(); index++) {
-    ZZ_pX inverted = -conv<ZZ_pX>(c[index]);
-    c_new[index] = conv<ZZX>(inverted);
+    ring.Negate(c[index], c[index]);
   }
 
-  this->c = c_new;
-
   return *this; 
 }
 
-Ciphertext & Ciphertext::operator+= (const Ciphertext & ct) {
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+void fv::Add(Ciphertext & out, const Ciphertext & a, const Ciphertext & b) {
+  assert(*a.params == *b.params);
+  const RingContext<uint64_t> & ring = a.params->GetRing();
 
   // Find minimum and maximum lengths of ciphertexts
-  long minlen;
-  long maxlen;
-  if (c.length() < ct.c.length()) {
-    minlen = c.length();
-    maxlen = ct.c.length();
-  }
-  else {
-    minlen = ct.c.length();
-    maxlen = c.length();
+  const Ciphertext & longer = a.c.length() < b.c.length() ? b : a;
+  long minlen = a.c.length() < b.c.length() ? a.c.length() : b.c.length();
+  long maxlen = longer.c.length();
+
+  // Any terms that we can't add, we just copy over (the output's existing polynomials are reused)
+  out.params = a.params;
+  out.c.SetLength(maxlen);
+  for (long index = minlen; index < maxlen; index++) {
+    out.c[index] = longer.c[index];
   }
-  const Vec<ZZX> & longer = c.length() > ct.c.length() ? c : ct.c;
-
-  // Set up vector for new ciphertext
-  Vec<ZZX> c_new;
-  c_new.SetLength(maxlen);
-  long index = 0;
 
   // Add together any terms we can 
-  for (;index < minlen; index++) {
-    ZZ_pX c0 = conv<ZZ_pX>(c[index]);
-    ZZ_pX c1 = conv<ZZ_pX>(ct.c[index]);
-
-    c_new[index] = conv<ZZX>(c0 + c1);
+  for (long index = 0; index < minlen; index++) {
+    ring.Add(out.c[index], a.c[index], b.c[index]);
   }
+}
 
-  // Any terms that we can't add, we just copy over
-  for (;index < maxlen; index++) {
-    c_new[index] = longer[index];
-  }
+void fv::Multiply(Ciphertext & out, const Ciphertext & a, const Ciphertext & b) {
+  assert(*a.params == *b.params);
+  const KeyParameters & params = *a.params;
 
-  this->c = c_new;
+  // The tensor product is computed exactly in the ring's residues and downscaled by t / q to get rid of extra message scaling
+  // Both inputs are consumed before the output is written, so it may alias either of them
+  out.params = a.params;
+  params.GetRing().TensorScaleRound(out.c, a.c, b.c, (uint64_t) to_ulong(params.GetPlainModulus()));
+}
 
+Ciphertext & Ciphertext::operator+= (const Ciphertext & ct) {
+  Add(*this, *this, ct);
   return *this; 
 }
 
 Ciphertext & Ciphertext::operator*= (const Ciphertext & ct) {
-  // Get ciphertext sizes
-  long j = c.length() - 1;
-  long k = ct.c.length() - 1;
-
-  // Set up a buffer for storing MulMods and a buffer for storing the poly modulus
-  ZZX buffer = ZZX::zero();
-  ZZX tmp_modulus = conv<ZZX>(params.GetPolyModulus().val()); 
-
-  // Create the resultant ciphertext vector
-  Vec<ZZX> c_new; 
-  c_new.SetLength(j + k + 1);
-
-  for (long m = 0; m < c_new.length(); m++) {
-    // Calculate sum of multiplied ciphertext terms 
-    ZZX sum = ZZX::zero();
-    for (long r = 0; r <= m; r++) {
-      long s = m - r;
-      if (r <= j && s <= k) {
-        MulMod(buffer, c[r], ct.c[s], tmp_modulus);
-        sum += buffer;
-      }
-    }
-
-    // Perform downscale to get rid of extra message scaling 
-    RoundPoly(sum, sum, params.GetPlainModulus(), params.GetCoeffModulus(), params.GetCoeffModulus());
-
-    // Add sum to ciphertext
-    c_new[m] = sum;
-  }
-
-  this->c = c_new;
-
+  Multiply(*this, *this, ct);
   return *this; 
 }
 
+// Scratch polynomials that each thread reuses across relinearizations
+struct RelinearizationBuffers {
+  Poly<uint64_t> ck;
+  Poly<uint64_t> decomposition;
+  Poly<uint64_t> decomposition_hat;
+  Poly<uint64_t> buffer;
+  Poly<uint64_t> sum0;
+  Poly<uint64_t> sum1;
+};
+
 Ciphertext & Ciphertext::Relinearize(const EvaluationKey & elk) {
   if (c.length() <= 2) {
     return *this;
@@ -107,39 +75,51 @@ Ciphertext & Ciphertext::Relinearize(const EvaluationKey & elk) {
   long k = c.length() - 1; 
   assert(elk.GetLevel() == k);
 
-  Vec<ZZX> c_new;
-  c_new.SetLength(k);
-
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
-  ZZ_pX c0_addition;
-  ZZ_pX c1_addition;
-  ZZ_pX buffer;
-
-  ZZX ck = c[k];
-  ZZX decomposition; 
+  const RingContext<uint64_t> & ring = params->GetRing();
+  size_t n = params->GetPolyModulusDegree();
+  uint32_t log_w = params->GetDecompositionBitCount();
+  uint64_t w_mask = log_w >= 64 ? ~((uint64_t) 0) : ((uint64_t) 1 << log_w) - 1;
+
+  thread_local RelinearizationBuffers buffers;
+  Poly<uint64_t> & ck = buffers.ck;
+  Poly<uint64_t> & decomposition = buffers.decomposition;
+  Poly<uint64_t> & decomposition_hat = buffers.decomposition_hat;
+  Poly<uint64_t> & buffer = buffers.buffer;
+  ck = c[k];
+  decomposition.SetLength(n);
+  decomposition.SetDomain(COEFFICIENT_DOMAIN);
+
+  // The evaluation key is kept in the evaluation domain, so the products are summed up there and only brought back once
+  Poly<uint64_t> & sum0 = buffers.sum0;
+  Poly<uint64_t> & sum1 = buffers.sum1;
+
+  for (long i = 0; i <= params->GetDecompositionTermCount(); i++) {
+    // Peel the next base-w digit off of every coefficient in c_k
+    for (size_t j = 0; j < n; j++) {
+      decomposition[j] = ck[j] & w_mask;
+      ck[j] = log_w >= 64 ? 0 : ck[j] >> log_w;
+    }
+    ring.ToEvaluationDomain(decomposition_hat, decomposition);
 
-  for (long i = 0; i <= params.GetDecompositionTermCount(); i++) {
-    for (long j = 0; j <= deg(ck); j++) {
-      SetCoeff(decomposition, j, ck[j] & params.GetDecompositionBitMask());
-      SetCoeff(ck, j, ck[j] >>= params.GetDecompositionBitCount());
+    if (i == 0) {
+      ring.Multiply(sum0, elk[i].a, decomposition_hat);
+      ring.Multiply(sum1, elk[i].b, decomposition_hat);
+      continue;
     }
 
-    MulMod(buffer, conv<ZZ_pX>(elk[i].a), conv<ZZ_pX>(decomposition), params.GetPolyModulus());
-    c0_addition += buffer;
+    ring.Multiply(buffer, elk[i].a, decomposition_hat);
+    ring.Add(sum0, sum0, buffer);
 
-    MulMod(buffer, conv<ZZ_pX>(elk[i].b), conv<ZZ_pX>(decomposition), params.GetPolyModulus());
-    c1_addition += buffer;
+    ring.Multiply(buffer, elk[i].b, decomposition_hat);
+    ring.Add(sum1, sum1, buffer);
   }
 
-  c_new[0] = conv<ZZX>(conv<ZZ_pX>(c[0]) + c0_addition);
-  c_new[1] = conv<ZZX>(conv<ZZ_pX>(c[1]) + c1_addition);
-  for (long i = 2; i < k; i++) {
-    c_new[i] = c[i];
-  }
+  ring.ToCoefficientDomain(sum0, sum0);
+  ring.Add(c[0], c[0], sum0);
+  ring.ToCoefficientDomain(sum1, sum1);
+  ring.Add(c[1], c[1], sum1);
 
-  this->c = c_new;
+  c.SetLength(k);
 
   return *this;
 }
@@ -8,111 +8,119 @@ using namespace rlwe::fv;
 
 void fv::GeneratePrivateKey(PrivateKey & priv) {
   const KeyParameters & params = priv.GetParameters();
-  priv.SetSecret(UniformSample(params.GetPolyModulusDegree(), ZZ(-1), ZZ(2)));
+
+  // Draw s from uniform distribution over {-1, 0, 1}
+  Poly<uint64_t> s;
+  UniformSample(s, params.GetPolyModulusDegree(), -1, 2, params.GetRing().GetModulus());
+
+  // The secret is only ever multiplied with, so it is stored in the evaluation domain
+  params.GetRing().ToEvaluationDomain(s, s);
+  priv.SetSecret(s);
 }
 
 void fv::GeneratePublicKey(PublicKey & pub, const PrivateKey & priv) {
   const KeyParameters & params = priv.GetParameters();
   assert(params == pub.GetParameters());
   
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+  const RingContext<uint64_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
 
   // Generate a uniformly
-  ZZX a = UniformSample(params.GetPolyModulusDegree(), params.GetCoeffModulus());
-  ZZ_pX a_p = conv<ZZ_pX>(a);
+  Poly<uint64_t> a;
+  UniformSample(a, n, ring.GetModulus());
 
   // Sample e from a Gaussian distribution
-  ZZ_pX e_p = conv<ZZ_pX>(
-      KnuthYaoSample(params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), 
-        params.GetProbabilityMatrixRows()));
+  Poly<uint64_t> e;
+  params.GetGaussianSampler().Sample(e, n, ring.GetModulus());
 
-  // Copy private key parameters into polynomial over finite field
-  ZZ_pX s_p = conv<ZZ_pX>(priv.GetSecret());
-
-  // Compute b = -(a * s + e)
-  ZZ_pX b_p;
-  MulMod(b_p, a_p, s_p, params.GetPolyModulus()); 
-  b_p += e_p;
-  b_p = -b_p;
+  // Compute b = -(a * s + e) in the evaluation domain, which is where the public key is kept
+  ring.ToEvaluationDomain(a, a);
+  ring.ToEvaluationDomain(e, e);
+  Poly<uint64_t> b;
+  ring.Multiply(b, a, priv.GetSecret()); 
+  ring.Add(b, b, e);
+  ring.Negate(b, b);
 
   // Create public key based off of a & b polynomials
-  pub.SetValues(conv<ZZX>(b_p), a);
+  pub.SetValues(b, a);
 }
 
 void fv::GeneratePublicKey(PublicKey & pub, const PrivateKey & priv, const ZZX & a, const ZZX & e) { 
   const KeyParameters & params = priv.GetParameters();
   assert(params == pub.GetParameters());
 
-  // Set finite field modulus to be q
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+  const RingContext<uint64_t> & ring = params.GetRing();
 
-  // a is given; just copy it into a ZZ_pX object
-  ZZ_pX a_p = conv<ZZ_pX>(a);
+  // a is given; just reduce it into the ring
+  Poly<uint64_t> a_q;
+  ring.Reduce(a_q, a);
+  ring.ToEvaluationDomain(a_q, a_q);
 
   // Do the same with e
-  ZZ_pX e_p = conv<ZZ_pX>(e);
-
-  // Copy private key parameters into polynomial over finite field
-  ZZ_pX s_p = conv<ZZ_pX>(priv.GetSecret());
+  Poly<uint64_t> e_q;
+  ring.Reduce(e_q, e);
+  ring.ToEvaluationDomain(e_q, e_q);
 
   // Compute b = -(a * s + e)
-  ZZ_pX b_p;
-  MulMod(b_p, a_p, s_p, params.GetPolyModulus()); 
-  b_p += e_p;
-  b_p = -b_p;
+  Poly<uint64_t> b;
+  ring.Multiply(b, a_q, priv.GetSecret()); 
+  ring.Add(b, b, e_q);
+  ring.Negate(b, b);
 
   // Create public key based off of a & b polynomials
-  pub.SetValues(conv<ZZX>(b_p), a);
+  pub.SetValues(b, a_q);
 }
 
 void fv::GenerateEvaluationKey(EvaluationKey & elk, const PrivateKey & priv, long level) {
   const KeyParameters & params = priv.GetParameters();
   assert(params == elk.GetParameters()); 
 
-  // Set finite field modulus to be q 
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
-  // Copy private key parameters into polynomial over finite field
-  ZZ_pX s = conv<ZZ_pX>(priv.GetSecret());
-
-  // Compute s^(level)
-  ZZ_pX s_level;
-  PowerMod(s_level, s, level, params.GetPolyModulus());
+  const RingContext<uint64_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint64_t q = ring.GetModulus();
+  const Poly<uint64_t> & s = priv.GetSecret();
+
+  // Compute s^(level), staying in the evaluation domain throughout
+  Poly<uint64_t> s_level(n);
+  s_level[0] = 1;
+  ring.ToEvaluationDomain(s_level, s_level);
+  for (long i = 0; i < level; i++) {
+    ring.Multiply(s_level, s_level, s);
+  }
 
   // Set up evaluation key 
   elk.SetLevel(level);
   elk.SetLength(params.GetDecompositionTermCount() + 1);
 
   // Create temporary base
-  ZZ_p tmp_w(1);
+  uint64_t tmp_w = 1 % q;
+  uint64_t w = (uint64_t) to_ulong(params.GetDecompositionBase() % params.GetCoeffModulus());
 
+  Poly<uint64_t> buffer;
   for (long i = 0; i <= params.GetDecompositionTermCount(); i++) {
     // Compute a, where the coefficients are drawn uniformly from the finite field (integers mod q) 
-    ZZ_pX a = conv<ZZ_pX>(
-        UniformSample(params.GetPolyModulusDegree(), params.GetCoeffModulus()));
+    Poly<uint64_t> a;
+    UniformSample(a, n, q);
+    ring.ToEvaluationDomain(a, a);
 
     // Draw error polynomial from discrete Gaussian distribution
-    ZZ_pX e = conv<ZZ_pX>(
-        KnuthYaoSample(params.GetPolyModulusDegree(), 
-          params.GetProbabilityMatrix(), 
-          params.GetProbabilityMatrixRows()));
-
-    // Compute b = -(a * s + e)
-    ZZ_pX b;
-    MulMod(b, a, s, params.GetPolyModulus()); 
-    b += e;
-    b = -b + tmp_w * s_level;
+    Poly<uint64_t> e;
+    params.GetGaussianSampler().Sample(e, n, q);
+    ring.ToEvaluationDomain(e, e);
+
+    // Compute b = -(a * s + e) + w^i * s^(level)
+    Poly<uint64_t> b;
+    ring.Multiply(b, a, s); 
+    ring.Add(b, b, e);
+    ring.Negate(b, b);
+    ring.MultiplyScalar(buffer, s_level, tmp_w);
+    ring.Add(b, b, buffer);
 
     // Save b, a as pair in evaluation key
-    elk[i] = Pair<ZZX, ZZX>(conv<ZZX>(b), conv<ZZX>(a)); 
+    elk[i] = Pair<Poly<uint64_t>, Poly<uint64_t>>(b, a); 
 
     // Right shift by the word size (e.g. multiply by the base)
-    tmp_w *= conv<ZZ_p>(params.GetDecompositionBase());
+    tmp_w = ModMul(tmp_w, w, q);
   }
 }
 
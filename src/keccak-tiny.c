@@ -78,6 +78,70 @@ static inline void keccakf(void* state) {
   }
 }
 
+void keccakf1600(uint64_t state[25]) {
+  keccakf(state);
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+
+/*** Keccak-f[1600] on four interleaved states, one per 64-bit AVX2 lane ***/
+#define rol4(x, s) _mm256_or_si256(_mm256_slli_epi64(x, s), _mm256_srli_epi64(x, 64 - (s)))
+
+__attribute__((target("avx2")))
+void keccakf1600x4_avx2(uint64_t states[100]) {
+  __m256i a[25];
+  __m256i b[5];
+  __m256i t;
+  for (int i = 0; i < 25; i++) {
+    a[i] = _mm256_loadu_si256((const __m256i*)(states + 4 * i));
+  }
+
+  for (int i = 0; i < 24; i++) {
+    // Theta
+    #pragma GCC unroll 5
+    for (int x = 0; x < 5; x++) {
+      b[x] = _mm256_xor_si256(_mm256_xor_si256(a[x], a[x + 5]),
+                              _mm256_xor_si256(_mm256_xor_si256(a[x + 10], a[x + 15]), a[x + 20]));
+    }
+    #pragma GCC unroll 5
+    for (int x = 0; x < 5; x++) {
+      t = _mm256_xor_si256(b[(x + 4) % 5], rol4(b[(x + 1) % 5], 1));
+      #pragma GCC unroll 5
+      for (int y = 0; y < 25; y += 5) {
+        a[y + x] = _mm256_xor_si256(a[y + x], t);
+      }
+    }
+    // Rho and pi
+    t = a[1];
+    #pragma GCC unroll 24
+    for (int x = 0; x < 24; x++) {
+      b[0] = a[pi[x]];
+      a[pi[x]] = rol4(t, rho[x]);
+      t = b[0];
+    }
+    // Chi
+    #pragma GCC unroll 5
+    for (int y = 0; y < 25; y += 5) {
+      #pragma GCC unroll 5
+      for (int x = 0; x < 5; x++) {
+        b[x] = a[y + x];
+      }
+      #pragma GCC unroll 5
+      for (int x = 0; x < 5; x++) {
+        a[y + x] = _mm256_xor_si256(b[x], _mm256_andnot_si256(b[(x + 1) % 5], b[(x + 2) % 5]));
+      }
+    }
+    // Iota
+    a[0] = _mm256_xor_si256(a[0], _mm256_set1_epi64x((long long)RC[i]));
+  }
+
+  for (int i = 0; i < 25; i++) {
+    _mm256_storeu_si256((__m256i*)(states + 4 * i), a[i]);
+  }
+}
+#endif
+
 /******** The FIPS202-defined functions. ********/
 
 /*** Some helper macros. ***/
@@ -161,3 +225,62 @@ defsha3(224)
 defsha3(256)
 defsha3(384)
 defsha3(512)
+
+/*** Incremental SHAKE ***/
+static void shake_init(keccak_state* state, size_t rate) {
+  memset(state->a, 0, Plen);
+  state->rate = rate;
+  state->pos = 0;
+  state->squeezing = 0;
+}
+
+void shake128_init(keccak_state* state) {
+  shake_init(state, SHAKE128_RATE);
+}
+
+void shake256_init(keccak_state* state) {
+  shake_init(state, SHAKE256_RATE);
+}
+
+void shake_absorb(keccak_state* state, const uint8_t* in, size_t inlen) {
+  uint8_t* a = (uint8_t*)state->a;
+  while (inlen > 0) {
+    size_t len = state->rate - state->pos;
+    len = inlen < len ? inlen : len;
+    xorin(a + state->pos, in, len);
+    state->pos += len;
+    in += len;
+    inlen -= len;
+    if (state->pos == state->rate) {
+      P(state->a);
+      state->pos = 0;
+    }
+  }
+}
+
+void shake_squeeze(keccak_state* state, uint8_t* out, size_t outlen) {
+  uint8_t* a = (uint8_t*)state->a;
+  if (!state->squeezing) {
+    // Xor in the DS and pad frame, then start squeezing from a fresh permutation.
+    a[state->pos] ^= 0x1f;
+    a[state->rate - 1] ^= 0x80;
+    state->pos = state->rate;
+    state->squeezing = 1;
+  }
+  while (outlen > 0) {
+    if (state->pos == state->rate) {
+      P(state->a);
+      state->pos = 0;
+    }
+    size_t len = state->rate - state->pos;
+    len = outlen < len ? outlen : len;
+    setout(a + state->pos, out, len);
+    state->pos += len;
+    out += len;
+    outlen -= len;
+  }
+}
+
+void shake_squeezeblocks(keccak_state* state, uint8_t* out, size_t nblocks) {
+  shake_squeeze(state, out, nblocks * state->rate);
+}
@@ -0,0 +1,105 @@
+#include "newhope.h"
+
+#include <string.h>
+
+using namespace rlwe;
+using namespace rlwe::newhope;
+
+bool SeedCache::Lookup(Poly<uint32_t> & a, const uint8_t seed[SEED_BYTE_LENGTH]) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (capacity == 0) {
+    return false;
+  }
+
+  Seed key;
+  memcpy(key.data(), seed, SEED_BYTE_LENGTH);
+
+  auto found = index.find(key);
+  if (found == index.end()) {
+    misses++;
+    return false;
+  }
+
+  // Move the entry to the front of the list, which holds the most recently used
+  entries.splice(entries.begin(), entries, found->second);
+  a = found->second->second;
+  hits++;
+  return true;
+}
+
+void SeedCache::Insert(const uint8_t seed[SEED_BYTE_LENGTH], const Poly<uint32_t> & a) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (capacity == 0) {
+    return;
+  }
+
+  Seed key;
+  memcpy(key.data(), seed, SEED_BYTE_LENGTH);
+
+  // Another thread may have expanded the same seed in the meantime
+  auto found = index.find(key);
+  if (found != index.end()) {
+    entries.splice(entries.begin(), entries, found->second);
+    return;
+  }
+
+  // Evict from the back of the list, which holds the least recently used
+  if (entries.size() == capacity) {
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+  entries.emplace_front(key, a);
+  index[key] = entries.begin();
+}
+
+void SeedCache::SetCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->capacity = capacity;
+  while (entries.size() > capacity) {
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+void SeedCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  index.clear();
+}
+
+size_t SeedCache::GetCapacity() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return capacity;
+}
+
+size_t SeedCache::GetSize() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+size_t SeedCache::GetHitCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return hits;
+}
+
+size_t SeedCache::GetMissCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return misses;
+}
+
+void newhope::ExpandSeedUncached(Poly<uint32_t> & a, const KeyParameters & params, const uint8_t seed[SEED_BYTE_LENGTH]) {
+  // Parse seed into a polynomial, which is only ever multiplied with
+  const RingContext<uint32_t> & ring = params.GetRing();
+  Parse(a, params.GetPolyModulusDegree(), ring.GetModulus(), seed);
+  ring.Reduce(a, a);
+  ring.ToEvaluationDomain(a, a);
+}
+
+void newhope::ExpandSeed(Poly<uint32_t> & a, const KeyParameters & params, const uint8_t seed[SEED_BYTE_LENGTH]) {
+  SeedCache & cache = params.GetSeedCache();
+  if (cache.Lookup(a, seed)) {
+    return;
+  }
+  ExpandSeedUncached(a, params, seed);
+  cache.Insert(seed, a);
+}
@@ -7,36 +7,51 @@
 using namespace rlwe;
 using namespace rlwe::newhope;
 
+// Scratch polynomials that each thread reuses across key generations, so that reinitializing never allocates once warmed up
+struct ServerBuffers {
+  Poly<uint32_t> a;
+  Poly<uint32_t> s;
+  Poly<uint32_t> e;
+  Poly<uint32_t> b;
+};
+
+struct ClientBuffers {
+  Poly<uint32_t> s;
+  Poly<uint32_t> e1;
+  Poly<uint32_t> e2;
+};
+
 void newhope::Initialize(Server & server) {
   const KeyParameters & params = server.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
 
-  // Set global finite field
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
-  // Generate seed by getting randomness from /dev/urandom
+  // Generate seed from the (securely seeded) random stream
   uint8_t seed[SEED_BYTE_LENGTH];
-  randombytes_buf(seed, SEED_BYTE_LENGTH);
+  RandomStream::GetInstance().GetBytes(seed, SEED_BYTE_LENGTH);
 
-  // Parse seed into a polynomial
-  ZZX a;
-  Parse(a, params.GetPolyModulusDegree(), params.GetCoeffModulus(), seed);
-  ZZ_pX a_p = conv<ZZ_pX>(a);
+  // Parse seed into a polynomial (in the evaluation domain); the seed is fresh, so only clients ever find it cached
+  thread_local ServerBuffers buffers;
+  Poly<uint32_t> & a = buffers.a;
+  ExpandSeedUncached(a, params, seed);
 
-  // s <- Gaussian distribution
-  ZZX s = KnuthYaoSample(params.GetPolyModulusDegree(), 
-      params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows());
-  ZZ_pX s_p = conv<ZZ_pX>(s);
+  // s <- noise distribution (psi_16 by default)
+  Poly<uint32_t> & s = buffers.s;
+  params.GetGaussianSampler().Sample(s, n, q);
 
-  // e <- Gaussian distribution
-  ZZ_pX e_p = conv<ZZ_pX>(KnuthYaoSample(params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows()));
+  // e <- noise distribution
+  Poly<uint32_t> & e = buffers.e;
+  params.GetGaussianSampler().Sample(e, n, q);
+
+  // The secret is only ever multiplied with, so it is kept in the evaluation domain
+  ring.ToEvaluationDomain(s, s);
 
   // b = a * s + e
-  ZZ_pX b_p;
-  MulMod(b_p, a_p, s_p, params.GetPolyModulus());
-  b_p += e_p;
-  ZZX b = conv<ZZX>(b_p);
+  Poly<uint32_t> & b = buffers.b;
+  ring.Multiply(b, a, s);
+  ring.ToCoefficientDomain(b, b);
+  ring.Add(b, b, e);
 
   // Update the server object with the new keys
   server.SetSeed(seed);
@@ -46,24 +61,23 @@ void newhope::Initialize(Server & server) {
 
 void newhope::Initialize(Client & client) {
   const KeyParameters & params = client.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
+
+  // s <- noise distribution, kept in the evaluation domain since it is used in two products
+  thread_local ClientBuffers buffers;
+  Poly<uint32_t> & s = buffers.s;
+  params.GetGaussianSampler().Sample(s, n, q);
+  ring.ToEvaluationDomain(s, s);
+  client.SetSecretKey(s);
 
-  // s <- Gaussian distribution
-  client.SetSecretKey(
-      KnuthYaoSample(
-        params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), 
-        params.GetProbabilityMatrixRows()));
-
-  // e1, e2 <- Gaussian distribution 
-  client.SetErrors(
-      KnuthYaoSample(
-        params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), 
-        params.GetProbabilityMatrixRows()), 
-      KnuthYaoSample(
-        params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), 
-        params.GetProbabilityMatrixRows()));
+  // e1, e2 <- noise distribution 
+  Poly<uint32_t> & e1 = buffers.e1;
+  Poly<uint32_t> & e2 = buffers.e2;
+  params.GetGaussianSampler().Sample(e1, n, q);
+  params.GetGaussianSampler().Sample(e2, n, q);
+  client.SetErrors(e1, e2);
 }
 
 Server newhope::CreateServer(const KeyParameters & params) {
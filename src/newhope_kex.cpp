@@ -2,6 +2,7 @@
 #include "sample.h"
 #include "keccak-tiny.h"
 #include "polyutil.h"
+#include "parallel.h"
 
 #include <cassert>
 #include <sodium.h>
@@ -10,68 +11,85 @@ using namespace rlwe;
 using namespace rlwe::newhope;
 
 void newhope::WritePacket(Packet & packet, const Server & server) {
+  assert(packet.GetLength() >= server.GetParameters().GetServerPacketLength());
+  WritePacket(packet.GetBytes(), server);
+}
+
+size_t newhope::WritePacket(uint8_t * output, const Server & server) {
   const KeyParameters & params = server.GetParameters();
 
   // Copy the seed into the packet first
-  memcpy(packet.GetBytes(), server.GetSeed(), SEED_BYTE_LENGTH);
+  memcpy(output, server.GetSeed(), SEED_BYTE_LENGTH);
 
   // Encode the polynomial immediately after
-  CompressPoly(packet.GetBytes() + SEED_BYTE_LENGTH, NumBits(params.GetCoeffModulus()), server.GetPublicKey());
+  return SEED_BYTE_LENGTH + CompressPoly(output + SEED_BYTE_LENGTH, params.GetCoeffModulusBitLength(), server.GetPublicKey());
 }
 
 void newhope::ReadPacket(Client & client, const Packet & packet) {
-  const KeyParameters & params = client.GetParameters();
+  assert(packet.GetLength() >= client.GetParameters().GetServerPacketLength());
+  ReadPacket(client, packet.GetBytes());
+}
 
-  // Set global finite field
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+// Scratch polynomials for reading a server packet, which each thread reuses across packets
+struct EncodingBuffers {
+  Poly<uint32_t> b;
+  Poly<uint32_t> a;
+  Poly<uint32_t> u;
+  Poly<uint32_t> k;
+  Poly<uint32_t> c;
+  Poly<uint32_t> cc;
+};
+
+void newhope::ReadPacket(Client & client, const uint8_t * input) {
+  const KeyParameters & params = client.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
 
   // Copy the seed out of the packet
   uint8_t seed[SEED_BYTE_LENGTH];
-  memcpy(seed, packet.GetBytes(), SEED_BYTE_LENGTH);
+  memcpy(seed, input, SEED_BYTE_LENGTH);
 
   // Decode the compressed polynomial that follows the seed
-  ZZX b;
-  DecompressPoly(b, params.GetPolyModulusDegree(), packet.GetBytes() + SEED_BYTE_LENGTH, NumBits(params.GetCoeffModulus()));
+  thread_local EncodingBuffers buffers;
+  Poly<uint32_t> & b = buffers.b;
+  DecompressPoly(b, n, input + SEED_BYTE_LENGTH, params.GetCoeffModulusBitLength());
+  ring.Reduce(b, b);
 
-  // Parse seed into a polynomial 
-  ZZX a;
-  Parse(a, params.GetPolyModulusDegree(), params.GetCoeffModulus(), seed);
+  // Parse seed into a polynomial (in the evaluation domain), reusing it if the server's seed was seen before
+  Poly<uint32_t> & a = buffers.a;
+  ExpandSeed(a, params, seed);
 
-  // Convert ZZXs into their ZZ_pX equivalents
-  ZZ_pX a_p = conv<ZZ_pX>(a);
-  ZZ_pX b_p = conv<ZZ_pX>(b);
-  ZZ_pX s_p = conv<ZZ_pX>(client.GetSecretKey());
-  ZZ_pX e1_p = conv<ZZ_pX>(client.GetErrors().a);
-  ZZ_pX e2_p = conv<ZZ_pX>(client.GetErrors().b);
+  // Extract the client's secret & errors
+  const Poly<uint32_t> & s = client.GetSecretKey();
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & e = client.GetErrors();
 
   // u = a * s + e'
-  ZZ_pX u_p;
-  MulMod(u_p, a_p, s_p, params.GetPolyModulus());
-  u_p += e1_p;
-  ZZX u = conv<ZZX>(u_p);
+  Poly<uint32_t> & u = buffers.u;
+  ring.Multiply(u, a, s);
+  ring.ToCoefficientDomain(u, u);
+  ring.Add(u, u, e.a);
 
   // Generate client key randomly & securely 
   uint8_t v[SHARED_KEY_BYTE_LENGTH];
-  randombytes_buf(v, SHARED_KEY_BYTE_LENGTH);
+  RandomStream::GetInstance().GetBytes(v, SHARED_KEY_BYTE_LENGTH);
 
   // v' = SHA3-256(v)
   sha3_256(v, SHARED_KEY_BYTE_LENGTH, v, SHARED_KEY_BYTE_LENGTH);
 
   // k = NHSEncode(v')
-  ZZX k;
-  NHSEncode(k, v, params.GetCoeffModulus());
+  Poly<uint32_t> & k = buffers.k;
+  NHSEncode(k, v, q);
 
   // c = b * s + e'' + k
-  ZZ_pX c_p;
-  MulMod(c_p, b_p, s_p, params.GetPolyModulus());
-  c_p += e2_p;
-  c_p += conv<ZZ_pX>(k);
-  ZZX c = conv<ZZX>(c_p);
+  Poly<uint32_t> & c = buffers.c;
+  ring.Multiply(c, b, s);
+  ring.Add(c, c, e.b);
+  ring.Add(c, c, k);
 
   // cc = NHSCompress(c)
-  ZZX cc;
-  NHSCompress(cc, c, params.GetCoeffModulus());
+  Poly<uint32_t> & cc = buffers.cc;
+  NHSCompress(cc, c, q);
 
   // micro = SHA3-256(v')
   sha3_256(v, SHARED_KEY_BYTE_LENGTH, v, SHARED_KEY_BYTE_LENGTH);
@@ -83,84 +101,114 @@ void newhope::ReadPacket(Client & client, const Packet & packet) {
 }
 
 void newhope::WritePacket(Packet & packet, const Client & client) {
+  assert(packet.GetLength() >= client.GetParameters().GetClientPacketLength());
+  WritePacket(packet.GetBytes(), client);
+}
+
+size_t newhope::WritePacket(uint8_t * output, const Client & client) {
   const KeyParameters & params = client.GetParameters();
 
   // Encode the public key first
-  size_t ulen = CompressPoly(packet.GetBytes(), NumBits(params.GetCoeffModulus()), client.GetPublicKey());
+  size_t ulen = CompressPoly(output, params.GetCoeffModulusBitLength(), client.GetPublicKey());
 
   // Enocde the ciphertext next; since it is compressed, each coefficient only requires 3 bits
-  CompressPoly(packet.GetBytes() + ulen, 3, client.GetCiphertext()); 
+  return ulen + CompressPoly(output + ulen, CIPHERTEXT_COEFF_BIT_LENGTH, client.GetCiphertext()); 
 }
 
 void newhope::ReadPacket(Server & server, const Packet & packet) {
-  const KeyParameters & params = server.GetParameters();
+  assert(packet.GetLength() >= server.GetParameters().GetClientPacketLength());
+  ReadPacket(server, packet.GetBytes());
+}
+
+// Scratch polynomials for decoding a client packet, reused across the packets of a batch (or, on each thread, across single packets)
+struct DecodingBuffers {
+  Poly<uint32_t> u;
+  Poly<uint32_t> cc;
+  Poly<uint32_t> c;
+  Poly<uint32_t> k;
+};
 
-  // Set global finite field
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+static void DecodeWithBuffers(uint8_t v[SHARED_KEY_BYTE_LENGTH], const Server & server, const uint8_t * input, DecodingBuffers & buffers) {
+  const KeyParameters & params = server.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
 
   // Decode compressed public key 
-  ZZX u;
-  size_t ulen = DecompressPoly(u, params.GetPolyModulusDegree(), packet.GetBytes(), NumBits(params.GetCoeffModulus()));
+  Poly<uint32_t> & u = buffers.u;
+  size_t ulen = DecompressPoly(u, n, input, params.GetCoeffModulusBitLength());
+  ring.Reduce(u, u);
 
   // Decode doubly-compressed ciphertext 
-  ZZX cc;
-  DecompressPoly(cc, params.GetPolyModulusDegree(), packet.GetBytes() + ulen, 3);
+  Poly<uint32_t> & cc = buffers.cc;
+  DecompressPoly(cc, n, input + ulen, CIPHERTEXT_COEFF_BIT_LENGTH);
 
   // Decompress ciphertext
-  ZZX c;
-  NHSDecompress(c, cc, params.GetCoeffModulus());
-
-  // Convert ZZXs into their ZZ_pX equivalents
-  ZZ_pX u_p = conv<ZZ_pX>(u);
-  ZZ_pX c_p = conv<ZZ_pX>(c);
-  ZZ_pX s_p = conv<ZZ_pX>(server.GetSecretKey());
+  Poly<uint32_t> & c = buffers.c;
+  NHSDecompress(c, cc, q);
 
-  // k' = c' - u * s
-  ZZ_pX k_p;
-  MulMod(k_p, u_p, s_p, params.GetPolyModulus());
-  k_p *= -1;
-  k_p += c_p;
-  ZZX k = conv<ZZX>(k_p);
+  // k' = c' - u * s, where s is already in the evaluation domain and u is transformed in place
+  Poly<uint32_t> & k = buffers.k;
+  ring.ToEvaluationDomain(u, u);
+  ring.Multiply(k, u, server.GetSecretKey());
+  ring.ToCoefficientDomain(k, k);
+  ring.Subtract(k, c, k);
 
   // v' = NHSDecode(k')
-  uint8_t v[SHARED_KEY_BYTE_LENGTH];
-  NHSDecode(v, k, params.GetCoeffModulus());
+  NHSDecode(v, k, q);
 
   // micro = SHA3-256(v')
   sha3_256(v, SHARED_KEY_BYTE_LENGTH, v, SHARED_KEY_BYTE_LENGTH);
+}
+
+void newhope::ReadPacket(Server & server, const uint8_t * input) {
+  thread_local DecodingBuffers buffers;
+  uint8_t v[SHARED_KEY_BYTE_LENGTH];
+  DecodeWithBuffers(v, server, input, buffers);
 
   // Update client object with the shared key 
   server.SetSharedKey(v);
 }
 
-Packet newhope::CreatePacket(const Server & server) {
-  const KeyParameters & params = server.GetParameters();
+void newhope::ReadPacketBatch(uint8_t * shared_keys, const Server & server, const uint8_t * const * inputs, size_t count) {
+  // Clients are independent, so each thread takes a contiguous range of packets and reuses its buffers across them
+  ThreadPool::GetInstance().ParallelFor(count, [&](size_t begin, size_t end) {
+    DecodingBuffers buffers;
+    for (size_t i = begin; i < end; i++) {
+      DecodeWithBuffers(shared_keys + i * SHARED_KEY_BYTE_LENGTH, server, inputs[i], buffers);
+    }
+  });
+}
 
-  // Calculate number of bytes needed to represent public key 
-  size_t blen = params.GetPolyModulusDegree() * NumBits(params.GetCoeffModulus());
-  blen = (blen + 8 - 1) / 8;
+void newhope::ReadPacketBatch(uint8_t * shared_keys, const Server & server, const Packet * packets, size_t count) {
+  std::vector<const uint8_t *> inputs(count);
+  for (size_t i = 0; i < count; i++) {
+    assert(packets[i].GetLength() >= server.GetParameters().GetClientPacketLength());
+    inputs[i] = packets[i].GetBytes();
+  }
+  ReadPacketBatch(shared_keys, server, inputs.data(), count);
+}
 
+std::vector<SharedKey> newhope::ReadPacketBatch(const Server & server, const std::vector<Packet> & packets) {
+  static_assert(sizeof(SharedKey) == SHARED_KEY_BYTE_LENGTH, "shared keys must be stored back to back");
+  std::vector<SharedKey> shared_keys(packets.size());
+  if (!packets.empty()) {
+    ReadPacketBatch(shared_keys[0].data(), server, packets.data(), packets.size());
+  }
+  return shared_keys;
+}
+
+Packet newhope::CreatePacket(const Server & server) {
   // Allocate packet on the heap and write to it
-  Packet packet(SEED_BYTE_LENGTH + blen);
+  Packet packet(server.GetParameters().GetServerPacketLength());
   WritePacket(packet, server);
 
   return packet;
 }
 
 Packet newhope::CreatePacket(const Client & client) {
-  const KeyParameters & params = client.GetParameters();
-
-  // Calculate number of bytes needed to represent public key 
-  size_t ulen = params.GetPolyModulusDegree() * NumBits(params.GetCoeffModulus());
-  ulen = (ulen + 8 - 1) / 8;
-  
-  // Calculate number of bytes needed to represent compressed ciphertext
-  size_t clen = params.GetPolyModulusDegree() * 3;
-  clen = (clen + 8 - 1) / 8;
-
   // Allocate packet on the heap and write to it
-  Packet packet(ulen + clen);
+  Packet packet(client.GetParameters().GetClientPacketLength());
   WritePacket(packet, client);
 
   return packet;
@@ -13,25 +13,13 @@ KeyParameters::KeyParameters(size_t n, const ZZ & q) :
   KeyParameters(n, q, DEFAULT_ERROR_STANDARD_DEVIATION) {}
 
 KeyParameters::KeyParameters(size_t n, const ZZ & q, float sigma) : 
-  n(n), q(q), sigma(sigma) {
+  KeyParameters(n, q, sigma, DEFAULT_GAUSSIAN_SAMPLER) {}
+
+KeyParameters::KeyParameters(size_t n, const ZZ & q, float sigma, GaussianSamplerType sampler_type) : 
+  n(n), q(q), sigma(sigma), q_bit_length(NumBits(q)), ring(n, q), seed_cache(DEFAULT_SEED_CACHE_CAPACITY) {
   // Assert that n is even, assume that it is a power of 2
   assert(n % 2 == 0);
 
-  // Doesn't matter what this is, since the max coefficient is 1 for the cyclotomic polynomial
-  ZZ_pPush push;
-  ZZ_p::init(q);
-
-  // Create a cyclotomic polynomial that serves as the modulus for the ring
-  ZZ_pX cyclotomic;
-
-  // The cyclotomic polynomial is x^n + 1 
-  SetCoeff(cyclotomic, n, 1);
-  SetCoeff(cyclotomic, 0, 1);
-
-  // Build the modulus using the cyclotomic polynomial representation
-  build(phi, cyclotomic);
-
-  // Generate probability matrix
-  pmat_rows = sigma * PROBABILITY_MATRIX_BOUNDS_SCALAR;
-  pmat = KnuthYaoGaussianMatrix(pmat_rows, sigma); 
+  // Build the error sampler (e.g. the Knuth-Yao probability matrix)
+  sampler = GaussianSampler::Create(sampler_type, sigma);
 }
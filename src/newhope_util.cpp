@@ -1,119 +1,220 @@
 #include "newhope.h"
 #include "keccak-tiny.h"
+#include "simd.h"
+#include "trace.h"
+
+#include <cassert>
+#include <string.h>
 
 using namespace rlwe;
 using namespace rlwe::newhope;
 
-void newhope::Parse(ZZX & a, size_t len, const ZZ & q, const uint8_t seed[SEED_BYTE_LENGTH]) {
-  clear(a);
-
-  // Generate an initial SHAKE-128 output that can be grown later
-  size_t outlen = len % 2 == 0 ? len * 3 : len * 3 + 1;
-  uint8_t * output = (uint8_t *) malloc(outlen * sizeof(uint8_t));
-  shake128(output, outlen, seed, SEED_BYTE_LENGTH);
-
-  size_t counter = 0;
-  ZZ q5 = 5 * q;
-  for (size_t idx = 0; idx < len; idx++) {
-    while (1) {
-      // Sample a 16-bit integer from the SHAKE-128 output
-      uint16_t coeff = (output[counter] << 8) | output[counter + 1];
-      counter += 2;
-
-      // If we have exhausted our SHAKE-128 output, simply regrow it 
-      if (counter == outlen) {
-        outlen += 128;
-        output = (uint8_t *) realloc(output, outlen);
-        shake128(output, outlen, seed, SEED_BYTE_LENGTH);
+// Copies the coefficients of an integer polynomial into words, padding with zeros up to the given length
+static void ToWords(Poly<uint32_t> & result, const ZZX & poly, size_t len) {
+  size_t polylen = deg(poly) + 1;
+  result.SetLength(polylen > len ? polylen : len);
+  result.Clear();
+  for (size_t i = 0; i < polylen; i++) {
+    result[i] = (uint32_t) to_ulong(coeff(poly, i));
+  }
+}
+
+// Rejection samples coefficients from one block of SHAKE-128 output, where each candidate is a big-endian 16-bit integer
+// Only candidates less than 5 * q are accepted; returns the number of coefficients filled in so far
+static size_t ParseBlock(uint32_t * a, size_t idx, size_t len, const uint8_t block[SHAKE128_RATE], uint32_t q5) {
+  size_t start = idx;
+  size_t pos = 0;
+  for (; pos < SHAKE128_RATE && idx < len; pos += 2) {
+    uint32_t coeff = (block[pos] << 8) | block[pos + 1];
+    a[idx] = coeff;
+    idx += coeff < q5;
+  }
+  RLWE_TRACE_COUNT(COUNTER_PARSE_ACCEPTED, idx - start);
+  RLWE_TRACE_COUNT(COUNTER_PARSE_REJECTED, pos / 2 - (idx - start));
+  return idx;
+}
+
+void newhope::Parse(Poly<uint32_t> & a, size_t len, uint32_t q, const uint8_t seed[SEED_BYTE_LENGTH]) {
+  RLWE_TRACE_SCOPE(STAGE_SHAKE);
+  a.SetLength(len);
+  a.SetDomain(COEFFICIENT_DOMAIN);
+
+  // Squeeze SHAKE-128 one block at a time until every coefficient has been accepted
+  keccak_state state;
+  shake128_init(&state);
+  shake_absorb(&state, seed, SEED_BYTE_LENGTH);
+
+  uint8_t block[SHAKE128_RATE];
+  size_t idx = 0;
+  while (idx < len) {
+    shake_squeezeblocks(&state, block, 1);
+    idx = ParseBlock(a.GetData(), idx, len, block, 5 * q);
+  }
+}
+
+void newhope::ParseBatch(Poly<uint32_t> * as, const uint8_t * seeds, size_t count, size_t len, uint32_t q) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    RLWE_TRACE_SCOPE(STAGE_SHAKE);
+
+    // Absorb & pad each seed into its own lane of four interleaved SHAKE-128 states
+    uint64_t states[100] = {0};
+    for (size_t k = 0; k < 4; k++) {
+      for (size_t w = 0; w < SEED_BYTE_LENGTH / 8; w++) {
+        uint64_t word;
+        memcpy(&word, seeds + (i + k) * SEED_BYTE_LENGTH + 8 * w, 8);
+        states[4 * w + k] ^= word;
       }
+      states[4 * (SEED_BYTE_LENGTH / 8) + k] ^= 0x1f;
+      states[4 * (SHAKE128_RATE / 8 - 1) + k] ^= 0x8000000000000000ULL;
+      as[i + k].SetLength(len);
+      as[i + k].SetDomain(COEFFICIENT_DOMAIN);
+    }
 
-      // Only accept coefficients less than 5 * q
-      if (coeff < q5) {
-        SetCoeff(a, idx, coeff);
-        break;
+    // Squeeze all four streams together until each polynomial is full
+    size_t idx[4] = {0, 0, 0, 0};
+    uint8_t block[SHAKE128_RATE];
+    while (idx[0] < len || idx[1] < len || idx[2] < len || idx[3] < len) {
+      simd::KeccakF1600x4(states);
+      for (size_t k = 0; k < 4; k++) {
+        for (size_t w = 0; w < SHAKE128_RATE / 8; w++) {
+          memcpy(block + 8 * w, &states[4 * w + k], 8);
+        }
+        idx[k] = ParseBlock(as[i + k].GetData(), idx[k], len, block, 5 * q);
       }
     }
   }
 
-  // Free our output array
-  free(output);
+  // Any remaining seeds are expanded on their own
+  for (; i < count; i++) {
+    Parse(as[i], len, q, seeds + i * SEED_BYTE_LENGTH);
+  }
 }
 
-size_t newhope::CompressPoly(uint8_t * output, size_t coeff_bit_length, const ZZX & poly) {
-  size_t i = 0; // Keeps track of what output byte we are on
-  size_t bitpos = 0; // Keeps track of the bit position in the output byte
+void newhope::Parse(ZZX & a, size_t len, const ZZ & q, const uint8_t seed[SEED_BYTE_LENGTH]) {
+  Poly<uint32_t> words;
+  Parse(words, len, (uint32_t) to_ulong(q), seed);
+  conv(a, words);
+}
 
-  // Read each coefficient in order, starting with x^0, then x^1, x^2, etc.
-  for (size_t j = 0; j <= deg(poly); j++) {
-    ZZ c = coeff(poly, j);
+// Reverses the bits within every byte of a word
+// Packed bits fill each byte starting from its most significant bit, so this turns a little-endian bit stream into the wire format
+static inline uint64_t ReverseByteBits(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return x;
+}
 
-    // Loop through each bit in the coefficient starting with the LSB
-    for (size_t k = 0; k < coeff_bit_length; k++) {
-      // The mask is going to be a 1 bit in the position we want to edit
-      uint8_t mask = 1 << (7 - bitpos++);
+// Packs the low bits of each coefficient, starting with x^0 and the LSB of each, 32 bits at a time
+// A nonzero BITS fixes the width at compile time; otherwise it is given at run time
+template <size_t BITS>
+static size_t PackBits(uint8_t * output, const uint32_t * coeffs, size_t len, size_t bits = BITS) {
+  const size_t width = BITS ? BITS : bits;
+  const uint32_t mask = (uint32_t) ((1ULL << width) - 1);
+
+  uint64_t acc = 0;
+  size_t filled = 0;
+  size_t i = 0;
+  for (size_t j = 0; j < len; j++) {
+    acc |= (uint64_t) (coeffs[j] & mask) << filled;
+    filled += width;
+    if (filled >= 32) {
+      uint64_t word = ReverseByteBits(acc);
+      output[i] = (uint8_t) word;
+      output[i + 1] = (uint8_t) (word >> 8);
+      output[i + 2] = (uint8_t) (word >> 16);
+      output[i + 3] = (uint8_t) (word >> 24);
+      i += 4;
+      acc >>= 32;
+      filled -= 32;
+    }
+  }
+
+  // Flush the remaining bits, zeroing the unused end of the last byte
+  acc = ReverseByteBits(acc);
+  for (; filled > 0; filled = filled > 8 ? filled - 8 : 0) {
+    output[i++] = (uint8_t) acc;
+    acc >>= 8;
+  }
+  return i;
+}
 
-      // Set the bit in the output byte using the mask
-      if (bit(c, k)) {
-        output[i] |= mask;
+// Inverse of PackBits, reading 32 bits at a time while they remain
+template <size_t BITS>
+static size_t UnpackBits(uint32_t * coeffs, size_t len, const uint8_t * input, size_t bits = BITS) {
+  const size_t width = BITS ? BITS : bits;
+  const uint32_t mask = (uint32_t) ((1ULL << width) - 1);
+  const size_t total = (len * width + 7) / 8;
+
+  uint64_t acc = 0;
+  size_t filled = 0;
+  size_t i = 0;
+  for (size_t j = 0; j < len; j++) {
+    if (filled < width) {
+      if (i + 4 <= total) {
+        uint64_t word = (uint64_t) input[i] | ((uint64_t) input[i + 1] << 8) | 
+          ((uint64_t) input[i + 2] << 16) | ((uint64_t) input[i + 3] << 24);
+        acc |= ReverseByteBits(word) << filled;
+        i += 4;
+        filled += 32;
       }
       else {
-        output[i] &= ~mask;
-      }
-
-      // If the bit position is 8, we move to the next byte
-      if (bitpos == 8) {
-        i++;
-        bitpos = 0; 
+        for (; filled < width; filled += 8) {
+          acc |= ReverseByteBits(input[i++]) << filled;
+        }
       }
     }
+    coeffs[j] = (uint32_t) acc & mask;
+    acc >>= width;
+    filled -= width;
   }
-
-  return i == 0 && bitpos == 0 ? 0 : (bitpos == 0 ? i : i + 1);
+  return total;
 }
 
-size_t newhope::DecompressPoly(ZZX & poly, size_t polylen, const uint8_t * output, size_t coeff_bit_length) {
-  clear(poly);
-
-  size_t i = 0; // Keeps track of what output byte we are on
-  size_t bitpos = 0; // Keeps track of the bit position in the output byte
-
-  // Write each coefficient in order, starting with x^0, then x^1, x^2, etc.
-  for (size_t j = 0; j < polylen; j++) {
-    ZZ c;
-    ZZ r;
-
-    // Loop through bits in little endian fashion 
-    for (size_t _ = 0; _ < coeff_bit_length; _++) {
-      // Extract the bit from the output byte
-      uint8_t byte = output[i];
-      uint8_t bit = (byte >> (7 - bitpos++)) & 1;
-
-      // Right shift coefficient to make room for new bit
-      c <<= 1;
-      c |= bit;
-
-      // If the bit position is 8, we move to the next byte
-      if (bitpos == 8) {
-        i++;
-        bitpos = 0;
-      }
-    }
+size_t newhope::CompressPoly(uint8_t * output, size_t coeff_bit_length, const Poly<uint32_t> & poly) {
+  // The packet widths get kernels of their own so that the shifts are known at compile time
+  switch (coeff_bit_length) {
+    case 14:
+      return PackBits<14>(output, poly.GetData(), poly.GetLength());
+    case 3:
+      return PackBits<3>(output, poly.GetData(), poly.GetLength());
+    default:
+      return PackBits<0>(output, poly.GetData(), poly.GetLength(), coeff_bit_length);
+  }
+}
 
-    for (size_t k = 0; k < coeff_bit_length; k++) {
-      r <<= 1;
-      r |= bit(c, k);
-    }
+size_t newhope::CompressPoly(uint8_t * output, size_t coeff_bit_length, const ZZX & poly) {
+  Poly<uint32_t> words;
+  ToWords(words, poly, 0);
+  return CompressPoly(output, coeff_bit_length, words);
+}
 
-    SetCoeff(poly, j, r);
+size_t newhope::DecompressPoly(Poly<uint32_t> & poly, size_t polylen, const uint8_t * output, size_t coeff_bit_length) {
+  poly.SetLength(polylen);
+  poly.SetDomain(COEFFICIENT_DOMAIN);
+  switch (coeff_bit_length) {
+    case 14:
+      return UnpackBits<14>(poly.GetData(), polylen, output);
+    case 3:
+      return UnpackBits<3>(poly.GetData(), polylen, output);
+    default:
+      return UnpackBits<0>(poly.GetData(), polylen, output, coeff_bit_length);
   }
+}
 
-  return i == 0 && bitpos == 0 ? 0 : (bitpos == 0 ? i : i + 1);
+size_t newhope::DecompressPoly(ZZX & poly, size_t polylen, const uint8_t * output, size_t coeff_bit_length) {
+  Poly<uint32_t> words;
+  size_t bytes = DecompressPoly(words, polylen, output, coeff_bit_length);
+  conv(poly, words);
+  return bytes;
 }
 
-void newhope::NHSEncode(ZZX & k, const uint8_t v[SHARED_KEY_BYTE_LENGTH], const ZZ & q) {
-  clear(k);
+void newhope::NHSEncode(Poly<uint32_t> & k, const uint8_t v[SHARED_KEY_BYTE_LENGTH], uint32_t q) {
+  // Every bit of the key is spread across four coefficients
+  k.SetLength(SHARED_KEY_BYTE_LENGTH * 8 * 4);
 
-  ZZ q2 = q / 2;
+  uint32_t q2 = q / 2;
 
   // Loop through each byte
   for (size_t i = 0; i < SHARED_KEY_BYTE_LENGTH; i++) {
@@ -124,29 +225,31 @@ void newhope::NHSEncode(ZZX & k, const uint8_t v[SHARED_KEY_BYTE_LENGTH], const
       size_t b = i * 8 + j;
 
       // Set floor(q / 2) as coefficient if bit is 1, otherwise 0 is coefficient 
-      if ((byte >> (7 - j)) & 1) {
-        SetCoeff(k, b, q2);
-        SetCoeff(k, b + 256, q2);
-        SetCoeff(k, b + 512, q2);
-        SetCoeff(k, b + 768, q2);
-      }
-      else {
-        SetCoeff(k, b, 0);
-        SetCoeff(k, b + 256, 0);
-        SetCoeff(k, b + 512, 0);
-        SetCoeff(k, b + 768, 0);
-      }
+      uint32_t c = ((byte >> (7 - j)) & 1) ? q2 : 0;
+      k[b] = c;
+      k[b + 256] = c;
+      k[b + 512] = c;
+      k[b + 768] = c;
     }
   }
 }
 
-void newhope::NHSDecode(uint8_t v[SHARED_KEY_BYTE_LENGTH], const ZZX & k, const ZZ & q) {
-  ZZ q2 = q / 2;
+void newhope::NHSEncode(ZZX & k, const uint8_t v[SHARED_KEY_BYTE_LENGTH], const ZZ & q) {
+  Poly<uint32_t> words;
+  NHSEncode(words, v, (uint32_t) to_ulong(q));
+  conv(k, words);
+}
+
+void newhope::NHSDecode(uint8_t v[SHARED_KEY_BYTE_LENGTH], const Poly<uint32_t> & k, uint32_t q) {
+  assert(k.GetLength() >= SHARED_KEY_BYTE_LENGTH * 8 * 4);
+
+  int32_t q2 = q / 2;
   for (size_t i = 0; i < 256; i++) {
     // t = sum(v[i + 256 * j] - floor(q / 2)] 
-    ZZ t; 
+    uint32_t t = 0; 
     for (size_t j = 0; j < 4; j++) {
-      t += abs(coeff(k, i + 256 * j) - q2);
+      int32_t diff = (int32_t) k[i + 256 * j] - q2;
+      t += diff < 0 ? -diff : diff;
     }
 
     // If t < q, then set bit to 1, otherwise set bit to 0
@@ -160,21 +263,40 @@ void newhope::NHSDecode(uint8_t v[SHARED_KEY_BYTE_LENGTH], const ZZX & k, const
   }
 }
 
-void newhope::NHSCompress(ZZX & cc, const ZZX & c, const ZZ & q) {
-  clear(cc);
+void newhope::NHSDecode(uint8_t v[SHARED_KEY_BYTE_LENGTH], const ZZX & k, const ZZ & q) {
+  Poly<uint32_t> words;
+  ToWords(words, k, SHARED_KEY_BYTE_LENGTH * 8 * 4);
+  NHSDecode(v, words, (uint32_t) to_ulong(q));
+}
+
+void newhope::NHSCompress(Poly<uint32_t> & cc, const Poly<uint32_t> & c, uint32_t q) {
+  cc.SetLength(c.GetLength());
 
-  ZZ q2 = q / 2;
-  for (size_t i = 0; i <= deg(c); i++) {
-    ZZ z = (coeff(c, i) * 8 + q2) / q;
-    SetCoeff(cc, i, z % 8);
+  uint32_t q2 = q / 2;
+  for (size_t i = 0; i < c.GetLength(); i++) {
+    uint64_t z = ((uint64_t) c[i] * 8 + q2) / q;
+    cc[i] = (uint32_t) (z % 8);
   }
 }
 
-void newhope::NHSDecompress(ZZX & c, const ZZX & cc, const ZZ & q) {
-  clear(c);
+void newhope::NHSCompress(ZZX & cc, const ZZX & c, const ZZ & q) {
+  Poly<uint32_t> words;
+  ToWords(words, c, 0);
+  NHSCompress(words, words, (uint32_t) to_ulong(q));
+  conv(cc, words);
+}
+
+void newhope::NHSDecompress(Poly<uint32_t> & c, const Poly<uint32_t> & cc, uint32_t q) {
+  c.SetLength(cc.GetLength());
 
-  for (size_t i = 0; i <= deg(cc); i++) {
-    ZZ z = (coeff(cc, i) * q + 4) / 8;
-    SetCoeff(c, i, z);
+  for (size_t i = 0; i < cc.GetLength(); i++) {
+    c[i] = (uint32_t) (((uint64_t) cc[i] * q + 4) / 8);
   }
 }
+
+void newhope::NHSDecompress(ZZX & c, const ZZX & cc, const ZZ & q) {
+  Poly<uint32_t> words;
+  ToWords(words, cc, 0);
+  NHSDecompress(words, words, (uint32_t) to_ulong(q));
+  conv(c, words);
+}
@@ -0,0 +1,230 @@
+#include "ntt.h"
+#include "pool.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace rlwe;
+
+template <typename T>
+T rlwe::ModPow(T base, uint64_t exponent, T q) {
+  T result = 1 % q;
+  base %= q;
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result = ModMul(result, base, q);
+    }
+    base = ModMul(base, base, q);
+    exponent >>= 1;
+  }
+  return result;
+}
+
+template <typename T>
+T rlwe::ModInv(T a, T q) {
+  // Fermat's little theorem, since q is always prime here
+  return ModPow(a, (uint64_t) q - 2, q);
+}
+
+// Deterministic Miller-Rabin test; the bases used here are sufficient for any 64-bit integer
+template <typename T>
+bool rlwe::IsPrime(T q) {
+  static const uint32_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+  if (q < 2) {
+    return false;
+  }
+  for (uint32_t base : bases) {
+    if (q % base == 0) {
+      return q == base;
+    }
+  }
+
+  // Write q - 1 = d * 2^r with d odd
+  T d = q - 1;
+  int r = 0;
+  while (d % 2 == 0) {
+    d /= 2;
+    r++;
+  }
+
+  for (uint32_t base : bases) {
+    T x = ModPow((T) base, d, q);
+    if (x == 1 || x == q - 1) {
+      continue;
+    }
+
+    bool witness = true;
+    for (int i = 1; i < r && witness; i++) {
+      x = ModMul(x, x, q);
+      if (x == q - 1) {
+        witness = false;
+      }
+    }
+    if (witness) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Reverses the lowest `bits` bits of the given index
+static size_t BitReverse(size_t index, size_t bits) {
+  size_t reversed = 0;
+  for (size_t i = 0; i < bits; i++) {
+    reversed = (reversed << 1) | ((index >> i) & 1);
+  }
+  return reversed;
+}
+
+template <typename T>
+bool NTT<T>::IsSupported(size_t n, T q) {
+  // n must be a power of 2
+  if (n < 2 || (n & (n - 1)) != 0) {
+    return false;
+  }
+
+  // Leave two bits of headroom so that sums of reduced coefficients never overflow
+  if (q >> (8 * sizeof(T) - 2) != 0) {
+    return false;
+  }
+
+  // A primitive 2n-th root of unity exists only if 2n divides q - 1
+  return q % (2 * n) == 1 && IsPrime(q);
+}
+
+template <typename T>
+NTT<T>::NTT(size_t n, T q) : n(n), q(q) {
+  assert(IsSupported(n, q));
+
+  // Find a primitive 2n-th root of unity psi, which satisfies psi^n = -1
+  T psi = 0;
+  for (T g = 2; g < q; g++) {
+    psi = ModPow(g, ((uint64_t) q - 1) / (2 * n), q);
+    if (ModPow(psi, n, q) == q - 1) {
+      break;
+    }
+  }
+  T psi_inv = ModInv(psi, q);
+
+  size_t logn = 0;
+  while (((size_t) 1 << logn) < n) {
+    logn++;
+  }
+
+  // The tables are as large as a polynomial, so they come from the pool too (and can be backed by huge pages)
+  roots = (T *) pool::Allocate(n * sizeof(T));
+  roots_precomp = (T *) pool::Allocate(n * sizeof(T));
+  inv_roots = (T *) pool::Allocate(n * sizeof(T));
+  inv_roots_precomp = (T *) pool::Allocate(n * sizeof(T));
+
+  // Store the powers of psi and psi^-1 in bit-reversed order, which is the order the butterflies consume them in
+  T power = 1;
+  T inv_power = 1;
+  for (size_t i = 0; i < n; i++) {
+    size_t j = BitReverse(i, logn);
+    roots[j] = power;
+    roots_precomp[j] = ModMulPrecompute(power, q);
+    inv_roots[j] = inv_power;
+    inv_roots_precomp[j] = ModMulPrecompute(inv_power, q);
+    power = ModMul(power, psi, q);
+    inv_power = ModMul(inv_power, psi_inv, q);
+  }
+
+  n_inv = ModInv((T) (n % q), q);
+  n_inv_precomp = ModMulPrecompute(n_inv, q);
+}
+
+template <typename T>
+NTT<T>::~NTT() {
+  pool::Release(roots, n * sizeof(T));
+  pool::Release(roots_precomp, n * sizeof(T));
+  pool::Release(inv_roots, n * sizeof(T));
+  pool::Release(inv_roots_precomp, n * sizeof(T));
+}
+
+template <typename T>
+void NTT<T>::Forward(T * values) const {
+  // Cooley-Tukey butterflies; the psi twist is merged into the twiddle factors
+  size_t t = n;
+  for (size_t m = 1; m < n; m <<= 1) {
+    t >>= 1;
+    for (size_t i = 0; i < m; i++) {
+      T w = roots[m + i];
+      T w_precomp = roots_precomp[m + i];
+      T * x = values + 2 * i * t;
+      T * y = x + t;
+      for (size_t j = 0; j < t; j++) {
+        T u = x[j];
+        T v = ModMulShoup(y[j], w, w_precomp, q);
+        x[j] = ModAdd(u, v, q);
+        y[j] = ModSub(u, v, q);
+      }
+    }
+  }
+}
+
+template <typename T>
+void NTT<T>::Inverse(T * values) const {
+  // Gentleman-Sande butterflies, undoing the forward transform level by level
+  size_t t = 1;
+  for (size_t m = n; m > 1; m >>= 1) {
+    size_t h = m >> 1;
+    for (size_t i = 0; i < h; i++) {
+      T w = inv_roots[h + i];
+      T w_precomp = inv_roots_precomp[h + i];
+      T * x = values + 2 * i * t;
+      T * y = x + t;
+      for (size_t j = 0; j < t; j++) {
+        T u = x[j];
+        T v = y[j];
+        x[j] = ModAdd(u, v, q);
+        y[j] = ModMulShoup(ModSub(u, v, q), w, w_precomp, q);
+      }
+    }
+    t <<= 1;
+  }
+
+  // Scale everything by n^-1
+  for (size_t i = 0; i < n; i++) {
+    values[i] = ModMulShoup(values[i], n_inv, n_inv_precomp, q);
+  }
+}
+
+template <typename T>
+void NTT<T>::PointwiseMultiply(T * result, const T * a, const T * b) const {
+  for (size_t i = 0; i < n; i++) {
+    result[i] = ModMul(a[i], b[i], q);
+  }
+}
+
+template <typename T>
+void NTT<T>::Multiply(T * result, const T * a, const T * b) const {
+  // Copy both operands out first, since the result may alias them
+  // The copies go into per-thread scratch that only ever grows, so repeated products of one length never allocate
+  thread_local std::vector<T> buffer;
+  if (buffer.size() < 2 * n) {
+    buffer.resize(2 * n);
+  }
+  T * a_hat = buffer.data();
+  T * b_hat = a_hat + n;
+  memcpy(a_hat, a, n * sizeof(T));
+  memcpy(b_hat, b, n * sizeof(T));
+
+  Forward(a_hat);
+  Forward(b_hat);
+  PointwiseMultiply(result, a_hat, b_hat);
+  Inverse(result);
+}
+
+// Only 32-bit and 64-bit coefficient words are supported
+template uint32_t rlwe::ModPow<uint32_t>(uint32_t, uint64_t, uint32_t);
+template uint64_t rlwe::ModPow<uint64_t>(uint64_t, uint64_t, uint64_t);
+template uint32_t rlwe::ModInv<uint32_t>(uint32_t, uint32_t);
+template uint64_t rlwe::ModInv<uint64_t>(uint64_t, uint64_t);
+template bool rlwe::IsPrime<uint32_t>(uint32_t);
+template bool rlwe::IsPrime<uint64_t>(uint64_t);
+template class rlwe::NTT<uint32_t>;
+template class rlwe::NTT<uint64_t>;
@@ -0,0 +1,120 @@
+#include "parallel.h"
+
+#include <cassert>
+
+using namespace rlwe;
+
+// Set while a thread is running chunks of a loop, so that nested loops don't wait on themselves
+static thread_local bool in_pool = false;
+
+ThreadPool::ThreadPool(size_t thread_count) : stopping(false) {
+  // The calling thread counts as one of the threads
+  for (size_t i = 1; i < thread_count; i++) {
+    workers.push_back(std::thread(&ThreadPool::Work, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_ready.notify_all();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+void ThreadPool::Work() {
+  in_pool = true;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (1) {
+    task_ready.wait(lock, [&] { return stopping || !loops.empty(); });
+    if (stopping) {
+      return;
+    }
+    RunChunks(*loops.front(), lock);
+  }
+}
+
+void ThreadPool::RunChunks(Loop & loop, std::unique_lock<std::mutex> & lock) {
+  while (loop.next_chunk < loop.chunk_count) {
+    // Claim the next chunk, taking the loop off the queue once nothing is left to claim
+    size_t chunk = loop.next_chunk++;
+    if (loop.next_chunk == loop.chunk_count) {
+      for (std::deque<Loop *>::iterator it = loops.begin(); it != loops.end(); ++it) {
+        if (*it == &loop) {
+          loops.erase(it);
+          break;
+        }
+      }
+    }
+    size_t begin = chunk * loop.count / loop.chunk_count;
+    size_t end = (chunk + 1) * loop.count / loop.chunk_count;
+
+    // Run it without holding the lock, keeping any exception for the calling thread instead of letting it escape
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      (*loop.body)(begin, end);
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    if (error && !loop.error) {
+      loop.error = error;
+    }
+    // The calling thread may return (and the loop go away) as soon as the last chunk is counted
+    if (--loop.remaining_chunks == 0) {
+      task_done.notify_all();
+      return;
+    }
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t, size_t)> & body) {
+  RunLoop(count, count < GetThreadCount() ? count : GetThreadCount(), body);
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain_size, const std::function<void(size_t, size_t)> & body) {
+  assert(grain_size > 0);
+  RunLoop(count, GetThreadCount() > 1 ? (count + grain_size - 1) / grain_size : 1, body);
+}
+
+void ThreadPool::RunLoop(size_t count, size_t chunks, const std::function<void(size_t, size_t)> & body) {
+  if (chunks <= 1 || in_pool) {
+    if (count > 0) {
+      body(0, count);
+    }
+    return;
+  }
+
+  Loop loop;
+  loop.body = &body;
+  loop.count = count;
+  loop.chunk_count = chunks;
+  loop.next_chunk = 0;
+  loop.remaining_chunks = chunks;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  loops.push_back(&loop);
+  task_ready.notify_all();
+
+  // Help out with this loop (and only this one), then wait for any of its chunks still running on the workers
+  in_pool = true;
+  RunChunks(loop, lock);
+  in_pool = false;
+  task_done.wait(lock, [&] { return loop.remaining_chunks == 0; });
+  lock.unlock();
+
+  if (loop.error) {
+    std::rethrow_exception(loop.error);
+  }
+}
+
+ThreadPool & ThreadPool::GetInstance() {
+  static ThreadPool pool(std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1);
+  return pool;
+}
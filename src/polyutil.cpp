@@ -1,6 +1,10 @@
 #include "polyutil.h"
+#include "ntt.h"
+#include "simd.h"
+#include "trace.h"
 
 void rlwe::RoundPoly(ZZX & result, const ZZX & poly, const ZZ & scalar, const ZZ & divisor, const ZZ & mod) {
+  RLWE_TRACE_SCOPE(STAGE_ROUND);
   ZZ div2 = divisor / 2;
   for (long i = 0; i <= deg(poly); i++) {
     // See https://stackoverflow.com/questions/2422712/rounding-integer-division-instead-of-truncating 
@@ -53,3 +57,85 @@ bool rlwe::IsInRange(const ZZX & poly, const ZZ & lower, const ZZ & upper) {
   // All coefficients passed their respective checks 
   return 1;
 }
+
+// Computes floor(num / d) from a floating-point estimate of the quotient, which is then corrected exactly
+// This avoids a double-width division for every coefficient whenever the quotient is small enough to estimate
+template <typename W>
+static inline W DivideEstimated(W num, W d, double reciprocal) {
+  double estimate = (double) num * reciprocal;
+  if (estimate >= 4503599627370496.0) {
+    return num / d;
+  }
+
+  W z = (W) (uint64_t) estimate;
+  W product = z * d;
+  while (product > num) {
+    z--;
+    product -= d;
+  }
+  while (num - product >= d) {
+    z++;
+    product += d;
+  }
+  return z;
+}
+
+template <typename T>
+void rlwe::RoundPoly(Poly<T> & result, const Poly<T> & poly, T scalar, T divisor, T mod) {
+  RLWE_TRACE_SCOPE(STAGE_ROUND);
+  typedef typename WideWord<T>::Type W;
+
+  T div2 = divisor / 2;
+  double divisor_reciprocal = 1.0 / (double) divisor;
+  double mod_reciprocal = 1.0 / (double) mod;
+  result.SetLength(poly.GetLength());
+  for (size_t i = 0; i < poly.GetLength(); i++) {
+    T c = poly[i];
+    if (c <= div2) {
+      // Non-negative coefficients round the same way as above
+      W z = DivideEstimated((W) c * scalar + div2, (W) divisor, divisor_reciprocal);
+      result[i] = (T) (z - DivideEstimated(z, (W) mod, mod_reciprocal) * mod);
+    }
+    else {
+      // For negative coefficients, floor((-m + div2) / divisor) = -floor((m + divisor - 1 - div2) / divisor)
+      W m = (W) (divisor - c) * scalar;
+      W z = DivideEstimated(m + (divisor - 1 - div2), (W) divisor, divisor_reciprocal);
+      T r = (T) (z - DivideEstimated(z, (W) mod, mod_reciprocal) * mod);
+      result[i] = r == 0 ? 0 : mod - r;
+    }
+  }
+}
+
+template <typename T>
+void rlwe::RightShiftPoly(Poly<T> & result, const Poly<T> & poly, unsigned long bits) {
+  result.SetLength(poly.GetLength());
+  simd::RightShift(result.GetData(), poly.GetData(), poly.GetLength(), bits);
+}
+
+template <typename T>
+void rlwe::AndPoly(Poly<T> & result, const Poly<T> & poly, T bitmask) {
+  result.SetLength(poly.GetLength());
+  simd::And(result.GetData(), poly.GetData(), poly.GetLength(), bitmask);
+}
+
+template <typename T>
+bool rlwe::IsInRange(const Poly<T> & poly, T lower, T upper) {
+  return simd::IsInRange(poly.GetData(), poly.GetLength(), lower, upper);
+}
+
+template <typename T>
+bool rlwe::IsInCenteredRange(const Poly<T> & poly, T bound, T mod) {
+  return simd::IsInCenteredRange(poly.GetData(), poly.GetLength(), bound, mod);
+}
+
+// Only 32-bit and 64-bit coefficient words are supported
+template void rlwe::RoundPoly<uint32_t>(Poly<uint32_t> &, const Poly<uint32_t> &, uint32_t, uint32_t, uint32_t);
+template void rlwe::RoundPoly<uint64_t>(Poly<uint64_t> &, const Poly<uint64_t> &, uint64_t, uint64_t, uint64_t);
+template void rlwe::RightShiftPoly<uint32_t>(Poly<uint32_t> &, const Poly<uint32_t> &, unsigned long);
+template void rlwe::RightShiftPoly<uint64_t>(Poly<uint64_t> &, const Poly<uint64_t> &, unsigned long);
+template void rlwe::AndPoly<uint32_t>(Poly<uint32_t> &, const Poly<uint32_t> &, uint32_t);
+template void rlwe::AndPoly<uint64_t>(Poly<uint64_t> &, const Poly<uint64_t> &, uint64_t);
+template bool rlwe::IsInRange<uint32_t>(const Poly<uint32_t> &, uint32_t, uint32_t);
+template bool rlwe::IsInRange<uint64_t>(const Poly<uint64_t> &, uint64_t, uint64_t);
+template bool rlwe::IsInCenteredRange<uint32_t>(const Poly<uint32_t> &, uint32_t, uint32_t);
+template bool rlwe::IsInCenteredRange<uint64_t>(const Poly<uint64_t> &, uint64_t, uint64_t);
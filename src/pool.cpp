@@ -0,0 +1,174 @@
+#include "pool.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/mman.h>
+
+using namespace rlwe;
+
+static std::atomic<size_t> huge_page_threshold(0);
+
+// Free blocks of one size, of which at most limit are kept
+struct SizeClass {
+  size_t bytes;
+  size_t limit;
+  std::vector<void *> blocks;
+};
+
+// Free blocks held by one thread, given back to the system when the thread exits
+struct ThreadCache {
+  std::vector<SizeClass> classes;
+
+  ~ThreadCache();
+
+  SizeClass & GetClass(size_t bytes) {
+    // Only a handful of sizes (one per polynomial width and degree in use) ever show up, so a linear scan is enough
+    for (SizeClass & size_class : classes) {
+      if (size_class.bytes == bytes) {
+        return size_class;
+      }
+    }
+    classes.push_back(SizeClass());
+    SizeClass & size_class = classes.back();
+    size_class.bytes = bytes;
+    size_class.limit = POOL_BLOCK_LIMIT;
+    size_class.blocks.reserve(POOL_BLOCK_LIMIT);
+    return size_class;
+  }
+};
+
+// Set once the calling thread's cache has been destroyed; blocks released after that (e.g. by other thread-local
+// objects being torn down) go straight back to the system
+static thread_local bool cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  for (SizeClass & size_class : classes) {
+    for (void * block : size_class.blocks) {
+      free(block);
+    }
+  }
+  cache_destroyed = true;
+}
+
+static ThreadCache * GetThreadCache() {
+  if (cache_destroyed) {
+    return NULL;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+// Rounds a byte length up to a whole number of aligned units, which is also the size class the block belongs to
+static size_t GetBlockLength(size_t bytes) {
+  return (bytes + POOL_BYTE_ALIGNMENT - 1) / POOL_BYTE_ALIGNMENT * POOL_BYTE_ALIGNMENT;
+}
+
+// Gets a new block from the system, which free() gives back no matter how it was aligned
+static void * AllocateFromSystem(size_t bytes) {
+  size_t threshold = huge_page_threshold.load(std::memory_order_relaxed);
+  if (threshold == 0 || bytes < threshold) {
+    return aligned_alloc(POOL_BYTE_ALIGNMENT, bytes);
+  }
+
+  // Cover whole huge pages, so that the advice applies to all of the block
+  size_t length = (bytes + POOL_HUGE_PAGE_BYTE_LENGTH - 1) / POOL_HUGE_PAGE_BYTE_LENGTH * POOL_HUGE_PAGE_BYTE_LENGTH;
+  void * block = NULL;
+  if (posix_memalign(&block, POOL_HUGE_PAGE_BYTE_LENGTH, length) != 0) {
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  // The advice is only a hint, so the block is still usable if the kernel turns it down
+  madvise(block, length, MADV_HUGEPAGE);
+#endif
+  return block;
+}
+
+void * pool::Allocate(size_t bytes) {
+  if (bytes == 0) {
+    return NULL;
+  }
+  bytes = GetBlockLength(bytes);
+
+  ThreadCache * cache = GetThreadCache();
+  if (cache) {
+    SizeClass & size_class = cache->GetClass(bytes);
+    if (!size_class.blocks.empty()) {
+      void * block = size_class.blocks.back();
+      size_class.blocks.pop_back();
+      return block;
+    }
+  }
+  return AllocateFromSystem(bytes);
+}
+
+void pool::Release(void * block, size_t bytes) {
+  if (!block) {
+    return;
+  }
+  bytes = GetBlockLength(bytes);
+
+  ThreadCache * cache = GetThreadCache();
+  if (cache) {
+    SizeClass & size_class = cache->GetClass(bytes);
+    if (size_class.blocks.size() < size_class.limit) {
+      size_class.blocks.push_back(block);
+      return;
+    }
+  }
+  free(block);
+}
+
+void pool::Reserve(size_t bytes, size_t count) {
+  ThreadCache * cache = GetThreadCache();
+  if (!cache || bytes == 0) {
+    return;
+  }
+
+  SizeClass & size_class = cache->GetClass(GetBlockLength(bytes));
+  if (size_class.limit < count) {
+    size_class.limit = count;
+    size_class.blocks.reserve(count);
+  }
+  while (size_class.blocks.size() < count) {
+    void * block = AllocateFromSystem(size_class.bytes);
+    if (!block) {
+      return;
+    }
+    size_class.blocks.push_back(block);
+  }
+}
+
+void pool::Clear() {
+  ThreadCache * cache = GetThreadCache();
+  if (!cache) {
+    return;
+  }
+  for (SizeClass & size_class : cache->classes) {
+    for (void * block : size_class.blocks) {
+      free(block);
+    }
+    size_class.blocks.clear();
+  }
+}
+
+size_t pool::GetFreeBlockCount() {
+  ThreadCache * cache = GetThreadCache();
+  if (!cache) {
+    return 0;
+  }
+  size_t count = 0;
+  for (const SizeClass & size_class : cache->classes) {
+    count += size_class.blocks.size();
+  }
+  return count;
+}
+
+void pool::SetHugePageThreshold(size_t bytes) {
+  huge_page_threshold.store(bytes, std::memory_order_relaxed);
+}
+
+size_t pool::GetHugePageThreshold() {
+  return huge_page_threshold.load(std::memory_order_relaxed);
+}
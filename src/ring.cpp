@@ -0,0 +1,378 @@
+#include "ring.h"
+#include "trace.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace rlwe;
+
+// Bits of slack in the RNS base for summing up to 2^RING_TENSOR_TERM_BIT_COUNT products in a tensor entry
+#define RING_TENSOR_TERM_BIT_COUNT 8
+
+// Calculates how many bits are needed to hold a sum of products of two centered polynomials in the ring
+static size_t TensorBitCount(size_t n, const ZZ & q) {
+  return 2 * NumBits(q) + NumBits((long) n) + RING_TENSOR_TERM_BIT_COUNT;
+}
+
+// Calculates how many bits the auxiliary primes of a full-RNS modulus need to hold such a sum once it is scaled by a word over q
+// Its centered coefficients then stay below a quarter of the auxiliary range, and so does the sum itself compared to the whole base
+template <typename T>
+static size_t ScaledTensorBitCount(size_t n, const ZZ & q) {
+  return NumBits(q) + NumBits((long) n) + RING_TENSOR_TERM_BIT_COUNT + 8 * sizeof(T);
+}
+
+// Per-thread scratch words for the RNS products below
+// The scratch only ever grows, so repeated products in the same ring never allocate
+static uint64_t * GetScratch(size_t len) {
+  thread_local std::vector<uint64_t> scratch;
+  if (scratch.size() < len) {
+    scratch.resize(len);
+  }
+  return scratch.data();
+}
+
+// Converts the modulus into a word, rejecting any modulus the word-based arithmetic can't hold
+// One bit of headroom is left so that the sum of two reduced coefficients never overflows
+template <typename T>
+static T ToWordModulus(const ZZ & q) {
+  if (q < 2 || NumBits(q) >= (long) (8 * sizeof(T))) {
+    throw std::invalid_argument("ring modulus q must lie in [2, 2^" + std::to_string(8 * sizeof(T) - 1) + ")");
+  }
+  return (T) to_ulong(q);
+}
+
+template <typename T>
+RingContext<T>::RingContext(size_t n, const ZZ & q) : n(n), q(ToWordModulus<T>(q)), q_zz(q) {
+  // The cyclotomic polynomial x^n + 1 serves as the modulus for the ring; it is kept over the integers, since
+  // its coefficients are the same no matter what q is
+  SetCoeff(phi, n, 1);
+  SetCoeff(phi, 0, 1);
+
+  // Ring multiplications go through the NTT whenever q is an NTT-friendly prime
+  ntt = NULL;
+  if (NTT<T>::IsSupported(n, this->q)) {
+    ntt = new NTT<T>(n, this->q);
+  }
+
+  // Products of NTT-friendly primes keep to their residues, and only arbitrary moduli need Garner's algorithm
+  rns_modulus = NULL;
+  rns = NULL;
+  if (RNSModulus::IsSupported(n, this->q, ScaledTensorBitCount<T>(n, q))) {
+    rns_modulus = new RNSModulus(n, this->q, ScaledTensorBitCount<T>(n, q));
+  }
+  else {
+    rns = new RNSBase(n, TensorBitCount(n, q));
+  }
+}
+
+template <typename T>
+RingContext<T>::~RingContext() {
+  delete ntt;
+  delete rns_modulus;
+  delete rns;
+}
+
+template <typename T>
+void RingContext<T>::Reduce(Poly<T> & result, const ZZX & poly) const {
+  RLWE_TRACE_SCOPE(STAGE_CONVERT);
+  result.SetLength(n);
+  result.SetDomain(COEFFICIENT_DOMAIN);
+  result.Clear();
+
+  // Coefficients past x^(n - 1) wrap around with a sign flip, since x^n = -1
+  for (long i = 0; i <= deg(poly); i++) {
+    // Reducing by a single-word modulus directly avoids building a temporary integer
+    T c = (T) rem(poly[i], (long) q);
+    size_t j = i % n;
+    if ((i / n) % 2 == 0) {
+      result[j] = ModAdd(result[j], c, q);
+    }
+    else {
+      result[j] = ModSub(result[j], c, q);
+    }
+  }
+}
+
+template <typename T>
+void RingContext<T>::Reduce(Poly<T> & result, const Poly<T> & poly) const {
+  assert(poly.GetLength() == n);
+  result.SetLength(n);
+  result.SetDomain(poly.GetDomain());
+  for (size_t i = 0; i < n; i++) {
+    result[i] = poly[i] % q;
+  }
+}
+
+template <typename T>
+void RingContext<T>::Center(ZZX & result, const Poly<T> & poly) const {
+  RLWE_TRACE_SCOPE(STAGE_CONVERT);
+  if (poly.GetDomain() == EVALUATION_DOMAIN) {
+    Poly<T> coeffs;
+    ToCoefficientDomain(coeffs, poly);
+    Center(result, coeffs);
+    return;
+  }
+
+  T center_point = q / 2;
+  result.SetLength(poly.GetLength());
+  for (size_t i = 0; i < poly.GetLength(); i++) {
+    // Convert any coefficients greater than the center point to their negative equivalent
+    if (poly[i] > center_point) {
+      conv(result[i], (unsigned long) (q - poly[i]));
+      NTL::negate(result[i], result[i]);
+    }
+    else {
+      conv(result[i], (unsigned long) poly[i]);
+    }
+  }
+  result.normalize();
+}
+
+template <typename T>
+void RingContext<T>::Lift(ZZX & result, const Poly<T> & poly) const {
+  RLWE_TRACE_SCOPE(STAGE_CONVERT);
+  if (poly.GetDomain() == EVALUATION_DOMAIN) {
+    Poly<T> coeffs;
+    ToCoefficientDomain(coeffs, poly);
+    conv(result, coeffs);
+  }
+  else {
+    conv(result, poly);
+  }
+}
+
+template <typename T>
+void RingContext<T>::ToEvaluationDomain(Poly<T> & result, const Poly<T> & poly) const {
+  RLWE_TRACE_SCOPE(STAGE_TRANSFORM);
+  assert(poly.GetLength() == n);
+  if (&result != &poly) {
+    result = poly;
+  }
+
+  // Rings without a transform only have the one domain
+  if (ntt && poly.GetDomain() == COEFFICIENT_DOMAIN) {
+    ntt->Forward(result.GetData());
+    result.SetDomain(EVALUATION_DOMAIN);
+  }
+}
+
+template <typename T>
+void RingContext<T>::ToCoefficientDomain(Poly<T> & result, const Poly<T> & poly) const {
+  RLWE_TRACE_SCOPE(STAGE_TRANSFORM);
+  assert(poly.GetLength() == n);
+  if (&result != &poly) {
+    result = poly;
+  }
+
+  if (poly.GetDomain() == EVALUATION_DOMAIN) {
+    ntt->Inverse(result.GetData());
+    result.SetDomain(COEFFICIENT_DOMAIN);
+  }
+}
+
+template <typename T>
+void RingContext<T>::Add(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const {
+  assert(a.GetLength() == n && b.GetLength() == n);
+  assert(a.GetDomain() == b.GetDomain());
+  result.SetLength(n);
+  result.SetDomain(a.GetDomain());
+  for (size_t i = 0; i < n; i++) {
+    result[i] = ModAdd(a[i], b[i], q);
+  }
+}
+
+template <typename T>
+void RingContext<T>::Subtract(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const {
+  assert(a.GetLength() == n && b.GetLength() == n);
+  assert(a.GetDomain() == b.GetDomain());
+  result.SetLength(n);
+  result.SetDomain(a.GetDomain());
+  for (size_t i = 0; i < n; i++) {
+    result[i] = ModSub(a[i], b[i], q);
+  }
+}
+
+template <typename T>
+void RingContext<T>::Negate(Poly<T> & result, const Poly<T> & a) const {
+  assert(a.GetLength() == n);
+  result.SetLength(n);
+  result.SetDomain(a.GetDomain());
+  for (size_t i = 0; i < n; i++) {
+    result[i] = a[i] == 0 ? 0 : q - a[i];
+  }
+}
+
+template <typename T>
+void RingContext<T>::Multiply(Poly<T> & result, const Poly<T> & a, const Poly<T> & b) const {
+  RLWE_TRACE_SCOPE(STAGE_RING_MULTIPLY);
+  assert(a.GetLength() == n && b.GetLength() == n);
+  result.SetLength(n);
+
+  if (ntt) {
+    if (a.GetDomain() == COEFFICIENT_DOMAIN && b.GetDomain() == COEFFICIENT_DOMAIN) {
+      ntt->Multiply(result.GetData(), a.GetData(), b.GetData());
+      result.SetDomain(COEFFICIENT_DOMAIN);
+      return;
+    }
+
+    // Only operands still in the coefficient domain need to be transformed
+    thread_local Poly<T> buffer;
+    const Poly<T> * a_hat = &a;
+    const Poly<T> * b_hat = &b;
+    if (a.GetDomain() == COEFFICIENT_DOMAIN) {
+      ToEvaluationDomain(buffer, a);
+      a_hat = &buffer;
+    }
+    else if (b.GetDomain() == COEFFICIENT_DOMAIN) {
+      ToEvaluationDomain(buffer, b);
+      b_hat = &buffer;
+    }
+    bool mixed = a_hat != &a || b_hat != &b;
+
+    ntt->PointwiseMultiply(result.GetData(), a_hat->GetData(), b_hat->GetData());
+    result.SetDomain(EVALUATION_DOMAIN);
+    if (mixed) {
+      ToCoefficientDomain(result, result);
+    }
+    return;
+  }
+
+  // Without a transform for q itself, multiply limb by limb when q is a product of NTT-friendly primes,
+  // and otherwise compute the product exactly over the integers using the RNS base and reduce it
+  const RNSBase & base = rns_modulus ? rns_modulus->GetModulusBase() : *rns;
+  size_t width = base.GetLength() * n;
+  uint64_t * a_rns = GetScratch(2 * width);
+  uint64_t * b_rns = a_rns + width;
+
+  base.Decompose(a_rns, a.GetData(), q);
+  base.Decompose(b_rns, b.GetData(), q);
+  base.Forward(a_rns);
+  base.Forward(b_rns);
+  base.PointwiseMultiply(a_rns, a_rns, b_rns);
+  base.Inverse(a_rns);
+  if (rns_modulus) {
+    rns_modulus->Compose(result.GetData(), a_rns);
+  }
+  else {
+    rns->Reduce(result.GetData(), a_rns, q);
+  }
+  result.SetDomain(COEFFICIENT_DOMAIN);
+}
+
+template <typename T>
+void RingContext<T>::MultiplyScalar(Poly<T> & result, const Poly<T> & a, T scalar) const {
+  assert(a.GetLength() == n);
+  result.SetLength(n);
+  result.SetDomain(a.GetDomain());
+  for (size_t i = 0; i < n; i++) {
+    result[i] = ModMul(a[i], scalar, q);
+  }
+}
+
+// Adds x_i to r_i, or subtracts it, over a contiguous run; both loops are simple enough to be vectorized
+template <typename T>
+static void AddRun(T * r, const T * x, size_t len, T q) {
+  for (size_t i = 0; i < len; i++) {
+    r[i] = ModAdd(r[i], x[i], q);
+  }
+}
+
+template <typename T>
+static void SubtractRun(T * r, const T * x, size_t len, T q) {
+  for (size_t i = 0; i < len; i++) {
+    r[i] = ModSub(r[i], x[i], q);
+  }
+}
+
+template <typename T>
+void RingContext<T>::Multiply(Poly<T> & result, const Poly<T> & a, const SparseTernaryPoly & c) const {
+  RLWE_TRACE_SCOPE(STAGE_RING_MULTIPLY);
+  assert(a.GetLength() == n && c.GetLength() == n);
+  assert(a.GetDomain() == COEFFICIENT_DOMAIN);
+
+  // The product is accumulated into result, so an aliased input has to be copied out first
+  if (&result == &a) {
+    thread_local Poly<T> copy;
+    copy = a;
+    Multiply(result, copy, c);
+    return;
+  }
+
+  result.SetLength(n);
+  result.SetDomain(COEFFICIENT_DOMAIN);
+  result.Clear();
+
+  // Each term x^j shifts a up by j; the top j coefficients wrap around to the bottom with a sign flip, since x^n = -1
+  T * r = result.GetData();
+  const T * x = a.GetData();
+  for (size_t t = 0; t < c.GetWeight(); t++) {
+    size_t j = c[t].index;
+    if (c[t].negative) {
+      SubtractRun(r + j, x, n - j, q);
+      AddRun(r, x + n - j, j, q);
+    }
+    else {
+      AddRun(r + j, x, n - j, q);
+      SubtractRun(r, x + n - j, j, q);
+    }
+  }
+}
+
+template <typename T>
+void RingContext<T>::TensorScaleRound(Vec<Poly<T>> & result, const Vec<Poly<T>> & a, const Vec<Poly<T>> & b, T scalar) const {
+  RLWE_TRACE_SCOPE(STAGE_RING_MULTIPLY);
+  long j = a.length() - 1;
+  long k = b.length() - 1;
+  assert(j >= 0 && k >= 0);
+  assert((j < k ? j : k) < (1L << RING_TENSOR_TERM_BIT_COUNT));
+
+  // The tensor product is computed in the extended base of the full-RNS modulus, or in the auxiliary base for arbitrary q
+  // Every input term is moved into the evaluation domain of each prime exactly once
+  const RNSBase & base = rns_modulus ? rns_modulus->GetExtendedBase() : *rns;
+  size_t width = base.GetLength() * n;
+  uint64_t * a_rns = GetScratch((j + k + 3) * width);
+  uint64_t * b_rns = a_rns + (j + 1) * width;
+  uint64_t * sum = b_rns + (k + 1) * width;
+  for (long r = 0; r <= j; r++) {
+    assert(a[r].GetLength() == n && a[r].GetDomain() == COEFFICIENT_DOMAIN);
+    base.Decompose(a_rns + r * width, a[r].GetData(), q);
+    base.Forward(a_rns + r * width);
+  }
+  for (long s = 0; s <= k; s++) {
+    assert(b[s].GetLength() == n && b[s].GetDomain() == COEFFICIENT_DOMAIN);
+    base.Decompose(b_rns + s * width, b[s].GetData(), q);
+    base.Forward(b_rns + s * width);
+  }
+
+  // The inputs are fully consumed at this point, so the result is free to alias them
+  result.SetLength(j + k + 1);
+  for (long m = 0; m <= j + k; m++) {
+    // Calculate sum of multiplied terms
+    memset(sum, 0, width * sizeof(uint64_t));
+    for (long r = 0; r <= m; r++) {
+      long s = m - r;
+      if (r <= j && s <= k) {
+        base.PointwiseMultiplyAdd(sum, a_rns + r * width, b_rns + s * width);
+      }
+    }
+
+    // Come back to the coefficient domain and downscale
+    base.Inverse(sum);
+    result[m].SetLength(n);
+    result[m].SetDomain(COEFFICIENT_DOMAIN);
+    if (rns_modulus) {
+      rns_modulus->ScaleRound(result[m].GetData(), sum, scalar);
+    }
+    else {
+      rns->ScaleRound(result[m].GetData(), sum, scalar, q);
+    }
+  }
+}
+
+// Only 32-bit and 64-bit coefficient words are supported
+template class rlwe::RingContext<uint32_t>;
+template class rlwe::RingContext<uint64_t>;
@@ -0,0 +1,528 @@
+#include "rns.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+using namespace rlwe;
+
+typedef unsigned __int128 uint128_t;
+
+// Multi-word integers are stored least significant word first and are only as wide as the base needs
+// Computes x = x * mul + add over len words, returning the carry out of the top word
+static uint64_t MulAddWords(uint64_t * x, size_t len, uint64_t mul, uint64_t add) {
+  uint64_t carry = add;
+  for (size_t i = 0; i < len; i++) {
+    uint128_t z = (uint128_t) x[i] * mul + carry;
+    x[i] = (uint64_t) z;
+    carry = (uint64_t) (z >> 64);
+  }
+  return carry;
+}
+
+// Computes x = y - x over len words, where y >= x
+static void ReverseSubtractWords(uint64_t * x, const uint64_t * y, size_t len) {
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < len; i++) {
+    uint64_t d = y[i] - x[i] - borrow;
+    borrow = (y[i] < x[i] || (y[i] == x[i] && borrow)) ? 1 : 0;
+    x[i] = d;
+  }
+}
+
+// Checks if x > y over len words
+static bool IsGreaterWords(const uint64_t * x, const uint64_t * y, size_t len) {
+  for (size_t i = len; i-- > 0;) {
+    if (x[i] != y[i]) {
+      return x[i] > y[i];
+    }
+  }
+  return false;
+}
+
+// Computes floor(x / d) in-place over len words, returning x mod d
+static uint64_t DivideWords(uint64_t * x, size_t len, uint64_t d) {
+  uint64_t remainder = 0;
+  for (size_t i = len; i-- > 0;) {
+    uint128_t z = ((uint128_t) remainder << 64) | x[i];
+    x[i] = (uint64_t) (z / d);
+    remainder = (uint64_t) (z % d);
+  }
+  return remainder;
+}
+
+// Computes x mod d over len words
+static uint64_t ModWords(const uint64_t * x, size_t len, uint64_t d) {
+  uint64_t remainder = 0;
+  for (size_t i = len; i-- > 0;) {
+    remainder = (uint64_t) ((((uint128_t) remainder << 64) | x[i]) % d);
+  }
+  return remainder;
+}
+
+// Walks down through the candidates p = 1 mod 2n below 2^RNS_PRIME_BIT_COUNT, skipping any excluded primes, until the
+// product of the chosen primes covers the requested bit count; returns how many primes were chosen, or 0 if capacity runs out
+static size_t SelectPrimes(uint64_t * primes, size_t capacity, size_t n, size_t bits, const uint64_t * excluded, size_t excluded_len) {
+  uint64_t step = 2 * n;
+  uint64_t candidate = (((uint64_t) 1 << RNS_PRIME_BIT_COUNT) - 1) / step * step + 1;
+  if (candidate >> RNS_PRIME_BIT_COUNT != 0) {
+    candidate -= step;
+  }
+  size_t len = 0;
+  size_t range_bits = 0;
+  while (range_bits <= bits) {
+    bool skip = false;
+    for (size_t i = 0; i < excluded_len; i++) {
+      skip = skip || excluded[i] == candidate;
+    }
+    if (!skip && NTT<uint64_t>::IsSupported(n, candidate)) {
+      if (len == capacity) {
+        return 0;
+      }
+      primes[len++] = candidate;
+      range_bits += RNS_PRIME_BIT_COUNT - 1;
+    }
+    candidate -= step;
+  }
+  return len;
+}
+
+RNSBase::RNSBase(size_t n, size_t bits) : n(n) {
+  primes = (uint64_t *) malloc(RNS_MAX_PRIMES * sizeof(uint64_t));
+  len = SelectPrimes(primes, RNS_MAX_PRIMES, n, bits, NULL, 0);
+  assert(len > 0);
+  Initialize();
+}
+
+RNSBase::RNSBase(size_t n, const uint64_t * primes, size_t len) : n(n), len(len) {
+  assert(len > 0 && len <= RNS_MAX_PRIMES);
+  this->primes = (uint64_t *) malloc(RNS_MAX_PRIMES * sizeof(uint64_t));
+  memcpy(this->primes, primes, len * sizeof(uint64_t));
+  Initialize();
+}
+
+void RNSBase::Initialize() {
+  ntts = (NTT<uint64_t> **) malloc(RNS_MAX_PRIMES * sizeof(NTT<uint64_t> *));
+  for (size_t i = 0; i < len; i++) {
+    ntts[i] = new NTT<uint64_t>(n, primes[i]);
+  }
+
+  // Garner's constants are the inverses of p_j modulo p_i for every j < i
+  garner = (uint64_t *) malloc(len * len * sizeof(uint64_t));
+  garner_precomp = (uint64_t *) malloc(len * len * sizeof(uint64_t));
+  for (size_t i = 0; i < len; i++) {
+    for (size_t j = 0; j < i; j++) {
+      garner[i * len + j] = ModInv(primes[j] % primes[i], primes[i]);
+      garner_precomp[i * len + j] = ModMulPrecompute(garner[i * len + j], primes[i]);
+    }
+  }
+
+  // Residues above P / 2 stand for negative integers
+  range = (uint64_t *) calloc(len, sizeof(uint64_t));
+  half_range = (uint64_t *) malloc(len * sizeof(uint64_t));
+  range[0] = 1;
+  for (size_t i = 0; i < len; i++) {
+    MulAddWords(range, len, primes[i], 0);
+  }
+  for (size_t i = 0; i < len; i++) {
+    half_range[i] = (range[i] >> 1) | (i + 1 < len ? range[i + 1] << 63 : 0);
+  }
+}
+
+RNSBase::~RNSBase() {
+  for (size_t i = 0; i < len; i++) {
+    delete ntts[i];
+  }
+  free(primes);
+  free(ntts);
+  free(garner);
+  free(garner_precomp);
+  free(range);
+  free(half_range);
+}
+
+template <typename T>
+void RNSBase::Decompose(uint64_t * residues, const T * coeffs, T q) const {
+  T center_point = q / 2;
+  for (size_t i = 0; i < len; i++) {
+    uint64_t p = primes[i];
+    uint64_t * limb = residues + i * n;
+    for (size_t j = 0; j < n; j++) {
+      // Coefficients greater than the center point are lifted to their negative equivalent
+      if (coeffs[j] > center_point) {
+        uint64_t r = (uint64_t) (q - coeffs[j]) % p;
+        limb[j] = r == 0 ? 0 : p - r;
+      }
+      else {
+        limb[j] = (uint64_t) coeffs[j] % p;
+      }
+    }
+  }
+}
+
+void RNSBase::Forward(uint64_t * residues) const {
+  for (size_t i = 0; i < len; i++) {
+    ntts[i]->Forward(residues + i * n);
+  }
+}
+
+void RNSBase::Inverse(uint64_t * residues) const {
+  for (size_t i = 0; i < len; i++) {
+    ntts[i]->Inverse(residues + i * n);
+  }
+}
+
+void RNSBase::PointwiseMultiply(uint64_t * result, const uint64_t * a, const uint64_t * b) const {
+  for (size_t i = 0; i < len; i++) {
+    ntts[i]->PointwiseMultiply(result + i * n, a + i * n, b + i * n);
+  }
+}
+
+void RNSBase::PointwiseMultiplyAdd(uint64_t * result, const uint64_t * a, const uint64_t * b) const {
+  for (size_t i = 0; i < len; i++) {
+    uint64_t p = primes[i];
+    for (size_t j = i * n; j < (i + 1) * n; j++) {
+      result[j] = ModAdd(result[j], ModMul(a[j], b[j], p), p);
+    }
+  }
+}
+
+// Rebuilds the coefficient at the given index into words using Garner's algorithm
+// The magnitude of its centered value is written into x and the return value indicates if it is negative
+bool RNSBase::Reconstruct(uint64_t * x, const uint64_t * residues, size_t index) const {
+  // Find the mixed-radix digits v_i, so that the coefficient is v_0 + v_1 * p_0 + v_2 * p_0 * p_1 + ...
+  uint64_t digits[RNS_MAX_PRIMES];
+  for (size_t i = 0; i < len; i++) {
+    uint64_t p = primes[i];
+    uint64_t v = residues[i * n + index];
+    for (size_t j = 0; j < i; j++) {
+      v = ModSub(v, digits[j] % p, p);
+      v = ModMulShoup(v, garner[i * len + j], garner_precomp[i * len + j], p);
+    }
+    digits[i] = v;
+  }
+
+  // Horner's rule from the most significant digit down
+  memset(x, 0, len * sizeof(uint64_t));
+  x[0] = digits[len - 1];
+  for (size_t i = len - 1; i-- > 0;) {
+    MulAddWords(x, len, primes[i], digits[i]);
+  }
+
+  // Anything above P / 2 wraps around to P - x
+  if (IsGreaterWords(x, half_range, len)) {
+    ReverseSubtractWords(x, range, len);
+    return true;
+  }
+  return false;
+}
+
+template <typename T>
+void RNSBase::Reduce(T * coeffs, const uint64_t * residues, T q) const {
+  uint64_t x[RNS_MAX_PRIMES];
+  for (size_t j = 0; j < n; j++) {
+    bool negative = Reconstruct(x, residues, j);
+    T r = (T) ModWords(x, len, q);
+    coeffs[j] = negative && r != 0 ? q - r : r;
+  }
+}
+
+template <typename T>
+void RNSBase::ScaleRound(T * coeffs, const uint64_t * residues, T scalar, T q) const {
+  // One extra word holds the product with the scalar
+  uint64_t x[RNS_MAX_PRIMES + 1];
+  T q2 = q / 2;
+  for (size_t j = 0; j < n; j++) {
+    bool negative = Reconstruct(x, residues, j);
+    x[len] = MulAddWords(x, len, scalar, 0);
+
+    // Non-negative values are floor((m + q / 2) / q)
+    // Negative values are -ceil((m - q / 2) / q) = -floor((m + q - 1 - q / 2) / q), which rounds ties up as well
+    uint64_t carry = MulAddWords(x, len + 1, 1, negative ? q - 1 - q2 : q2);
+    assert(carry == 0);
+    (void) carry;
+    DivideWords(x, len + 1, q);
+
+    T r = (T) ModWords(x, len + 1, q);
+    coeffs[j] = negative && r != 0 ? q - r : r;
+  }
+}
+
+// Products accumulated before each gcd in Pollard's rho
+#define RNS_RHO_BATCH_SIZE 128
+
+static uint64_t GCD(uint64_t a, uint64_t b) {
+  while (b != 0) {
+    uint64_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+// Finds a nontrivial factor of an odd composite m with Brent's variant of Pollard's rho
+// Factors of NTT-friendly moduli are only ever checked once per context, so a few milliseconds here are of no concern
+static uint64_t FindFactor(uint64_t m) {
+  for (uint64_t c = 1;; c++) {
+    uint64_t x = 2;
+    uint64_t y = 2;
+    uint64_t ys = 2;
+    uint64_t g = 1;
+    uint64_t product = 1;
+    for (uint64_t r = 1; g == 1; r <<= 1) {
+      x = y;
+      for (uint64_t i = 0; i < r; i++) {
+        y = ModAdd(ModMul(y, y, m), c, m);
+      }
+      for (uint64_t k = 0; k < r && g == 1; k += RNS_RHO_BATCH_SIZE) {
+        ys = y;
+        for (uint64_t i = 0; i < RNS_RHO_BATCH_SIZE && i < r - k; i++) {
+          y = ModAdd(ModMul(y, y, m), c, m);
+          product = ModMul(product, x > y ? x - y : y - x, m);
+        }
+        g = GCD(product, m);
+      }
+    }
+
+    // The batch overshot, so step through it again one gcd at a time
+    if (g == m) {
+      do {
+        ys = ModAdd(ModMul(ys, ys, m), c, m);
+        g = GCD(x > ys ? x - ys : ys - x, m);
+      } while (g == 1);
+    }
+    if (g != m) {
+      return g;
+    }
+  }
+}
+
+// Splits m into distinct NTT-friendly primes, which are appended to the factors; fails on any other factor
+static bool SplitModulus(uint64_t * factors, size_t & len, size_t n, uint64_t m) {
+  // Every divisor of a product of primes p = 1 mod 2n is 1 mod 2n as well, which rules out most moduli right away
+  if (m % (2 * n) != 1) {
+    return false;
+  }
+  if (IsPrime(m)) {
+    if (!NTT<uint64_t>::IsSupported(n, m) || len == RNS_MAX_PRIMES) {
+      return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+      if (factors[i] == m) {
+        return false;
+      }
+    }
+    factors[len++] = m;
+    return true;
+  }
+  uint64_t d = FindFactor(m);
+  return SplitModulus(factors, len, n, d) && SplitModulus(factors, len, n, m / d);
+}
+
+// Factors q into distinct NTT-friendly primes, returning how many there are, or 0 if q doesn't factor that way
+static size_t FactorModulus(uint64_t * factors, size_t n, uint64_t q) {
+  if (n < 2 || (n & (n - 1)) != 0) {
+    return 0;
+  }
+  size_t len = 0;
+  return SplitModulus(factors, len, n, q) ? len : 0;
+}
+
+static ZZ ToZZ(uint64_t x) {
+  ZZ result;
+  conv(result, (unsigned long) x);
+  return result;
+}
+
+static uint64_t Remainder(const ZZ & x, uint64_t p) {
+  return (uint64_t) rem(x, (long) p);
+}
+
+bool RNSModulus::IsSupported(size_t n, uint64_t q, size_t bits) {
+  // The scaling below needs 2q to fit in a word
+  if (q >> 63 != 0) {
+    return false;
+  }
+  uint64_t primes[RNS_MAX_PRIMES];
+  size_t q_len = FactorModulus(primes, n, q);
+  return q_len > 0 && SelectPrimes(primes + q_len, RNS_MAX_PRIMES - q_len, n, bits, primes, q_len) > 0;
+}
+
+RNSModulus::RNSModulus(size_t n, uint64_t q, size_t bits) : n(n), q(q) {
+  assert(IsSupported(n, q, bits));
+  uint64_t primes[RNS_MAX_PRIMES];
+  q_len = FactorModulus(primes, n, q);
+  p_len = SelectPrimes(primes + q_len, RNS_MAX_PRIMES - q_len, n, bits, primes, q_len);
+  q_base = new RNSBase(n, primes, q_len);
+  base = new RNSBase(n, primes, q_len + p_len);
+  const uint64_t * p_primes = primes + q_len;
+
+  // The constants are only built once, so they are worked out with arbitrary-precision integers
+  ZZ q_zz = ToZZ(q);
+  ZZ p_zz(1);
+  for (size_t j = 0; j < p_len; j++) {
+    p_zz *= ToZZ(p_primes[j]);
+  }
+  ZZ m_zz = q_zz * p_zz;
+
+  // Composition modulo q is the CRT sum of [x_i * (q / q_i)^-1]_(q_i) * (q / q_i)
+  q_hat = (uint64_t *) malloc(q_len * sizeof(uint64_t));
+  q_hat_precomp = (uint64_t *) malloc(q_len * sizeof(uint64_t));
+  q_hat_inv = (uint64_t *) malloc(q_len * sizeof(uint64_t));
+  q_hat_inv_precomp = (uint64_t *) malloc(q_len * sizeof(uint64_t));
+  for (size_t i = 0; i < q_len; i++) {
+    uint64_t qi = primes[i];
+    q_hat[i] = q / qi;
+    q_hat_precomp[i] = ModMulPrecompute(q_hat[i], q);
+    q_hat_inv[i] = ModInv(q_hat[i] % qi, qi);
+    q_hat_inv_precomp[i] = ModMulPrecompute(q_hat_inv[i], qi);
+  }
+
+  // Scaling splits every P / q_i into its integer part, taken modulo each p_j, and its fraction, held as a 128-bit fixed-point number
+  m_hat_inv = (uint64_t *) malloc(q_len * sizeof(uint64_t));
+  floor_p_div_q = (uint64_t *) malloc(q_len * p_len * sizeof(uint64_t));
+  floor_p_div_q_precomp = (uint64_t *) malloc(q_len * p_len * sizeof(uint64_t));
+  frac_p_div_q = (uint64_t *) malloc(2 * q_len * sizeof(uint64_t));
+  for (size_t i = 0; i < q_len; i++) {
+    uint64_t qi = primes[i];
+    m_hat_inv[i] = ModInv(Remainder(m_zz / qi, qi), qi);
+    ZZ floor_zz = p_zz / qi;
+    for (size_t j = 0; j < p_len; j++) {
+      floor_p_div_q[i * p_len + j] = Remainder(floor_zz, p_primes[j]);
+      floor_p_div_q_precomp[i * p_len + j] = ModMulPrecompute(floor_p_div_q[i * p_len + j], p_primes[j]);
+    }
+    uint128_t r = (uint128_t) Remainder(p_zz, qi) << 64;
+    frac_p_div_q[2 * i] = (uint64_t) (r / qi);
+    frac_p_div_q[2 * i + 1] = (uint64_t) (((r % qi) << 64) / qi);
+  }
+  q_inv = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  one_precomp = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  for (size_t j = 0; j < p_len; j++) {
+    q_inv[j] = ModInv(Remainder(q_zz, p_primes[j]), p_primes[j]);
+    one_precomp[j] = ModMulPrecompute((uint64_t) 1, p_primes[j]);
+  }
+
+  // Switching from P to q is the CRT sum of y_j * (P / p_j), less the multiple of P found with floating point
+  p_hat = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  p_hat_precomp = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  p_hat_inv = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  p_hat_inv_precomp = (uint64_t *) malloc(p_len * sizeof(uint64_t));
+  p_inv = (double *) malloc(p_len * sizeof(double));
+  for (size_t j = 0; j < p_len; j++) {
+    uint64_t pj = p_primes[j];
+    ZZ p_hat_zz = p_zz / pj;
+    p_hat[j] = Remainder(p_hat_zz, q);
+    p_hat_precomp[j] = ModMulPrecompute(p_hat[j], q);
+    p_hat_inv[j] = ModInv(Remainder(p_hat_zz, pj), pj);
+    p_hat_inv_precomp[j] = ModMulPrecompute(p_hat_inv[j], pj);
+    p_inv[j] = 1.0 / (double) pj;
+  }
+  p_mod_q = Remainder(p_zz, q);
+  p_mod_q_precomp = ModMulPrecompute(p_mod_q, q);
+}
+
+RNSModulus::~RNSModulus() {
+  delete q_base;
+  delete base;
+  free(q_hat);
+  free(q_hat_precomp);
+  free(q_hat_inv);
+  free(q_hat_inv_precomp);
+  free(m_hat_inv);
+  free(floor_p_div_q);
+  free(floor_p_div_q_precomp);
+  free(frac_p_div_q);
+  free(q_inv);
+  free(one_precomp);
+  free(p_hat);
+  free(p_hat_precomp);
+  free(p_hat_inv);
+  free(p_hat_inv_precomp);
+  free(p_inv);
+}
+
+template <typename T>
+void RNSModulus::Compose(T * coeffs, const uint64_t * residues) const {
+  for (size_t c = 0; c < n; c++) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < q_len; i++) {
+      uint64_t qi = q_base->GetPrime(i);
+      uint64_t y = ModMulShoup(residues[i * n + c], q_hat_inv[i], q_hat_inv_precomp[i], qi);
+      sum = ModAdd(sum, ModMulShoup(y, q_hat[i], q_hat_precomp[i], q), q);
+    }
+    coeffs[c] = (T) sum;
+  }
+}
+
+template <typename T>
+void RNSModulus::ScaleRound(T * coeffs, const uint64_t * residues, T scalar) const {
+  // Fold the scalar into the per-prime constants once for the whole polynomial
+  uint64_t scaled_m_hat_inv[RNS_MAX_PRIMES];
+  uint64_t scaled_m_hat_inv_precomp[RNS_MAX_PRIMES];
+  uint64_t scaled_q_inv[RNS_MAX_PRIMES];
+  uint64_t scaled_q_inv_precomp[RNS_MAX_PRIMES];
+  for (size_t i = 0; i < q_len; i++) {
+    uint64_t qi = base->GetPrime(i);
+    scaled_m_hat_inv[i] = ModMul((uint64_t) scalar % qi, m_hat_inv[i], qi);
+    scaled_m_hat_inv_precomp[i] = ModMulPrecompute(scaled_m_hat_inv[i], qi);
+  }
+  for (size_t j = 0; j < p_len; j++) {
+    uint64_t pj = base->GetPrime(q_len + j);
+    scaled_q_inv[j] = ModMul((uint64_t) scalar % pj, q_inv[j], pj);
+    scaled_q_inv_precomp[j] = ModMulPrecompute(scaled_q_inv[j], pj);
+  }
+
+  uint64_t b[RNS_MAX_PRIMES];
+  for (size_t c = 0; c < n; c++) {
+    // With M = QP, t * x / Q is the sum of b_i * P / q_i, where b_i = [x_i * t * (M / q_i)^-1]_(q_i), and of an integer
+    // that is t * x'_j * Q^-1 modulo p_j, up to a multiple of P; only the fractions of P / q_i need rounding
+    // Their sum is split over three words so that nothing is lost before the round, since b_i * frac(P / q_i) < q_i
+    uint64_t integer = 0;
+    uint128_t middle = 0;
+    uint128_t low = 0;
+    for (size_t i = 0; i < q_len; i++) {
+      uint64_t qi = base->GetPrime(i);
+      b[i] = ModMulShoup(residues[i * n + c], scaled_m_hat_inv[i], scaled_m_hat_inv_precomp[i], qi);
+      uint128_t hi_product = (uint128_t) b[i] * frac_p_div_q[2 * i];
+      uint128_t lo_product = (uint128_t) b[i] * frac_p_div_q[2 * i + 1];
+      integer += (uint64_t) (hi_product >> 64);
+      middle += (uint64_t) hi_product;
+      middle += (uint64_t) (lo_product >> 64);
+      low += (uint64_t) lo_product;
+    }
+    middle += low >> 64;
+    integer += (uint64_t) (middle >> 64);
+    uint64_t rounded = integer + ((uint64_t) middle >> 63);
+
+    // The rounded result modulo each p_j is switched to q through its centered value, found from the CRT sum over P
+    uint64_t sum = 0;
+    double wrap = 0.5;
+    for (size_t j = 0; j < p_len; j++) {
+      uint64_t pj = base->GetPrime(q_len + j);
+      uint64_t r = ModMulShoup(residues[(q_len + j) * n + c], scaled_q_inv[j], scaled_q_inv_precomp[j], pj);
+      for (size_t i = 0; i < q_len; i++) {
+        r = ModAdd(r, ModMulShoup(b[i], floor_p_div_q[i * p_len + j], floor_p_div_q_precomp[i * p_len + j], pj), pj);
+      }
+      r = ModAdd(r, ModMulShoup(rounded, (uint64_t) 1, one_precomp[j], pj), pj);
+
+      uint64_t y = ModMulShoup(r, p_hat_inv[j], p_hat_inv_precomp[j], pj);
+      wrap += (double) y * p_inv[j];
+      sum = ModAdd(sum, ModMulShoup(y, p_hat[j], p_hat_precomp[j], q), q);
+    }
+
+    // P leaves enough room that the centered value is far from +-P / 2, so rounding errors in the wrap count don't matter
+    coeffs[c] = (T) ModSub(sum, ModMulShoup((uint64_t) wrap, p_mod_q, p_mod_q_precomp, q), q);
+  }
+}
+
+// Only 32-bit and 64-bit coefficient words are supported
+template void RNSBase::Decompose<uint32_t>(uint64_t * residues, const uint32_t * coeffs, uint32_t q) const;
+template void RNSBase::Decompose<uint64_t>(uint64_t * residues, const uint64_t * coeffs, uint64_t q) const;
+template void RNSBase::Reduce<uint32_t>(uint32_t * coeffs, const uint64_t * residues, uint32_t q) const;
+template void RNSBase::Reduce<uint64_t>(uint64_t * coeffs, const uint64_t * residues, uint64_t q) const;
+template void RNSBase::ScaleRound<uint32_t>(uint32_t * coeffs, const uint64_t * residues, uint32_t scalar, uint32_t q) const;
+template void RNSBase::ScaleRound<uint64_t>(uint64_t * coeffs, const uint64_t * residues, uint64_t scalar, uint64_t q) const;
+template void RNSModulus::Compose<uint32_t>(uint32_t * coeffs, const uint64_t * residues) const;
+template void RNSModulus::Compose<uint64_t>(uint64_t * coeffs, const uint64_t * residues) const;
+template void RNSModulus::ScaleRound<uint32_t>(uint32_t * coeffs, const uint64_t * residues, uint32_t scalar) const;
+template void RNSModulus::ScaleRound<uint64_t>(uint64_t * coeffs, const uint64_t * residues, uint64_t scalar) const;
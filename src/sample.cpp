@@ -1,22 +1,157 @@
 #include "sample.h"
+#include "trace.h"
 
-#include <NTL/GF2X.h>
+#include <sodium.h>
+#include <string.h>
+
+#include <math.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace rlwe;
+
+// The nonce is fixed, since every seed is only ever used for a single stream
+static const uint8_t random_stream_nonce[crypto_stream_chacha20_NONCEBYTES] = {0};
+
+RandomStream::RandomStream() {
+  Reseed();
+}
+
+RandomStream::RandomStream(const uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH]) {
+  SetSeed(seed);
+}
+
+void RandomStream::SetSeed(const uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH]) {
+  memcpy(key, seed, RANDOM_STREAM_SEED_BYTE_LENGTH);
+  counter = 0;
+  position = RANDOM_STREAM_BUFFER_BYTE_LENGTH;
+  pid = getpid();
+}
+
+void RandomStream::Reseed() {
+  uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH];
+  randombytes_buf(seed, RANDOM_STREAM_SEED_BYTE_LENGTH);
+  SetSeed(seed);
+  sodium_memzero(seed, RANDOM_STREAM_SEED_BYTE_LENGTH);
+}
+
+void RandomStream::Refill() {
+  // The keystream is the encryption of zeros, continuing from the current block
+  memset(buffer, 0, RANDOM_STREAM_BUFFER_BYTE_LENGTH);
+  crypto_stream_chacha20_xor_ic(buffer, buffer, RANDOM_STREAM_BUFFER_BYTE_LENGTH, random_stream_nonce, counter, key);
+  counter += RANDOM_STREAM_BUFFER_BYTE_LENGTH / 64;
+  position = 0;
+}
+
+void RandomStream::GetBytes(void * output, size_t len) {
+  uint8_t * out = (uint8_t *) output;
+
+  // Use up whatever is left in the buffer first
+  size_t available = RANDOM_STREAM_BUFFER_BYTE_LENGTH - position;
+  size_t count = len < available ? len : available;
+  memcpy(out, buffer + position, count);
+  position += count;
+  out += count;
+  len -= count;
+
+  // Whole buffers' worth of output skip the buffer, as long as they end on a ChaCha20 block boundary
+  size_t direct = len / RANDOM_STREAM_BUFFER_BYTE_LENGTH * RANDOM_STREAM_BUFFER_BYTE_LENGTH;
+  if (direct > 0) {
+    memset(out, 0, direct);
+    crypto_stream_chacha20_xor_ic(out, out, direct, random_stream_nonce, counter, key);
+    counter += direct / 64;
+    out += direct;
+    len -= direct;
+  }
+
+  if (len > 0) {
+    Refill();
+    memcpy(out, buffer, len);
+    position = len;
+  }
+}
+
+uint32_t RandomStream::GetWord32() {
+  uint32_t word;
+  GetBytes(&word, sizeof(uint32_t));
+  return word;
+}
+
+uint64_t RandomStream::GetWord64() {
+  uint64_t word;
+  GetBytes(&word, sizeof(uint64_t));
+  return word;
+}
+
+uint64_t RandomStream::Uniform(uint64_t bound) {
+  if (bound <= 1) {
+    return 0;
+  }
+
+  // Draw just enough bits to cover the bound and reject anything past it
+  uint64_t mask = bound - 1;
+  mask |= mask >> 1;
+  mask |= mask >> 2;
+  mask |= mask >> 4;
+  mask |= mask >> 8;
+  mask |= mask >> 16;
+  mask |= mask >> 32;
+
+  uint64_t value;
+  do {
+    value = (mask >> 32 ? GetWord64() : GetWord32()) & mask;
+  } while (value >= bound);
+  return value;
+}
+
+void RandomStream::Uniform(ZZ & value, const ZZ & bound) {
+  if (bound <= 1) {
+    clear(value);
+    return;
+  }
+
+  long bits = NumBits(bound - 1);
+  long bytes = (bits + 7) / 8;
+  uint8_t * buf = (uint8_t *) malloc(bytes);
+  do {
+    GetBytes(buf, bytes);
+    buf[bytes - 1] &= (uint8_t) (0xFF >> (8 * bytes - bits));
+    value = ZZFromBytes(buf, bytes);
+  } while (value >= bound);
+  free(buf);
+}
+
+RandomStream & RandomStream::GetInstance() {
+  static thread_local RandomStream stream;
+
+  // A forked child starts with a copy of the parent's stream, and would otherwise repeat its output (e.g. the
+  // same TESLA y, which gives the secret key away)
+  if (stream.pid != getpid()) {
+    stream.Reseed();
+  }
+  return stream;
+}
 
 void rlwe::UniformSample(ZZX & poly, size_t len, const ZZ & maximum) {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  RandomStream & stream = RandomStream::GetInstance();
+  poly.SetLength(len);
   if (maximum == 2) {
-    // If the maximum is 2, we can use the GF2X class 
-    GF2X tmp;
-    random(tmp, len);
-    conv(poly, tmp);
+    // If the maximum is 2, every byte of the stream gives 8 coefficients
+    uint8_t * bits = (uint8_t *) malloc((len + 7) / 8);
+    stream.GetBytes(bits, (len + 7) / 8);
+    for (size_t i = 0; i < len; i++) {
+      poly[i] = (bits[i / 8] >> (i % 8)) & 1;
+    }
+    free(bits);
   }
   else {
-    // Otherwise, we set a temporary modulus and use the ZZ_pX class
-    ZZ_pPush push;
-    ZZ_p::init(maximum);
-    ZZ_pX tmp;
-    random(tmp, len);
-    conv(poly, tmp);
+    for (size_t i = 0; i < len; i++) {
+      stream.Uniform(poly[i], maximum);
+    }
   }
+  poly.normalize();
 }
 
 void rlwe::UniformSample(ZZX & poly, size_t len, const ZZ & minimum, const ZZ & maximum) {
@@ -29,6 +164,31 @@ void rlwe::UniformSample(ZZX & poly, size_t len, const ZZ & minimum, const ZZ &
   }
 }
 
+template <typename T>
+void rlwe::UniformSample(Poly<T> & poly, size_t len, T maximum) {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  RandomStream & stream = RandomStream::GetInstance();
+  poly.SetLength(len);
+  poly.SetDomain(COEFFICIENT_DOMAIN);
+  for (size_t i = 0; i < len; i++) {
+    poly[i] = (T) stream.Uniform(maximum);
+  }
+}
+
+template <typename T>
+void rlwe::UniformSample(Poly<T> & poly, size_t len, long minimum, long maximum, T mod) {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  RandomStream & stream = RandomStream::GetInstance();
+  poly.SetLength(len);
+  poly.SetDomain(COEFFICIENT_DOMAIN);
+  for (size_t i = 0; i < len; i++) {
+    // Shift the sample into [min, max) and then reduce it modulo q
+    long value = minimum + (long) stream.Uniform((uint64_t) (maximum - minimum));
+    value %= (long) mod;
+    poly[i] = value < 0 ? (T) (value + (long) mod) : (T) value;
+  }
+}
+
 void rlwe::KnuthYaoGaussianMatrix(uint8_t ** pmat, size_t pmat_rows, float sigma) {
   // Calculate some constants
   float variance = sigma * sigma;
@@ -68,39 +228,295 @@ void rlwe::KnuthYaoGaussianMatrix(uint8_t ** pmat, size_t pmat_rows, float sigma
   }
 }
 
+// The probability matrix rearranged by column, listing the rows whose bit is set from the last row to the first
+// The matrix is public, so walking only over its set bits does not leak anything about the samples
+struct KnuthYaoColumns {
+  std::vector<uint32_t> rows;
+  std::vector<size_t> offsets;
+  size_t columns;
+
+  // Rearranges the given matrix, reusing the storage of whichever matrix was rearranged before
+  void Build(uint8_t ** pmat, size_t pmat_rows) {
+    rows.clear();
+    offsets.assign(1, 0);
+    columns = 0;
+    for (size_t col = 0; col < PROBABILITY_MATRIX_BIT_PRECISION; col++) {
+      for (size_t row = pmat_rows; row-- > 0;) {
+        if ((pmat[row][col / 8] >> (7 - col % 8)) & 1) {
+          rows.push_back((uint32_t) row);
+          columns = col + 1;
+        }
+      }
+      offsets.push_back(rows.size());
+    }
+  }
+};
+
+// Draws a block of signed values by walking the DDG tree of the Knuth-Yao algorithm for every lane at once
+// Each lane takes the same number of steps no matter where its walk ends, and the random bits are drawn up front
+static void KnuthYaoSampleBlock(int32_t * values, const KnuthYaoColumns & columns) {
+  uint64_t bits[PROBABILITY_MATRIX_BIT_PRECISION + 1];
+  uint32_t distance[KNUTH_YAO_BLOCK_SIZE];
+  uint32_t hit[KNUTH_YAO_BLOCK_SIZE];
+  uint32_t magnitude[KNUTH_YAO_BLOCK_SIZE];
+  uint32_t done[KNUTH_YAO_BLOCK_SIZE] = {0};
+  memset(values, 0, KNUTH_YAO_BLOCK_SIZE * sizeof(int32_t));
+
+  uint32_t pending = 1;
+  while (pending) {
+    // One word of random bits per column and one for the signs, where bit i of each word belongs to lane i
+    RandomStream::GetInstance().GetBytes(bits, (columns.columns + 1) * sizeof(uint64_t));
+
+    for (size_t lane = 0; lane < KNUTH_YAO_BLOCK_SIZE; lane++) {
+      distance[lane] = 0;
+      hit[lane] = 0;
+      magnitude[lane] = 0;
+    }
+
+    for (size_t col = 0; col < columns.columns; col++) {
+      uint64_t column_bits = bits[col];
+      for (size_t lane = 0; lane < KNUTH_YAO_BLOCK_SIZE; lane++) {
+        distance[lane] = 2 * distance[lane] + (uint32_t) ((column_bits >> lane) & 1);
+      }
+
+      // A lane reaches a terminal node when its distance drops to -1; later terminal nodes are masked out
+      for (size_t k = columns.offsets[col]; k < columns.offsets[col + 1]; k++) {
+        uint32_t row = columns.rows[k];
+        for (size_t lane = 0; lane < KNUTH_YAO_BLOCK_SIZE; lane++) {
+          distance[lane]--;
+          uint32_t terminal = -(uint32_t) (distance[lane] == UINT32_MAX) & ~hit[lane];
+          magnitude[lane] |= terminal & row;
+          hit[lane] |= terminal;
+        }
+      }
+    }
+
+    // Lanes that fall off the end of the (truncated) matrix are redrawn, which only happens with negligible probability
+    uint64_t signs = bits[columns.columns];
+    pending = 0;
+    for (size_t lane = 0; lane < KNUTH_YAO_BLOCK_SIZE; lane++) {
+      uint32_t negate = -(uint32_t) ((signs >> lane) & 1);
+      uint32_t value = (magnitude[lane] ^ negate) - negate;
+      uint32_t accept = hit[lane] & ~done[lane];
+      values[lane] = (int32_t) (((uint32_t) values[lane] & ~accept) | (value & accept));
+      done[lane] |= hit[lane];
+      pending |= ~done[lane];
+    }
+  }
+}
+
+// Fills the array with signed samples, one block at a time
+static void KnuthYaoSampleValues(int32_t * values, size_t len, uint8_t ** pmat, size_t pmat_rows) {
+  thread_local KnuthYaoColumns columns;
+  columns.Build(pmat, pmat_rows);
+  int32_t block[KNUTH_YAO_BLOCK_SIZE];
+  for (size_t i = 0; i < len; i += KNUTH_YAO_BLOCK_SIZE) {
+    size_t count = len - i < KNUTH_YAO_BLOCK_SIZE ? len - i : KNUTH_YAO_BLOCK_SIZE;
+    KnuthYaoSampleBlock(block, columns);
+    memcpy(values + i, block, count * sizeof(int32_t));
+  }
+}
+
 void rlwe::KnuthYaoSample(ZZX & poly, size_t len, uint8_t ** pmat, size_t pmat_rows) {
-  // Perform the Knuth-Yao sampling algorithm and navigate the DDG
-  int last_row = pmat_rows - 1; 
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  int32_t * values = (int32_t *) malloc(len * sizeof(int32_t));
+  KnuthYaoSampleValues(values, len, pmat, pmat_rows);
   for (long i = 0; i < len; i++) {
-    // Setup: initialize random bit, counters, etc.
-    GF2 r;
-    int d = 0; 
-    int hit = 0;
-    int col = 0;
-
-    // Keep iterating through columns until a hit, generate a random bit each time
-    while (!hit) { 
-      random(r);
-      d = 2 * d + IsZero(r); 
-
-      // Iterate through rows of probability matrix
-      for (int row = last_row; row >= 0; row--) {
-        d -= ((pmat[row][col / 8] >> (7 - col % 8)) & 1); 
-
-        // Reached terminal node in the DDG
-        if (d == -1) {
-          // Randomly flip chosen value and make it negative
-          random(r);
-          SetCoeff(poly, i, IsOne(r) ? row : -row); 
-
-          // Register that we have found a sample value
-          hit = 1;
-          break;
-        }
+    SetCoeff(poly, i, values[i]); 
+  }
+  free(values);
+}
+
+// Stores signed samples in a word-based polynomial, where negative samples become their equivalent modulo q
+template <typename T>
+static void ReduceSamples(Poly<T> & poly, const int32_t * values, size_t len, T mod) {
+  poly.SetLength(len);
+  poly.SetDomain(COEFFICIENT_DOMAIN);
+  for (size_t i = 0; i < len; i++) {
+    // Avoid branching on the sign
+    T negative = -(T) (values[i] < 0);
+    poly[i] = (T) (long) values[i] + (negative & mod);
+  }
+}
+
+// Per-thread buffer for the signed samples of a word-based polynomial
+// It only ever grows, so drawing polynomials of one length over and over never allocates
+static int32_t * GetSampleBuffer(size_t len) {
+  thread_local std::vector<int32_t> values;
+  if (values.size() < len) {
+    values.resize(len);
+  }
+  return values.data();
+}
+
+template <typename T>
+void rlwe::KnuthYaoSample(Poly<T> & poly, size_t len, T mod, uint8_t ** pmat, size_t pmat_rows) {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  int32_t * values = GetSampleBuffer(len);
+  KnuthYaoSampleValues(values, len, pmat, pmat_rows);
+  ReduceSamples(poly, values, len, mod);
+}
+
+GaussianSampler * GaussianSampler::Create(GaussianSamplerType type, float sigma) {
+  if (type == CDT_SAMPLER) {
+    return new CDTSampler(sigma);
+  }
+  if (type == BINOMIAL_SAMPLER) {
+    return new BinomialSampler(sigma);
+  }
+  return new KnuthYaoSampler(sigma);
+}
+
+void GaussianSampler::Sample(ZZX & poly, size_t len) const {
+  int32_t * values = (int32_t *) malloc(len * sizeof(int32_t));
+  Sample(values, len);
+  for (long i = 0; i < len; i++) {
+    SetCoeff(poly, i, values[i]); 
+  }
+  free(values);
+}
+
+ZZX GaussianSampler::Sample(size_t len) const {
+  ZZX poly;
+  Sample(poly, len);
+  return poly;
+}
+
+template <typename T>
+void GaussianSampler::Sample(Poly<T> & poly, size_t len, T mod) const {
+  int32_t * values = GetSampleBuffer(len);
+  Sample(values, len);
+  ReduceSamples(poly, values, len, mod);
+}
+
+KnuthYaoSampler::KnuthYaoSampler(float sigma) : GaussianSampler(sigma) {
+  pmat = KnuthYaoGaussianMatrix(bound, sigma);
+}
+
+KnuthYaoSampler::~KnuthYaoSampler() {
+  for (size_t i = 0; i < bound; i++) {
+    free(pmat[i]);
+  }
+  free(pmat);
+}
+
+void KnuthYaoSampler::Sample(int32_t * values, size_t len) const {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  KnuthYaoSampleValues(values, len, pmat, bound);
+}
+
+CDTSampler::CDTSampler(float sigma) : GaussianSampler(sigma) {
+  // Same (halved at 0) probabilities as the Knuth-Yao matrix, but at extended precision
+  long double variance = (long double) sigma * sigma;
+  long double * cumulative = (long double *) malloc(bound * sizeof(long double));
+  long double total = 0;
+  for (size_t i = 0; i < bound; i++) {
+    long double probability = expl(-(long double) (i * i) / 2 / variance);
+    total += i == 0 ? probability / 2 : probability;
+    cumulative[i] = total;
+  }
+
+  // Entry i is the scaled probability of drawing a magnitude of at most i; the last magnitude needs no entry
+  table_size = bound > 0 ? bound - 1 : 0;
+  table = (int64_t *) malloc((table_size + 1) * sizeof(int64_t));
+  for (size_t i = 0; i < table_size; i++) {
+    long double scaled = ldexpl(cumulative[i] / total, 63);
+    table[i] = scaled >= ldexpl(1, 63) ? INT64_MAX : (int64_t) llroundl(scaled);
+  }
+  free(cumulative);
+}
+
+CDTSampler::~CDTSampler() {
+  free(table);
+}
+
+void CDTSampler::Sample(int32_t * values, size_t len) const {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  RandomStream & stream = RandomStream::GetInstance();
+  uint64_t words[CDT_BLOCK_SIZE];
+  int64_t uniform[CDT_BLOCK_SIZE];
+  int32_t magnitude[CDT_BLOCK_SIZE];
+
+  for (size_t i = 0; i < len; i += CDT_BLOCK_SIZE) {
+    size_t count = len - i < CDT_BLOCK_SIZE ? len - i : CDT_BLOCK_SIZE;
+
+    // The low 63 bits of each word pick the magnitude and the top bit picks the sign
+    stream.GetBytes(words, count * sizeof(uint64_t));
+    for (size_t lane = 0; lane < count; lane++) {
+      uniform[lane] = (int64_t) (words[lane] & INT64_MAX);
+      magnitude[lane] = 0;
+    }
+
+    // Every value is compared against every entry, so the scan takes the same time whatever is drawn
+    for (size_t k = 0; k < table_size; k++) {
+      int64_t threshold = table[k];
+      for (size_t lane = 0; lane < count; lane++) {
+        magnitude[lane] += uniform[lane] >= threshold;
+      }
+    }
+
+    for (size_t lane = 0; lane < count; lane++) {
+      int32_t negate = -(int32_t) (words[lane] >> 63);
+      values[i + lane] = (magnitude[lane] ^ negate) - negate;
+    }
+  }
+}
+
+BinomialSampler::BinomialSampler(float sigma) : 
+  GaussianSampler(sigma, (size_t) lroundf(2 * sigma * sigma) + 1), k(bound - 1) {}
+
+// Hamming weight of the bits of x selected by the mask, counted without branches or lookup tables
+static inline int32_t Weight(uint64_t x, uint64_t mask) {
+  x &= mask;
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int32_t) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+void BinomialSampler::Sample(int32_t * values, size_t len) const {
+  RLWE_TRACE_SCOPE(STAGE_SAMPLE);
+  RandomStream & stream = RandomStream::GetInstance();
+  if (k <= 16) {
+    // Both k-bit strings of a sample fit into the two halves of a 32-bit word (as for psi_16)
+    uint64_t mask = (1ULL << k) - 1;
+    uint32_t words[BINOMIAL_BLOCK_SIZE];
+    for (size_t i = 0; i < len; i += BINOMIAL_BLOCK_SIZE) {
+      size_t count = len - i < BINOMIAL_BLOCK_SIZE ? len - i : BINOMIAL_BLOCK_SIZE;
+      stream.GetBytes(words, count * sizeof(uint32_t));
+      for (size_t j = 0; j < count; j++) {
+        values[i + j] = Weight(words[j], mask) - Weight(words[j] >> 16, mask);
       }
-      col++;
     }
   }
+  else if (k <= 32) {
+    // Otherwise they fit into the two halves of a 64-bit word
+    uint64_t mask = k == 32 ? 0xFFFFFFFFULL : (1ULL << k) - 1;
+    uint64_t words[BINOMIAL_BLOCK_SIZE];
+    for (size_t i = 0; i < len; i += BINOMIAL_BLOCK_SIZE) {
+      size_t count = len - i < BINOMIAL_BLOCK_SIZE ? len - i : BINOMIAL_BLOCK_SIZE;
+      stream.GetBytes(words, count * sizeof(uint64_t));
+      for (size_t j = 0; j < count; j++) {
+        values[i + j] = Weight(words[j], mask) - Weight(words[j] >> 32, mask);
+      }
+    }
+  }
+  else {
+    // For larger k, each string takes several words, the last of which is only partially used
+    size_t half = (k + 63) / 64;
+    uint64_t last_mask = k % 64 == 0 ? ~0ULL : (1ULL << (k % 64)) - 1;
+    uint64_t * words = (uint64_t *) malloc(2 * half * sizeof(uint64_t));
+    for (size_t i = 0; i < len; i++) {
+      stream.GetBytes(words, 2 * half * sizeof(uint64_t));
+      int32_t value = 0;
+      for (size_t j = 0; j < half; j++) {
+        uint64_t mask = j == half - 1 ? last_mask : ~0ULL;
+        value += Weight(words[j], mask) - Weight(words[half + j], mask);
+      }
+      values[i] = value;
+    }
+    free(words);
+  }
 }
 
 ZZX rlwe::UniformSample(size_t len, const ZZ & maximum) {
@@ -129,3 +545,13 @@ ZZX rlwe::KnuthYaoSample(size_t len, uint8_t ** pmat, size_t pmat_rows) {
   KnuthYaoSample(poly, len, pmat, pmat_rows);
   return poly;
 }
+
+// Only 32-bit and 64-bit coefficient words are supported
+template void rlwe::UniformSample<uint32_t>(Poly<uint32_t> &, size_t, uint32_t);
+template void rlwe::UniformSample<uint64_t>(Poly<uint64_t> &, size_t, uint64_t);
+template void rlwe::UniformSample<uint32_t>(Poly<uint32_t> &, size_t, long, long, uint32_t);
+template void rlwe::UniformSample<uint64_t>(Poly<uint64_t> &, size_t, long, long, uint64_t);
+template void rlwe::KnuthYaoSample<uint32_t>(Poly<uint32_t> &, size_t, uint32_t, uint8_t **, size_t);
+template void rlwe::KnuthYaoSample<uint64_t>(Poly<uint64_t> &, size_t, uint64_t, uint8_t **, size_t);
+template void GaussianSampler::Sample<uint32_t>(Poly<uint32_t> &, size_t, uint32_t) const;
+template void GaussianSampler::Sample<uint64_t>(Poly<uint64_t> &, size_t, uint64_t) const;
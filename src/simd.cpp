@@ -0,0 +1,401 @@
+#include "simd.h"
+#include "keccak-tiny.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RLWE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace rlwe;
+
+// Range checks are rewritten as a single unsigned comparison per value, since x in [lo, hi] is the same as (x - lo) <= (hi - lo)
+
+/* Scalar kernels */
+
+template <typename T>
+static void AndScalar(T * result, const T * values, size_t len, T mask) {
+  for (size_t i = 0; i < len; i++) {
+    result[i] = values[i] & mask;
+  }
+}
+
+template <typename T>
+static void RightShiftScalar(T * result, const T * values, size_t len, unsigned long bits) {
+  for (size_t i = 0; i < len; i++) {
+    result[i] = bits >= 8 * sizeof(T) ? 0 : values[i] >> bits;
+  }
+}
+
+// Checks that (x - offset) <= limit for every value
+template <typename T>
+static bool AllWithinScalar(const T * values, size_t len, T offset, T limit) {
+  for (size_t i = 0; i < len; i++) {
+    if ((T) (values[i] - offset) > limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that (x - offset) >= limit for every value
+template <typename T>
+static bool AllBeyondScalar(const T * values, size_t len, T offset, T limit) {
+  for (size_t i = 0; i < len; i++) {
+    if ((T) (values[i] - offset) < limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#ifdef RLWE_SIMD_X86
+
+/* AVX2 kernels, 256 bits at a time */
+
+#define RLWE_AVX2 __attribute__((target("avx2")))
+
+RLWE_AVX2 static void AndAVX2(uint32_t * result, const uint32_t * values, size_t len, uint32_t mask) {
+  __m256i m = _mm256_set1_epi32((int) mask);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    _mm256_storeu_si256((__m256i *) (result + i), _mm256_and_si256(v, m));
+  }
+  AndScalar(result + i, values + i, len - i, mask);
+}
+
+RLWE_AVX2 static void AndAVX2(uint64_t * result, const uint64_t * values, size_t len, uint64_t mask) {
+  __m256i m = _mm256_set1_epi64x((long long) mask);
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    _mm256_storeu_si256((__m256i *) (result + i), _mm256_and_si256(v, m));
+  }
+  AndScalar(result + i, values + i, len - i, mask);
+}
+
+// The shift instructions already produce 0 for counts of the word size or more
+RLWE_AVX2 static void RightShiftAVX2(uint32_t * result, const uint32_t * values, size_t len, unsigned long bits) {
+  __m128i count = _mm_set_epi64x(0, (long long) (bits > 32 ? 32 : bits));
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    _mm256_storeu_si256((__m256i *) (result + i), _mm256_srl_epi32(v, count));
+  }
+  RightShiftScalar(result + i, values + i, len - i, bits);
+}
+
+RLWE_AVX2 static void RightShiftAVX2(uint64_t * result, const uint64_t * values, size_t len, unsigned long bits) {
+  __m128i count = _mm_set_epi64x(0, (long long) (bits > 64 ? 64 : bits));
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    _mm256_storeu_si256((__m256i *) (result + i), _mm256_srl_epi64(v, count));
+  }
+  RightShiftScalar(result + i, values + i, len - i, bits);
+}
+
+// For 32-bit words, a <= b exactly when max(a, b) == b
+RLWE_AVX2 static bool AllWithinAVX2(const uint32_t * values, size_t len, uint32_t offset, uint32_t limit) {
+  __m256i o = _mm256_set1_epi32((int) offset);
+  __m256i l = _mm256_set1_epi32((int) limit);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (values + i)), o);
+    __m256i ok = _mm256_cmpeq_epi32(_mm256_max_epu32(d, l), l);
+    if (_mm256_movemask_epi8(ok) != -1) {
+      return false;
+    }
+  }
+  return AllWithinScalar(values + i, len - i, offset, limit);
+}
+
+RLWE_AVX2 static bool AllBeyondAVX2(const uint32_t * values, size_t len, uint32_t offset, uint32_t limit) {
+  __m256i o = _mm256_set1_epi32((int) offset);
+  __m256i l = _mm256_set1_epi32((int) limit);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (values + i)), o);
+    __m256i ok = _mm256_cmpeq_epi32(_mm256_max_epu32(d, l), d);
+    if (_mm256_movemask_epi8(ok) != -1) {
+      return false;
+    }
+  }
+  return AllBeyondScalar(values + i, len - i, offset, limit);
+}
+
+// For 64-bit words there is no unsigned comparison, so both sides are flipped into signed order first
+RLWE_AVX2 static bool AllWithinAVX2(const uint64_t * values, size_t len, uint64_t offset, uint64_t limit) {
+  __m256i o = _mm256_set1_epi64x((long long) offset);
+  __m256i sign = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+  __m256i l = _mm256_xor_si256(_mm256_set1_epi64x((long long) limit), sign);
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256i d = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *) (values + i)), o);
+    __m256i bad = _mm256_cmpgt_epi64(_mm256_xor_si256(d, sign), l);
+    if (!_mm256_testz_si256(bad, bad)) {
+      return false;
+    }
+  }
+  return AllWithinScalar(values + i, len - i, offset, limit);
+}
+
+RLWE_AVX2 static bool AllBeyondAVX2(const uint64_t * values, size_t len, uint64_t offset, uint64_t limit) {
+  __m256i o = _mm256_set1_epi64x((long long) offset);
+  __m256i sign = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+  __m256i l = _mm256_xor_si256(_mm256_set1_epi64x((long long) limit), sign);
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256i d = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *) (values + i)), o);
+    __m256i bad = _mm256_cmpgt_epi64(l, _mm256_xor_si256(d, sign));
+    if (!_mm256_testz_si256(bad, bad)) {
+      return false;
+    }
+  }
+  return AllBeyondScalar(values + i, len - i, offset, limit);
+}
+
+/* AVX-512 kernels, 512 bits at a time */
+
+#define RLWE_AVX512 __attribute__((target("avx512f")))
+
+RLWE_AVX512 static void AndAVX512(uint32_t * result, const uint32_t * values, size_t len, uint32_t mask) {
+  __m512i m = _mm512_set1_epi32((int) mask);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i v = _mm512_loadu_si512((const void *) (values + i));
+    _mm512_storeu_si512((void *) (result + i), _mm512_and_si512(v, m));
+  }
+  AndScalar(result + i, values + i, len - i, mask);
+}
+
+RLWE_AVX512 static void AndAVX512(uint64_t * result, const uint64_t * values, size_t len, uint64_t mask) {
+  __m512i m = _mm512_set1_epi64((long long) mask);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512i v = _mm512_loadu_si512((const void *) (values + i));
+    _mm512_storeu_si512((void *) (result + i), _mm512_and_si512(v, m));
+  }
+  AndScalar(result + i, values + i, len - i, mask);
+}
+
+RLWE_AVX512 static void RightShiftAVX512(uint32_t * result, const uint32_t * values, size_t len, unsigned long bits) {
+  __m128i count = _mm_set_epi64x(0, (long long) (bits > 32 ? 32 : bits));
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i v = _mm512_loadu_si512((const void *) (values + i));
+    _mm512_storeu_si512((void *) (result + i), _mm512_srl_epi32(v, count));
+  }
+  RightShiftScalar(result + i, values + i, len - i, bits);
+}
+
+RLWE_AVX512 static void RightShiftAVX512(uint64_t * result, const uint64_t * values, size_t len, unsigned long bits) {
+  __m128i count = _mm_set_epi64x(0, (long long) (bits > 64 ? 64 : bits));
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512i v = _mm512_loadu_si512((const void *) (values + i));
+    _mm512_storeu_si512((void *) (result + i), _mm512_srl_epi64(v, count));
+  }
+  RightShiftScalar(result + i, values + i, len - i, bits);
+}
+
+RLWE_AVX512 static bool AllWithinAVX512(const uint32_t * values, size_t len, uint32_t offset, uint32_t limit) {
+  __m512i o = _mm512_set1_epi32((int) offset);
+  __m512i l = _mm512_set1_epi32((int) limit);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i d = _mm512_sub_epi32(_mm512_loadu_si512((const void *) (values + i)), o);
+    if (_mm512_cmpgt_epu32_mask(d, l) != 0) {
+      return false;
+    }
+  }
+  return AllWithinScalar(values + i, len - i, offset, limit);
+}
+
+RLWE_AVX512 static bool AllBeyondAVX512(const uint32_t * values, size_t len, uint32_t offset, uint32_t limit) {
+  __m512i o = _mm512_set1_epi32((int) offset);
+  __m512i l = _mm512_set1_epi32((int) limit);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i d = _mm512_sub_epi32(_mm512_loadu_si512((const void *) (values + i)), o);
+    if (_mm512_cmplt_epu32_mask(d, l) != 0) {
+      return false;
+    }
+  }
+  return AllBeyondScalar(values + i, len - i, offset, limit);
+}
+
+RLWE_AVX512 static bool AllWithinAVX512(const uint64_t * values, size_t len, uint64_t offset, uint64_t limit) {
+  __m512i o = _mm512_set1_epi64((long long) offset);
+  __m512i l = _mm512_set1_epi64((long long) limit);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512i d = _mm512_sub_epi64(_mm512_loadu_si512((const void *) (values + i)), o);
+    if (_mm512_cmpgt_epu64_mask(d, l) != 0) {
+      return false;
+    }
+  }
+  return AllWithinScalar(values + i, len - i, offset, limit);
+}
+
+RLWE_AVX512 static bool AllBeyondAVX512(const uint64_t * values, size_t len, uint64_t offset, uint64_t limit) {
+  __m512i o = _mm512_set1_epi64((long long) offset);
+  __m512i l = _mm512_set1_epi64((long long) limit);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512i d = _mm512_sub_epi64(_mm512_loadu_si512((const void *) (values + i)), o);
+    if (_mm512_cmplt_epu64_mask(d, l) != 0) {
+      return false;
+    }
+  }
+  return AllBeyondScalar(values + i, len - i, offset, limit);
+}
+
+#endif
+
+/* Dispatch */
+
+static simd::InstructionSet DetectInstructionSet() {
+#ifdef RLWE_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return simd::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return simd::AVX2;
+  }
+#endif
+  return simd::SCALAR;
+}
+
+static std::atomic<int> & ActiveInstructionSet() {
+  static std::atomic<int> active(simd::GetSupportedInstructionSet());
+  return active;
+}
+
+simd::InstructionSet simd::GetSupportedInstructionSet() {
+  static InstructionSet supported = DetectInstructionSet();
+  return supported;
+}
+
+simd::InstructionSet simd::GetInstructionSet() {
+  return (InstructionSet) ActiveInstructionSet().load(std::memory_order_relaxed);
+}
+
+void simd::SetInstructionSet(InstructionSet set) {
+  InstructionSet supported = GetSupportedInstructionSet();
+  ActiveInstructionSet().store(set < supported ? set : supported, std::memory_order_relaxed);
+}
+
+template <typename T>
+void simd::And(T * result, const T * values, size_t len, T mask) {
+  switch (GetInstructionSet()) {
+#ifdef RLWE_SIMD_X86
+    case AVX512:
+      AndAVX512(result, values, len, mask);
+      return;
+    case AVX2:
+      AndAVX2(result, values, len, mask);
+      return;
+#endif
+    default:
+      AndScalar(result, values, len, mask);
+  }
+}
+
+template <typename T>
+void simd::RightShift(T * result, const T * values, size_t len, unsigned long bits) {
+  switch (GetInstructionSet()) {
+#ifdef RLWE_SIMD_X86
+    case AVX512:
+      RightShiftAVX512(result, values, len, bits);
+      return;
+    case AVX2:
+      RightShiftAVX2(result, values, len, bits);
+      return;
+#endif
+    default:
+      RightShiftScalar(result, values, len, bits);
+  }
+}
+
+template <typename T>
+static bool AllWithin(const T * values, size_t len, T offset, T limit) {
+  switch (simd::GetInstructionSet()) {
+#ifdef RLWE_SIMD_X86
+    case simd::AVX512:
+      return AllWithinAVX512(values, len, offset, limit);
+    case simd::AVX2:
+      return AllWithinAVX2(values, len, offset, limit);
+#endif
+    default:
+      return AllWithinScalar(values, len, offset, limit);
+  }
+}
+
+template <typename T>
+static bool AllBeyond(const T * values, size_t len, T offset, T limit) {
+  switch (simd::GetInstructionSet()) {
+#ifdef RLWE_SIMD_X86
+    case simd::AVX512:
+      return AllBeyondAVX512(values, len, offset, limit);
+    case simd::AVX2:
+      return AllBeyondAVX2(values, len, offset, limit);
+#endif
+    default:
+      return AllBeyondScalar(values, len, offset, limit);
+  }
+}
+
+template <typename T>
+bool simd::IsInRange(const T * values, size_t len, T lower, T upper) {
+  // An empty range only holds for an empty array
+  if (lower > upper) {
+    return len == 0;
+  }
+  return AllWithin(values, len, lower, (T) (upper - lower));
+}
+
+template <typename T>
+bool simd::IsInCenteredRange(const T * values, size_t len, T bound, T mod) {
+  // Values in [bound + 1, mod - bound) lie outside of [-bound, bound] once centered
+  T lower = bound + 1;
+  T upper = mod - bound;
+  if (lower == 0 || upper <= lower) {
+    return true;
+  }
+  return AllBeyond(values, len, lower, (T) (upper - lower));
+}
+
+void simd::KeccakF1600x4(uint64_t states[100]) {
+#ifdef RLWE_SIMD_X86
+  if (GetInstructionSet() >= AVX2) {
+    keccakf1600x4_avx2(states);
+    return;
+  }
+#endif
+
+  // Permute the four states one after the other
+  uint64_t state[25];
+  for (size_t k = 0; k < 4; k++) {
+    for (size_t i = 0; i < 25; i++) {
+      state[i] = states[4 * i + k];
+    }
+    keccakf1600(state);
+    for (size_t i = 0; i < 25; i++) {
+      states[4 * i + k] = state[i];
+    }
+  }
+}
+
+// Only 32-bit and 64-bit coefficient words are supported
+template void simd::And<uint32_t>(uint32_t *, const uint32_t *, size_t, uint32_t);
+template void simd::And<uint64_t>(uint64_t *, const uint64_t *, size_t, uint64_t);
+template void simd::RightShift<uint32_t>(uint32_t *, const uint32_t *, size_t, unsigned long);
+template void simd::RightShift<uint64_t>(uint64_t *, const uint64_t *, size_t, unsigned long);
+template bool simd::IsInRange<uint32_t>(const uint32_t *, size_t, uint32_t, uint32_t);
+template bool simd::IsInRange<uint64_t>(const uint64_t *, size_t, uint64_t, uint64_t);
+template bool simd::IsInCenteredRange<uint32_t>(const uint32_t *, size_t, uint32_t, uint32_t);
+template bool simd::IsInCenteredRange<uint64_t>(const uint64_t *, size_t, uint64_t, uint64_t);
@@ -8,80 +8,77 @@
 using namespace rlwe;
 using namespace rlwe::tesla;
 
-bool CheckError(const ZZX & e, uint32_t w, const ZZ & L) {
-  // Sort all of the coefficients in descending order
-  std::vector<ZZ> coeffs;
-  for (int i = 0; i <= deg(e); i++) {
-    coeffs.push_back(coeff(e, i));
+bool CheckError(const Poly<uint32_t> & e, uint32_t w, const ZZ & L, uint32_t q) {
+  // Sort all of the (centered) coefficients in descending order
+  std::vector<long> coeffs;
+  for (size_t i = 0; i < e.GetLength(); i++) {
+    coeffs.push_back(e[i] > q / 2 ? (long) e[i] - (long) q : (long) e[i]);
   }
   std::sort(coeffs.begin(), coeffs.end());
   std::reverse(coeffs.begin(), coeffs.end());
 
   // Sum the top `w` coefficients 
-  ZZ sum(0);
+  long sum = 0;
   for (int i = 0; i < w; i++) {
     sum += coeffs[i];
   }
 
   // Make sure that the sum is less than the given error bound
-  return sum <= L;
+  return sum <= to_long(L);
 }
 
 void tesla::GenerateSigningKey(SigningKey & signer) {
   const KeyParameters & params = signer.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
 
   // Generate error polynomial e1
-  ZZX e1;
+  Poly<uint32_t> e1;
   bool check = false;
   while (!check) {
-    e1 = KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows());
-    check = CheckError(e1, params.GetEncodingWeight(), params.GetErrorBound());
+    params.GetGaussianSampler().Sample(e1, n, q);
+    check = CheckError(e1, params.GetEncodingWeight(), params.GetErrorBound(), q);
   }
 
   // Generate error polynomial e2
-  ZZX e2;
+  Poly<uint32_t> e2;
   check = false;
   while (!check) {
-    e2 = KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows());
-    check = CheckError(e2, params.GetEncodingWeight(), params.GetErrorBound());
+    params.GetGaussianSampler().Sample(e2, n, q);
+    check = CheckError(e2, params.GetEncodingWeight(), params.GetErrorBound(), q);
   }
 
-  // Set error values if they have passed all checks
+  // Set error values if they have passed all checks; like the secret, they are only ever multiplied by the sparse c
   signer.SetErrors(e1, e2);
 
   // Sample secret polynomial from same Gaussian distribution
-  signer.SetSecret(KnuthYaoSample(
-        params.GetPolyModulusDegree(), 
-        params.GetProbabilityMatrix(), 
-        params.GetProbabilityMatrixRows()));
+  Poly<uint32_t> s;
+  params.GetGaussianSampler().Sample(s, n, q);
+  signer.SetSecret(s);
 }
 
 void tesla::GenerateVerificationKey(VerificationKey & verif, const SigningKey & signer) {
   const KeyParameters & params = signer.GetParameters();
   assert(params == verif.GetParameters()); 
 
-  // Setup global coefficient modulus 
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
-  // Perform conversions to ZZ_p-reduced polynomials
-  ZZ_pX s =  conv<ZZ_pX>(signer.GetSecret());
-  ZZ_pX e1 = conv<ZZ_pX>(signer.GetErrors().a); 
-  ZZ_pX e2 = conv<ZZ_pX>(signer.GetErrors().b); 
-  ZZ_pX a1 = conv<ZZ_pX>(params.GetPolyConstants().a);
-  ZZ_pX a2 = conv<ZZ_pX>(params.GetPolyConstants().b);
+  const RingContext<uint32_t> & ring = params.GetRing();
+  const Poly<uint32_t> & s = signer.GetSecret();
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & e = signer.GetErrors();
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & a = params.GetPolyConstants();
 
+  // The constants are in the evaluation domain and the keys in the coefficient domain, where the products end up
   // t1 = a1 * s + e1 
-  ZZ_pX t1;
-  MulMod(t1, a1, s, params.GetPolyModulus());
-  t1 += e1; 
+  Poly<uint32_t> t1;
+  ring.Multiply(t1, a.a, s);
+  ring.Add(t1, t1, e.a);
 
   // t2 = a2 * s + e2
-  ZZ_pX t2;
-  MulMod(t2, a2, s, params.GetPolyModulus());
-  t2 += e2;
+  Poly<uint32_t> t2;
+  ring.Multiply(t2, a.b, s);
+  ring.Add(t2, t2, e.b);
 
-  verif.SetValues(conv<ZZX>(t1), conv<ZZX>(t2));
+  verif.SetValues(t1, t2);
 }
 
 SigningKey tesla::GenerateSigningKey(const KeyParameters & params) {
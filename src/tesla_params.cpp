@@ -22,26 +22,33 @@ KeyParameters::KeyParameters(const ZZX & a1, const ZZX & a2) :
 KeyParameters::KeyParameters(const ZZX & a1, const ZZX & a2, 
     size_t n, float sigma, const ZZ & L, uint32_t w, 
     const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q) :
-  a(a1, a2), n(n), sigma(sigma), L(L), w(w), B(B), U(U), d(d), q(q), pow_2d(power_ZZ(2, d))
+  KeyParameters(a1, a2, n, sigma, L, w, B, U, d, q, DEFAULT_GAUSSIAN_SAMPLER) {}
+
+KeyParameters::KeyParameters(const ZZX & a1, const ZZX & a2, 
+    size_t n, float sigma, const ZZ & L, uint32_t w, 
+    const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q,
+    GaussianSamplerType sampler_type) :
+  KeyParameters(a1, a2, n, sigma, L, w, B, U, d, q, sampler_type, DEFAULT_HASH_VERSION) {}
+
+KeyParameters::KeyParameters(const ZZX & a1, const ZZX & a2, 
+    size_t n, float sigma, const ZZ & L, uint32_t w, 
+    const ZZ & B, const ZZ & U, uint32_t d, const ZZ & q,
+    GaussianSamplerType sampler_type, HashVersion hash_version) :
+  n(n), sigma(sigma), L(L), w(w), B(B), U(U), d(d), q(q), pow_2d(power_ZZ(2, d)), ring(n, q), hash_version(hash_version)
 {
   // Assert that n is even, assume that it is a power of 2
   assert(n % 2 == 0);
 
-  // Doesn't matter what this is, since the max coefficient is 1 for the cyclotomic polynomial
-  ZZ_pPush push;
-  ZZ_p::init(q);
-
-  // Create a cyclotomic polynomial that serves as the modulus for the ring
-  ZZ_pX cyclotomic;
-
-  // The cyclotomic polynomial is x^n + 1 
-  SetCoeff(cyclotomic, n, 1);
-  SetCoeff(cyclotomic, 0, 1);
+  // Store the public constants in the same word-based form (and domain) as the keys
+  ring.Reduce(a.a, a1);
+  ring.Reduce(a.b, a2);
+  ring.ToEvaluationDomain(a.a, a.a);
+  ring.ToEvaluationDomain(a.b, a.b);
 
-  // Build the modulus using the cyclotomic polynomial representation
-  build(phi, cyclotomic);
+  // Build the error sampler (e.g. the Knuth-Yao probability matrix)
+  sampler = GaussianSampler::Create(sampler_type, sigma);
 
-  // Generate probability matrix
-  pmat_rows = sigma * PROBABILITY_MATRIX_BOUNDS_SCALAR;
-  pmat = KnuthYaoGaussianMatrix(pmat_rows, sigma); 
+  // Coefficients of q are rounded down to their bits above the d least significant ones before being hashed
+  long rounded_bits = NumBits(q - 1) - (long) d;
+  hash_coeff_bytes = rounded_bits > 8 ? (rounded_bits + 8 - 1) / 8 : 1;
 }
@@ -1,146 +1,257 @@
 #include "tesla.h"
 #include "sample.h"
 #include "polyutil.h"
+#include "parallel.h"
+#include "trace.h"
 
 #include <cassert>
+#include <atomic>
+#include <memory>
 
 using namespace rlwe;
 using namespace rlwe::tesla;
 
-void tesla::Sign(Signature & sig, const std::string & message, const SigningKey & signer) {
-  const KeyParameters & params = signer.GetParameters();
-  assert(params == sig.GetParameters());
+// Message as it enters the hash of each signing attempt: either its raw bytes or the digest of a prehashed message
+struct MessageView {
+  const unsigned char * data;
+  size_t len;
+  bool prehashed;
 
-  // Setup global coefficient modulus 
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
+  MessageView(const unsigned char * data, size_t len, bool prehashed) : data(data), len(len), prehashed(prehashed) {}
+  MessageView(const std::string & message) : 
+    MessageView(reinterpret_cast<const unsigned char *>(message.data()), message.size(), false) {}
+};
 
-  // Convert given a1, a2, e1, e2, s into polynomials under the global modulus
-  ZZ_pX a1 = conv<ZZ_pX>(params.GetPolyConstants().a);
-  ZZ_pX a2 = conv<ZZ_pX>(params.GetPolyConstants().b);
-  ZZ_pX e1 = conv<ZZ_pX>(signer.GetErrors().a);
-  ZZ_pX e2 = conv<ZZ_pX>(signer.GetErrors().b);
-  ZZ_pX s = conv<ZZ_pX>(signer.GetSecret());
+static void HashMessage(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+    const MessageView & message, const KeyParameters & params) {
+  if (message.prehashed) {
+    HashPrehashed(output, p1, p2, message.data, params);
+  }
+  else {
+    Hash(output, p1, p2, message.data, message.len, params);
+  }
+}
 
-  // Declare signature variables 
-  ZZX z;
+// Scratch space for one signing attempt, which also holds the attempt's signature
+struct SigningBuffers {
+  Poly<uint32_t> y;
+  Poly<uint32_t> y_hat;
+  Poly<uint32_t> v1;
+  Poly<uint32_t> v2;
+  Poly<uint32_t> w1;
+  Poly<uint32_t> w2;
+  SparseTernaryPoly c;
+  Poly<uint32_t> z;
   unsigned char c_prime[crypto_hash_sha256_BYTES];
-    
-  // Declare temporary variables
-  ZZ bound;
-  ZZX y, v1, v2, c, w1, w2;
-  ZZ_pX y_p, v1_p, v2_p, c_p, w1_p, w2_p, buffer;
-
-  while (1) {
-    // Sample y from R_{q,[B]}
-    UniformSample(y, params.GetPolyModulusDegree(), -params.GetSignatureBound(), params.GetSignatureBound() + 1);
-    conv(y_p, y);
-
-    // v1 = a1 * y in R_q
-    MulMod(v1_p, a1, y_p, params.GetPolyModulus());
-    conv(v1, v1_p);  
-
-    // v2 = a2 * y in R_q
-    MulMod(v2_p, a2, y_p, params.GetPolyModulus());
-    conv(v2, v2_p);
-
-    // c' = Hash(v1, v2, u)
-    Hash(c_prime, v1, v2, message, params);
-    Encode(c, c_prime, params);
-    conv(c_p, c);
-
-    // z = y + s * c in Z
-    MulMod(z, signer.GetSecret(), c, conv<ZZX>(params.GetPolyModulus().val()));
-    z += y; 
-
-    // Assert that z is in the ring R_{B - U}
-    bound = params.GetSignatureBound() - params.GetSignatureBoundAdjustment();
-    if (!IsInRange(z, -bound, bound)) {
-      continue;
-    }
+};
 
-    // w1, w2 need to fall within bound 2^d - L
-    bound = params.GetLSBValue() - params.GetErrorBound();
+// Makes one attempt at signing with a fresh y, returning whether it passed all of the rejection conditions
+static bool TrySign(const MessageView & message, const SigningKey & signer, SigningBuffers & buffers) {
+  const KeyParameters & params = signer.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = ring.GetModulus();
 
-    // w1 = v1 - e1 * c in R_q
-    w1_p = v1_p; 
-    MulMod(buffer, e1, c_p, params.GetPolyModulus());
-    w1_p -= buffer;
-    conv(w1, w1_p);
+  // Extract a1, a2 (kept in the evaluation domain) and e1, e2, s (kept in the coefficient domain, since they are only multiplied by c)
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & a = params.GetPolyConstants();
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & e = signer.GetErrors();
+  const Poly<uint32_t> & s = signer.GetSecret();
 
-    // d least significant bits in w1 need to be in the middle range 
-    AndPoly(w1, w1, params.GetLSBValue() - 1);
-    if (!IsInRange(w1, params.GetErrorBound(), bound)) {
-      continue;
-    }
+  // Precompute the bounds used in the rejection conditions, in words so that no temporary integers are built
+  long B = to_long(params.GetSignatureBound());
+  uint32_t z_bound = (uint32_t) (to_ulong(params.GetSignatureBound()) - to_ulong(params.GetSignatureBoundAdjustment()));
+  uint32_t lsb_mask = (uint32_t) (to_ulong(params.GetLSBValue()) - 1);
+  uint32_t lower = (uint32_t) to_ulong(params.GetErrorBound());
+  uint32_t upper = (uint32_t) (to_ulong(params.GetLSBValue()) - to_ulong(params.GetErrorBound()));
+  uint32_t w_max = q - 1 - lower;
 
-    // w2 = v2 - e2 * c in R_q
-    w2_p = v2_p;
-    MulMod(buffer, e2, c_p, params.GetPolyModulus());
-    w2_p -= buffer;
-    conv(w2, w2_p);
+  // Temporary variables; y is transformed once per attempt, while the sparse c is never transformed
+  Poly<uint32_t> & y = buffers.y;
+  Poly<uint32_t> & y_hat = buffers.y_hat;
+  Poly<uint32_t> & v1 = buffers.v1;
+  Poly<uint32_t> & v2 = buffers.v2;
+  Poly<uint32_t> & w1 = buffers.w1;
+  Poly<uint32_t> & w2 = buffers.w2;
+  SparseTernaryPoly & c = buffers.c;
+  Poly<uint32_t> & z = buffers.z;
 
-    // d least significant bits in w2 need to be in the middle range 
-    AndPoly(w2, w2, params.GetLSBValue() - 1);
-    if (!IsInRange(w2, params.GetErrorBound(), bound)) {
-      continue;
-    }
+  // Sample y from R_{q,[B]}
+  UniformSample(y, n, -B, B + 1, q);
+  ring.ToEvaluationDomain(y_hat, y);
 
-    break;
+  // v1 = a1 * y in R_q
+  ring.Multiply(v1, a.a, y_hat);
+  ring.ToCoefficientDomain(v1, v1);
+
+  // v2 = a2 * y in R_q
+  ring.Multiply(v2, a.b, y_hat);
+  ring.ToCoefficientDomain(v2, v2);
+
+  // c' = Hash(v1, v2, u)
+  HashMessage(buffers.c_prime, v1, v2, message, params);
+  Encode(c, buffers.c_prime, params);
+
+  // z = y + s * c; every coefficient is far smaller than q / 2, so the centered result in R_q matches the one in Z
+  ring.Multiply(z, s, c);
+  ring.Add(z, z, y);
+
+  // Assert that z is in the ring R_{B - U}
+  if (!IsInCenteredRange(z, z_bound, q)) {
+    RLWE_TRACE_COUNT(COUNTER_SIGN_REJECTED_Z, 1);
+    return false;
   }
 
-  sig.SetValue(z);
-  sig.SetHash(c_prime);
+  // w1 = v1 - e1 * c in R_q
+  ring.Multiply(w1, e.a, c);
+  ring.Subtract(w1, v1, w1);
+
+  // w1 must stay at least L below q, or [...]_{d,q} of v1 = w1 + e1 * c could wrap around q and differ from the verifier's
+  if (!IsInRange(w1, (uint32_t) 0, w_max)) {
+    RLWE_TRACE_COUNT(COUNTER_SIGN_REJECTED_W, 1);
+    return false;
+  }
+
+  // d least significant bits in w1 need to be in the middle range 
+  AndPoly(w1, w1, lsb_mask);
+  if (!IsInRange(w1, lower, upper)) {
+    RLWE_TRACE_COUNT(COUNTER_SIGN_REJECTED_W, 1);
+    return false;
+  }
+
+  // w2 = v2 - e2 * c in R_q
+  ring.Multiply(w2, e.b, c);
+  ring.Subtract(w2, v2, w2);
+
+  // w2 must stay at least L below q, or [...]_{d,q} of v2 = w2 + e2 * c could wrap around q and differ from the verifier's
+  if (!IsInRange(w2, (uint32_t) 0, w_max)) {
+    RLWE_TRACE_COUNT(COUNTER_SIGN_REJECTED_W, 1);
+    return false;
+  }
+
+  // d least significant bits in w2 need to be in the middle range 
+  AndPoly(w2, w2, lsb_mask);
+  if (!IsInRange(w2, lower, upper)) {
+    RLWE_TRACE_COUNT(COUNTER_SIGN_REJECTED_W, 1);
+    return false;
+  }
+  return true;
 }
 
-bool tesla::Verify(const std::string & message, const Signature & sig, const VerificationKey & verif) {
+static void SignMessage(Signature & sig, const MessageView & message, const SigningKey & signer) {
+  assert(signer.GetParameters() == sig.GetParameters());
+
+  // Each thread keeps its buffers, so that signing never allocates once warmed up
+  thread_local SigningBuffers buffers;
+  size_t attempts = 1;
+  while (!TrySign(message, signer, buffers)) {
+    attempts++;
+  }
+  RLWE_TRACE_RECORD(DISTRIBUTION_SIGN_ATTEMPTS, attempts);
+
+  sig.SetValue(buffers.z);
+  sig.SetHash(buffers.c_prime);
+}
+
+void tesla::Sign(Signature & sig, const std::string & message, const SigningKey & signer) {
+  SignMessage(sig, message, signer);
+}
+
+void tesla::Sign(Signature & sig, const unsigned char * message, size_t len, const SigningKey & signer) {
+  SignMessage(sig, MessageView(message, len, false), signer);
+}
+
+void tesla::SignPrehashed(Signature & sig, const unsigned char * digest, const SigningKey & signer) {
+  SignMessage(sig, MessageView(digest, PREHASH_BYTE_LENGTH, true), signer);
+}
+
+void tesla::Sign(Signature & sig, const std::string & message, const SigningKey & signer, size_t candidate_count) {
+  assert(signer.GetParameters() == sig.GetParameters());
+  assert(candidate_count > 0);
+
+  // Each round tries candidate_count values of y across the library's thread pool
+  // Candidates that start after another one has passed are skipped, so a lone thread does no more work than Sign
+  MessageView view(message);
+  std::vector<SigningBuffers> candidates(candidate_count);
+  std::unique_ptr<bool[]> passed(new bool[candidate_count]);
+  for (size_t rounds = 1; ; rounds++) {
+    std::atomic<bool> found(false);
+    ThreadPool::GetInstance().ParallelFor(candidate_count, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        passed[i] = !found && TrySign(view, signer, candidates[i]);
+        if (passed[i]) {
+          found = true;
+        }
+      }
+    });
+
+    // Any candidate that passed is a valid signature; the lowest one is committed
+    for (size_t i = 0; i < candidate_count; i++) {
+      if (passed[i]) {
+        sig.SetValue(candidates[i].z);
+        sig.SetHash(candidates[i].c_prime);
+        RLWE_TRACE_RECORD(DISTRIBUTION_SPECULATIVE_SIGN_ROUNDS, rounds);
+        return;
+      }
+    }
+  }
+}
+
+// Scratch polynomials for verifying a signature, reused across the signatures of a batch (or, on each thread, across single signatures)
+struct VerificationBuffers {
+  SparseTernaryPoly c;
+  Poly<uint32_t> z_hat;
+  Poly<uint32_t> buffer;
+  Poly<uint32_t> w1_prime;
+  Poly<uint32_t> w2_prime;
+};
+
+static bool VerifyWithBuffers(const MessageView & message, const Signature & sig, const VerificationKey & verif, VerificationBuffers & buffers) {
   assert(sig.GetParameters() == verif.GetParameters());
   const KeyParameters & params = sig.GetParameters();
+  const RingContext<uint32_t> & ring = params.GetRing();
 
   // Assert that z is in the ring R_{B - U} 
-  ZZ bound = params.GetSignatureBound() - params.GetSignatureBoundAdjustment();
-  if (!IsInRange(sig.GetValue(), -bound, bound)) {
+  const Poly<uint32_t> & z = sig.GetValue();
+  uint32_t z_bound = (uint32_t) (to_ulong(params.GetSignatureBound()) - to_ulong(params.GetSignatureBoundAdjustment()));
+  if (z.GetLength() != params.GetPolyModulusDegree() || !IsInCenteredRange(z, z_bound, ring.GetModulus())) {
     return false;
   }
 
-  // Setup global coefficient modulus 
-  ZZ_pPush push;
-  ZZ_p::init(params.GetCoeffModulus());
-
   // Extract polynomials serving as global constants
-  ZZ_pX a1 = conv<ZZ_pX>(params.GetPolyConstants().a);
-  ZZ_pX a2 = conv<ZZ_pX>(params.GetPolyConstants().b);
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & a = params.GetPolyConstants();
 
   // Extract polynomials from verification key 
-  ZZ_pX t1 = conv<ZZ_pX>(verif.GetValues().a);
-  ZZ_pX t2 = conv<ZZ_pX>(verif.GetValues().b);
+  const Pair<Poly<uint32_t>, Poly<uint32_t>> & t = verif.GetValues();
+
+  // Recover the challenge polynomial from the signature's hash
+  SparseTernaryPoly & c = buffers.c;
+  Encode(c, sig.GetHash(), params);
 
-  // Extract polynomials from the signing key
-  ZZ_pX z = conv<ZZ_pX>(sig.GetValue());
-  ZZX tmp;
-  Encode(tmp, sig.GetHash(), params);
-  ZZ_pX c = conv<ZZ_pX>(tmp);
+  // The constants are in the evaluation domain, so z is transformed once to match
+  // The verification key stays in the coefficient domain, where it is multiplied by the sparse c directly
+  Poly<uint32_t> & z_hat = buffers.z_hat;
+  ring.ToEvaluationDomain(z_hat, z);
 
   // Setup temporary buffer
-  ZZ_pX buffer;
+  Poly<uint32_t> & buffer = buffers.buffer;
 
   // w1' = a1 * z - t1 * c
-  ZZ_pX w1_prime_p;
-  MulMod(w1_prime_p, a1, z, params.GetPolyModulus());
-  MulMod(buffer, t1, c, params.GetPolyModulus());
-  w1_prime_p -= buffer;
-  ZZX w1_prime = conv<ZZX>(w1_prime_p);
+  Poly<uint32_t> & w1_prime = buffers.w1_prime;
+  ring.Multiply(w1_prime, a.a, z_hat);
+  ring.ToCoefficientDomain(w1_prime, w1_prime);
+  ring.Multiply(buffer, t.a, c);
+  ring.Subtract(w1_prime, w1_prime, buffer);
 
   // w2' = a2 * z - t2 * c
-  ZZ_pX w2_prime_p;
-  MulMod(w2_prime_p, a2, z, params.GetPolyModulus());
-  MulMod(buffer, t2, c, params.GetPolyModulus());
-  w2_prime_p -= buffer;
-  ZZX w2_prime = conv<ZZX>(w2_prime_p);
+  Poly<uint32_t> & w2_prime = buffers.w2_prime;
+  ring.Multiply(w2_prime, a.b, z_hat);
+  ring.ToCoefficientDomain(w2_prime, w2_prime);
+  ring.Multiply(buffer, t.b, c);
+  ring.Subtract(w2_prime, w2_prime, buffer);
    
   // c'' = Hash(w1', w2', message)
   unsigned char c_prime2[crypto_hash_sha256_BYTES];
-  Hash(c_prime2, w1_prime, w2_prime, message, params);
+  HashMessage(c_prime2, w1_prime, w2_prime, message, params);
 
   // Assert that c == c''
   for (int i = 0; i < crypto_hash_sha256_BYTES; i++) {
@@ -152,8 +263,50 @@ bool tesla::Verify(const std::string & message, const Signature & sig, const Ver
   return true;
 }
 
+bool tesla::Verify(const std::string & message, const Signature & sig, const VerificationKey & verif) {
+  thread_local VerificationBuffers buffers;
+  return VerifyWithBuffers(message, sig, verif, buffers);
+}
+
+bool tesla::Verify(const unsigned char * message, size_t len, const Signature & sig, const VerificationKey & verif) {
+  thread_local VerificationBuffers buffers;
+  return VerifyWithBuffers(MessageView(message, len, false), sig, verif, buffers);
+}
+
+bool tesla::VerifyPrehashed(const unsigned char * digest, const Signature & sig, const VerificationKey & verif) {
+  thread_local VerificationBuffers buffers;
+  return VerifyWithBuffers(MessageView(digest, PREHASH_BYTE_LENGTH, true), sig, verif, buffers);
+}
+
+void tesla::VerifyBatch(bool * results, const std::string * messages, const Signature * sigs, 
+    const VerificationKey * const * verifs, size_t count) {
+  // Signatures that fail the range check on z finish early, so threads claim small chunks as they free up
+  ThreadPool::GetInstance().ParallelFor(count, VERIFY_BATCH_GRAIN_SIZE, [&](size_t begin, size_t end) {
+    VerificationBuffers buffers;
+    for (size_t i = begin; i < end; i++) {
+      results[i] = VerifyWithBuffers(messages[i], sigs[i], *verifs[i], buffers);
+    }
+  });
+}
+
+std::vector<bool> tesla::VerifyBatch(const std::vector<std::string> & messages, const std::vector<Signature> & sigs, 
+    const VerificationKey & verif) {
+  assert(messages.size() == sigs.size());
+  size_t count = sigs.size();
+  std::vector<const VerificationKey *> verifs(count, &verif);
+  std::unique_ptr<bool[]> results(new bool[count]);
+  VerifyBatch(results.get(), messages.data(), sigs.data(), verifs.data(), count);
+  return std::vector<bool>(results.get(), results.get() + count);
+}
+
 Signature tesla::Sign(const std::string & message, const SigningKey & signer) {
   Signature sig(signer.GetParameters());
   Sign(sig, message, signer);
   return sig;
 }
+
+Signature tesla::Sign(const std::string & message, const SigningKey & signer, size_t candidate_count) {
+  Signature sig(signer.GetParameters());
+  Sign(sig, message, signer, candidate_count);
+  return sig;
+}
@@ -1,6 +1,8 @@
 #include "tesla.h"
 #include "polyutil.h"
+#include "trace.h"
 
+#include <cassert>
 #include <sstream>
 
 #define RANDOMNESS_SCALE 5
@@ -9,7 +11,34 @@
 using namespace rlwe;
 using namespace rlwe::tesla;
 
+// Writes a polynomial to the stream in NTL's format, which omits any trailing zero coefficients
+static void WriteNormalized(std::stringstream & ss, const Poly<uint32_t> & poly) {
+  size_t len = poly.GetLength();
+  while (len > 0 && poly[len - 1] == 0) {
+    len--;
+  }
+
+  ss << "[";
+  for (size_t i = 0; i < len; i++) {
+    if (i > 0) {
+      ss << " ";
+    }
+    ss << poly[i];
+  }
+  ss << "]";
+}
+
 void tesla::Hash(unsigned char * output, const ZZX & p1, const ZZX & p2, const std::string & message, const KeyParameters & params) {
+  // Only the original format is defined over the integers; the others go through the word-based polynomials
+  if (params.GetHashVersion() != HASH_VERSION_TEXT) {
+    Poly<uint32_t> w1, w2;
+    params.GetRing().Reduce(w1, p1);
+    params.GetRing().Reduce(w2, p2);
+    Hash(output, w1, w2, message, params);
+    return;
+  }
+  RLWE_TRACE_SCOPE(STAGE_HASH);
+
   // Round p1, p2 by applying [...]_{d,q}
   ZZX q1, q2;
   RightShiftPoly(q1, p1, params.GetLSBCount()); 
@@ -30,7 +59,121 @@ void tesla::Hash(unsigned char * output, const ZZX & p1, const ZZX & p2, const s
   crypto_hash_sha256(output, input, inlen);
 }
 
-void tesla::Encode(ZZX & dest, const unsigned char * hash_val, const KeyParameters & params) {
+// Hashes the input in the original text format
+static void HashText(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+    const unsigned char * message, size_t len, const KeyParameters & params) {
+  RLWE_TRACE_SCOPE(STAGE_HASH);
+
+  // Round p1, p2 by applying [...]_{d,q}
+  Poly<uint32_t> q1, q2;
+  RightShiftPoly(q1, p1, params.GetLSBCount()); 
+  RightShiftPoly(q2, p2, params.GetLSBCount()); 
+
+  // Concatenate everything into a single string, writing the polynomials exactly as NTL would
+  std::stringstream ss;
+  WriteNormalized(ss, q1);
+  WriteNormalized(ss, q2);
+  ss.write(reinterpret_cast<const char *>(message), len);
+
+  // Convert stream into actual string
+  std::string cc = ss.str();
+
+  // Convert input into its c_string equivalent
+  const unsigned char * input = reinterpret_cast<const unsigned char *>(cc.c_str());
+  long inlen = cc.length();
+
+  // Perform hash function and store the result 
+  crypto_hash_sha256(output, input, inlen);
+}
+
+// Rounds a polynomial by applying [...]_{d,q} and feeds its coefficients into the hash state, HASH_BLOCK_SIZE at a time
+static void AbsorbRounded(crypto_hash_sha256_state & state, const Poly<uint32_t> & poly, uint32_t d, size_t coeff_bytes) {
+  unsigned char block[HASH_BLOCK_SIZE * sizeof(uint32_t)];
+  for (size_t start = 0; start < poly.GetLength(); start += HASH_BLOCK_SIZE) {
+    size_t end = start + HASH_BLOCK_SIZE < poly.GetLength() ? start + HASH_BLOCK_SIZE : poly.GetLength();
+    size_t k = 0;
+    if (coeff_bytes == 1) {
+      for (size_t i = start; i < end; i++) {
+        block[k++] = (unsigned char) (poly[i] >> d);
+      }
+    }
+    else {
+      for (size_t i = start; i < end; i++) {
+        uint32_t rounded = poly[i] >> d;
+        for (size_t b = 0; b < coeff_bytes; b++) {
+          block[k++] = (unsigned char) (rounded >> (8 * b));
+        }
+      }
+    }
+    crypto_hash_sha256_update(&state, block, k);
+  }
+}
+
+// Hashes the input in the binary format, which starts with the given version byte
+static void HashBinary(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, unsigned char version, 
+    const unsigned char * message, size_t len, const KeyParameters & params) {
+  assert(p1.GetLength() == params.GetPolyModulusDegree() && p2.GetLength() == params.GetPolyModulusDegree());
+  RLWE_TRACE_SCOPE(STAGE_HASH);
+
+  // The polynomials have a fixed length and width, so the message can simply follow them, without being copied
+  crypto_hash_sha256_state state;
+  crypto_hash_sha256_init(&state);
+  crypto_hash_sha256_update(&state, &version, 1);
+  AbsorbRounded(state, p1, params.GetLSBCount(), params.GetHashCoeffByteLength());
+  AbsorbRounded(state, p2, params.GetLSBCount(), params.GetHashCoeffByteLength());
+  crypto_hash_sha256_update(&state, message, len);
+  crypto_hash_sha256_final(&state, output);
+}
+
+void tesla::Hash(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+    const unsigned char * message, size_t len, const KeyParameters & params) {
+  if (params.GetHashVersion() == HASH_VERSION_TEXT) {
+    HashText(output, p1, p2, message, len, params);
+  }
+  else {
+    HashBinary(output, p1, p2, (unsigned char) params.GetHashVersion(), message, len, params);
+  }
+}
+
+void tesla::Hash(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, const std::string & message, const KeyParameters & params) {
+  Hash(output, p1, p2, reinterpret_cast<const unsigned char *>(message.data()), message.size(), params);
+}
+
+void tesla::HashPrehashed(unsigned char * output, const Poly<uint32_t> & p1, const Poly<uint32_t> & p2, 
+    const unsigned char * digest, const KeyParameters & params) {
+  // The flagged version byte keeps these signatures apart from signatures of a message that happens to equal the digest
+  assert(params.GetHashVersion() != HASH_VERSION_TEXT);
+  unsigned char version = (unsigned char) (params.GetHashVersion() | PREHASHED_VERSION_FLAG);
+  HashBinary(output, p1, p2, version, digest, PREHASH_BYTE_LENGTH, params);
+}
+
+void tesla::Prehash(unsigned char * digest, const unsigned char * message, size_t len) {
+  RLWE_TRACE_SCOPE(STAGE_HASH);
+  crypto_hash_sha256(digest, message, len);
+}
+
+bool tesla::Prehash(unsigned char * digest, std::istream & message) {
+  RLWE_TRACE_SCOPE(STAGE_HASH);
+  // Only one block of the message is held in memory at a time
+  crypto_hash_sha256_state state;
+  crypto_hash_sha256_init(&state);
+  char block[PREHASH_BLOCK_BYTE_LENGTH];
+  while (message) {
+    message.read(block, PREHASH_BLOCK_BYTE_LENGTH);
+    crypto_hash_sha256_update(&state, reinterpret_cast<const unsigned char *>(block), message.gcount());
+  }
+  crypto_hash_sha256_final(&state, digest);
+
+  // Reading stops on any failure, and anything other than reaching the end (e.g. an I/O error partway through)
+  // means that only part of the message was digested, which must never be signed
+  if (message.bad() || !message.eof()) {
+    sodium_memzero(digest, PREHASH_BYTE_LENGTH);
+    return false;
+  }
+  return true;
+}
+
+void tesla::Encode(SparseTernaryPoly & dest, const unsigned char * hash_val, const KeyParameters & params) {
   long n = params.GetPolyModulusDegree();
   long w = params.GetEncodingWeight();
 
@@ -48,7 +191,7 @@ void tesla::Encode(ZZX & dest, const unsigned char * hash_val, const KeyParamete
   unsigned char nonce[crypto_stream_chacha20_NONCEBYTES] = NONCE;
   crypto_stream_chacha20(r, rlen, nonce, hash_val);
 
-  clear(dest);
+  dest.SetLength(n);
   size_t widx = 0; // What bit we are on for setting coefficient signs 
   size_t ridx = w_bytes; // Last read byte in buffer used for rejection sampling
 
@@ -69,10 +212,10 @@ void tesla::Encode(ZZX & dest, const unsigned char * hash_val, const KeyParamete
     // Generate a random polynomial index by reducing the bytes by `n`
     cidx %= n;
 
-    if (coeff(dest, cidx) == 0) {
+    if (!dest.Contains(cidx)) {
       // Sample another random byte to determine if coefficient = -1 or 1 
       char bit = ((r[widx / 8] >> (widx % 8)) & 1);
-      SetCoeff(dest, cidx, bit * 2 - 1); 
+      dest.AddTerm(cidx, !bit);
       widx++;
     }
     else {
@@ -81,3 +224,15 @@ void tesla::Encode(ZZX & dest, const unsigned char * hash_val, const KeyParamete
     }
   }
 }
+
+void tesla::Encode(Poly<uint32_t> & dest, const unsigned char * hash_val, const KeyParameters & params) {
+  SparseTernaryPoly sparse;
+  Encode(sparse, hash_val, params);
+  sparse.ToDense(dest, params.GetRing().GetModulus());
+}
+
+void tesla::Encode(ZZX & dest, const unsigned char * hash_val, const KeyParameters & params) {
+  Poly<uint32_t> words;
+  Encode(words, hash_val, params);
+  params.GetRing().Center(dest, words);
+}
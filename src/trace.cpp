@@ -0,0 +1,303 @@
+#include "trace.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+using namespace rlwe;
+using namespace rlwe::trace;
+
+// Histogram that one thread records into while others may read it; the owning thread is its only writer, so
+// relaxed loads and stores are enough, and a reader sees each field as it was at some recent point
+struct LiveHistogram {
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> min;
+  std::atomic<uint64_t> max;
+  std::atomic<uint64_t> buckets[TRACE_HISTOGRAM_BUCKET_COUNT];
+
+  LiveHistogram() {
+    Clear();
+  }
+
+  void Clear() {
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < TRACE_HISTOGRAM_BUCKET_COUNT; i++) {
+      buckets[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void Add(uint64_t value) {
+    uint64_t previous = count.load(std::memory_order_relaxed);
+    if (previous == 0 || value < min.load(std::memory_order_relaxed)) {
+      min.store(value, std::memory_order_relaxed);
+    }
+    if (previous == 0 || value > max.load(std::memory_order_relaxed)) {
+      max.store(value, std::memory_order_relaxed);
+    }
+    sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    std::atomic<uint64_t> & bucket = buckets[Histogram::GetBucket(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count.store(previous + 1, std::memory_order_relaxed);
+  }
+
+  void Load(Histogram & histogram) const {
+    histogram.count = count.load(std::memory_order_relaxed);
+    histogram.sum = sum.load(std::memory_order_relaxed);
+    histogram.min = min.load(std::memory_order_relaxed);
+    histogram.max = max.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < TRACE_HISTOGRAM_BUCKET_COUNT; i++) {
+      histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+};
+
+// Everything one thread has recorded
+struct ThreadRecord {
+  size_t thread_index;
+  LiveHistogram stages[STAGE_COUNT];
+  LiveHistogram distributions[DISTRIBUTION_COUNT];
+  std::atomic<uint64_t> counters[COUNTER_COUNT];
+
+  explicit ThreadRecord(size_t thread_index) : thread_index(thread_index) {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+      counters[i].store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+// Records of every thread that has recorded something, which are kept after their threads exit
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadRecord>> records;
+};
+
+static Registry & GetRegistry() {
+  // Never destroyed, since threads may still be recording while static objects are torn down
+  static Registry * registry = new Registry();
+  return *registry;
+}
+
+static ThreadRecord & GetThreadRecord() {
+  thread_local ThreadRecord * record = NULL;
+  if (!record) {
+    Registry & registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.records.emplace_back(new ThreadRecord(registry.records.size()));
+    record = registry.records.back().get();
+  }
+  return *record;
+}
+
+Histogram::Histogram() : count(0), sum(0), min(0), max(0) {
+  for (size_t i = 0; i < TRACE_HISTOGRAM_BUCKET_COUNT; i++) {
+    buckets[i] = 0;
+  }
+}
+
+void Histogram::Merge(const Histogram & histogram) {
+  if (histogram.count == 0) {
+    return;
+  }
+  if (count == 0 || histogram.min < min) {
+    min = histogram.min;
+  }
+  if (count == 0 || histogram.max > max) {
+    max = histogram.max;
+  }
+  count += histogram.count;
+  sum += histogram.sum;
+  for (size_t i = 0; i < TRACE_HISTOGRAM_BUCKET_COUNT; i++) {
+    buckets[i] += histogram.buckets[i];
+  }
+}
+
+size_t Histogram::GetBucket(uint64_t value) {
+  // The bucket is the bit length of the value, where the largest values all share the last bucket
+  size_t bucket = 0;
+  while (value > 0 && bucket < TRACE_HISTOGRAM_BUCKET_COUNT - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+ThreadTrace::ThreadTrace() : thread_index(0) {
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    counters[i] = 0;
+  }
+}
+
+double ThreadTrace::GetParseRejectionRate() const {
+  uint64_t candidates = counters[COUNTER_PARSE_ACCEPTED] + counters[COUNTER_PARSE_REJECTED];
+  return candidates == 0 ? 0 : (double) counters[COUNTER_PARSE_REJECTED] / candidates;
+}
+
+void ThreadTrace::Merge(const ThreadTrace & trace) {
+  for (size_t i = 0; i < STAGE_COUNT; i++) {
+    stages[i].Merge(trace.stages[i]);
+  }
+  for (size_t i = 0; i < DISTRIBUTION_COUNT; i++) {
+    distributions[i].Merge(trace.distributions[i]);
+  }
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    counters[i] += trace.counters[i];
+  }
+}
+
+bool trace::IsEnabled() {
+#ifdef RLWE_TRACE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void trace::Record(Stage stage, uint64_t nanoseconds) {
+  GetThreadRecord().stages[stage].Add(nanoseconds);
+}
+
+void trace::Record(Distribution distribution, uint64_t value) {
+  GetThreadRecord().distributions[distribution].Add(value);
+}
+
+void trace::Count(Counter counter, uint64_t amount) {
+  std::atomic<uint64_t> & value = GetThreadRecord().counters[counter];
+  value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+std::vector<ThreadTrace> trace::GetThreadTraces() {
+  Registry & registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<ThreadTrace> traces(registry.records.size());
+  for (size_t t = 0; t < registry.records.size(); t++) {
+    const ThreadRecord & record = *registry.records[t];
+    traces[t].thread_index = record.thread_index;
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+      record.stages[i].Load(traces[t].stages[i]);
+    }
+    for (size_t i = 0; i < DISTRIBUTION_COUNT; i++) {
+      record.distributions[i].Load(traces[t].distributions[i]);
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+      traces[t].counters[i] = record.counters[i].load(std::memory_order_relaxed);
+    }
+  }
+  return traces;
+}
+
+ThreadTrace trace::GetTotal() {
+  ThreadTrace total;
+  for (const ThreadTrace & trace : GetThreadTraces()) {
+    total.Merge(trace);
+  }
+  return total;
+}
+
+void trace::Reset() {
+  // Events that other threads record while the reset is underway may survive it
+  Registry & registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (std::unique_ptr<ThreadRecord> & record : registry.records) {
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+      record->stages[i].Clear();
+    }
+    for (size_t i = 0; i < DISTRIBUTION_COUNT; i++) {
+      record->distributions[i].Clear();
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+      record->counters[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+const char * trace::GetName(Stage stage) {
+  static const char * names[STAGE_COUNT] = {
+    "sample", "ring_multiply", "transform", "round", "hash", "shake", "convert"
+  };
+  return names[stage];
+}
+
+const char * trace::GetName(Distribution distribution) {
+  static const char * names[DISTRIBUTION_COUNT] = {
+    "sign_attempts", "speculative_sign_rounds"
+  };
+  return names[distribution];
+}
+
+const char * trace::GetName(Counter counter) {
+  static const char * names[COUNTER_COUNT] = {
+    "sign_rejected_z", "sign_rejected_w", "parse_accepted", "parse_rejected"
+  };
+  return names[counter];
+}
+
+// Writes a histogram as a JSON object, listing only its non-empty buckets by their lower bounds
+static void WriteHistogram(std::ostream & stream, const Histogram & histogram) {
+  stream << "{\"count\": " << histogram.count <<
+    ", \"sum\": " << histogram.sum <<
+    ", \"min\": " << histogram.min <<
+    ", \"max\": " << histogram.max <<
+    ", \"mean\": " << histogram.GetMean() <<
+    ", \"buckets\": [";
+  bool first = true;
+  for (size_t i = 0; i < TRACE_HISTOGRAM_BUCKET_COUNT; i++) {
+    if (histogram.buckets[i] == 0) {
+      continue;
+    }
+    uint64_t lower = i == 0 ? 0 : (uint64_t) 1 << (i - 1);
+    stream << (first ? "" : ", ") << "{\"lower\": " << lower << ", \"count\": " << histogram.buckets[i] << "}";
+    first = false;
+  }
+  stream << "]}";
+}
+
+static void WriteTrace(std::ostream & stream, const ThreadTrace & trace, const char * indent) {
+  stream << indent << "\"stages\": {" << std::endl;
+  for (size_t i = 0; i < STAGE_COUNT; i++) {
+    stream << indent << "  \"" << GetName((Stage) i) << "\": ";
+    WriteHistogram(stream, trace.stages[i]);
+    stream << (i + 1 < STAGE_COUNT ? "," : "") << std::endl;
+  }
+  stream << indent << "}," << std::endl;
+  stream << indent << "\"distributions\": {" << std::endl;
+  for (size_t i = 0; i < DISTRIBUTION_COUNT; i++) {
+    stream << indent << "  \"" << GetName((Distribution) i) << "\": ";
+    WriteHistogram(stream, trace.distributions[i]);
+    stream << (i + 1 < DISTRIBUTION_COUNT ? "," : "") << std::endl;
+  }
+  stream << indent << "}," << std::endl;
+  stream << indent << "\"counters\": {";
+  for (size_t i = 0; i < COUNTER_COUNT; i++) {
+    stream << (i == 0 ? "" : ", ") << "\"" << GetName((Counter) i) << "\": " << trace.counters[i];
+  }
+  stream << "}," << std::endl;
+  stream << indent << "\"parse_rejection_rate\": " << trace.GetParseRejectionRate() << std::endl;
+}
+
+void trace::WriteJSON(std::ostream & stream) {
+  // Stage times are in nanoseconds
+  std::vector<ThreadTrace> traces = GetThreadTraces();
+  ThreadTrace total;
+  for (const ThreadTrace & trace : traces) {
+    total.Merge(trace);
+  }
+
+  stream << "{" << std::endl;
+  stream << "  \"enabled\": " << (IsEnabled() ? "true" : "false") << "," << std::endl;
+  stream << "  \"threads\": [" << std::endl;
+  for (size_t t = 0; t < traces.size(); t++) {
+    stream << "    {" << std::endl;
+    stream << "      \"thread\": " << traces[t].thread_index << "," << std::endl;
+    WriteTrace(stream, traces[t], "      ");
+    stream << "    }" << (t + 1 < traces.size() ? "," : "") << std::endl;
+  }
+  stream << "  ]," << std::endl;
+  stream << "  \"total\": {" << std::endl;
+  WriteTrace(stream, total, "    ");
+  stream << "  }" << std::endl;
+  stream << "}" << std::endl;
+}
@@ -0,0 +1,134 @@
+#include "allocation.h"
+
+#include <atomic>
+#include <new>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#ifdef RLWE_ALLOCATION_AUDIT
+
+#if defined(__SANITIZE_ADDRESS__)
+#error "RLWE_ALLOCATION_AUDIT replaces malloc, so it cannot be combined with AddressSanitizer"
+#endif
+
+// glibc's own allocator, which the hooks below forward to
+extern "C" {
+  void * __libc_malloc(size_t size);
+  void * __libc_calloc(size_t count, size_t size);
+  void * __libc_realloc(void * ptr, size_t size);
+  void * __libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void * ptr);
+}
+
+static std::atomic<bool> auditing(false);
+static std::atomic<size_t> allocations(0);
+
+static inline void Note() {
+  if (auditing.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Every allocation in the process, including those made by NTL, GMP and the C++ runtime, goes through these
+extern "C" {
+  void * malloc(size_t size) {
+    Note();
+    return __libc_malloc(size);
+  }
+
+  void * calloc(size_t count, size_t size) {
+    Note();
+    return __libc_calloc(count, size);
+  }
+
+  void * realloc(void * ptr, size_t size) {
+    Note();
+    return __libc_realloc(ptr, size);
+  }
+
+  void * memalign(size_t alignment, size_t size) {
+    Note();
+    return __libc_memalign(alignment, size);
+  }
+
+  void * aligned_alloc(size_t alignment, size_t size) {
+    Note();
+    return __libc_memalign(alignment, size);
+  }
+
+  int posix_memalign(void ** ptr, size_t alignment, size_t size) {
+    Note();
+    void * result = __libc_memalign(alignment, size);
+    if (!result) {
+      return ENOMEM;
+    }
+    *ptr = result;
+    return 0;
+  }
+
+  void free(void * ptr) {
+    __libc_free(ptr);
+  }
+}
+
+// The runtime's operator new would reach malloc anyway, but replacing it keeps the count independent of how it is built
+void * operator new(size_t size) {
+  void * ptr = malloc(size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void * operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void * ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept {
+  free(ptr);
+}
+
+bool rlwe::test::IsAuditingAllocations() {
+  return true;
+}
+
+size_t rlwe::test::CountSteadyStateAllocations(const std::function<void()> & body) {
+  for (size_t i = 0; i < ALLOCATION_AUDIT_WARMUP_COUNT; i++) {
+    body();
+  }
+
+  allocations.store(0, std::memory_order_relaxed);
+  auditing.store(true, std::memory_order_seq_cst);
+  body();
+  auditing.store(false, std::memory_order_seq_cst);
+  return allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool rlwe::test::IsAuditingAllocations() {
+  return false;
+}
+
+size_t rlwe::test::CountSteadyStateAllocations(const std::function<void()> & body) {
+  // The body still runs, so that the hot paths are at least exercised the same way
+  for (size_t i = 0; i <= ALLOCATION_AUDIT_WARMUP_COUNT; i++) {
+    body();
+  }
+  return 0;
+}
+
+#endif
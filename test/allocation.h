@@ -0,0 +1,23 @@
+#ifndef RLWE_TEST_ALLOCATION_H
+#define RLWE_TEST_ALLOCATION_H
+
+#include <functional>
+
+#include <stddef.h>
+
+// Calls made before the audited one, which are free to allocate whatever scratch space they keep for later calls
+#define ALLOCATION_AUDIT_WARMUP_COUNT 2
+
+namespace rlwe {
+  namespace test {
+    /* Whether the test suite was built with RLWE_ALLOCATION_AUDIT, which hooks malloc and operator new */
+    /* Without it, nothing is counted and every call below is said to allocate nothing */
+    bool IsAuditingAllocations();
+
+    /* Warms up by calling the body ALLOCATION_AUDIT_WARMUP_COUNT times, then calls it once more and returns */
+    /* how many heap allocations (on any thread) that last call made; the body should do the same work each time */
+    size_t CountSteadyStateAllocations(const std::function<void()> & body);
+  }
+}
+
+#endif
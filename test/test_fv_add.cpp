@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "fv.h" 
 #include "sample.h"
+#include "allocation.h"
 
 #include <NTL/ZZ_pX.h>
 
@@ -40,3 +41,75 @@ TEST_CASE("Homomorphic addition") {
   REQUIRE(ptx.GetMessage() == m);
 }
 
+
+TEST_CASE("Homomorphic addition allocates nothing once warmed up") {
+  KeyParameters params;
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+
+  Plaintext ptx(params);
+  ptx.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Ciphertext ctx1 = Encrypt(ptx, pub);
+  Ciphertext ctx2 = Encrypt(ptx, pub);
+
+  // The sum is reset to the first operand before every call, so that each call does the same work
+  Ciphertext sum(ctx1);
+  Ciphertext ternary(params);
+  size_t allocations = test::CountSteadyStateAllocations([&]() {
+    sum = ctx1;
+    sum += ctx2;
+    Add(ternary, ctx1, ctx2);
+  });
+
+  REQUIRE(sum == ctx1 + ctx2);
+  REQUIRE(ternary == sum);
+  REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Ternary & chained homomorphic addition") {
+  KeyParameters params;
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+
+  Plaintext ptx1(params);
+  ptx1.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Plaintext ptx2(params);
+  ptx2.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Ciphertext ctx1 = Encrypt(ptx1, pub);
+  Ciphertext ctx2 = Encrypt(ptx2, pub);
+  Ciphertext expected = ctx1 + ctx2;
+
+  // The output may be a fresh ciphertext or either operand
+  Ciphertext out(params);
+  Add(out, ctx1, ctx2);
+  REQUIRE(out == expected);
+  Ciphertext left(ctx1);
+  Add(left, left, ctx2);
+  REQUIRE(left == expected);
+  Ciphertext right(ctx2);
+  Add(right, ctx1, right);
+  REQUIRE(right == expected);
+
+  // Temporaries on either side are added into in place, giving the same result
+  REQUIRE(Ciphertext(ctx1) + ctx2 == expected);
+  REQUIRE(ctx1 + Ciphertext(ctx2) == expected);
+  REQUIRE(Ciphertext(ctx1) + Ciphertext(ctx2) == expected);
+
+  // Chained sums decrypt to the sum of every message
+  Ciphertext chained = ctx1 + ctx2 + ctx1 + -ctx2;
+  ZZ_pPush push;
+  ZZ_p::init(params.GetPlainModulus());
+  ZZ_pX m_p = conv<ZZ_pX>(ptx1.GetMessage()) + conv<ZZ_pX>(ptx1.GetMessage());
+  REQUIRE(Decrypt(chained, priv).GetMessage() == conv<ZZX>(m_p));
+
+  // Ciphertexts can be assigned and moved, taking over the other's parameters
+  KeyParameters other_params(16, 1337, 7);
+  Ciphertext assigned(other_params);
+  assigned = expected;
+  REQUIRE(assigned == expected);
+  REQUIRE(assigned.GetParameters() == params);
+  Ciphertext moved(std::move(assigned));
+  REQUIRE(moved == expected);
+  assigned = std::move(moved);
+  REQUIRE(assigned == expected);
+}
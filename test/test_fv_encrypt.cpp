@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "fv.h"
 #include "sample.h"
+#include "allocation.h"
 
 using namespace rlwe;
 using namespace rlwe::fv;
@@ -37,3 +38,51 @@ TEST_CASE("Encryption & decryption using large parameters") {
   KeyParameters params(4096, ZZ(9214347247561474048ULL), ZZ(290764801ULL));
   test_encryption(params);
 }
+
+TEST_CASE("Batch encryption & decryption") {
+  KeyParameters params;
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+
+  // Generate a batch of random plaintexts
+  std::vector<Plaintext> ptxs;
+  for (size_t i = 0; i < 64; i++) {
+    Plaintext ptx(params);
+    ptx.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+    ptxs.push_back(ptx);
+  }
+
+  // Encrypt all of them at once and then decrypt them one by one
+  std::vector<Ciphertext> ctxs = EncryptBatch(ptxs, pub);
+  REQUIRE(ctxs.size() == ptxs.size());
+  for (size_t i = 0; i < ptxs.size(); i++) {
+    REQUIRE(ptxs[i] == Decrypt(ctxs[i], priv));
+  }
+}
+
+void test_encryption_allocations(const KeyParameters & params) {
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+
+  Plaintext ptx(params);
+  ptx.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+
+  // The ciphertext and plaintext are sized by the first call and reused by every later one
+  Ciphertext ctx(params);
+  Plaintext dptx(params);
+  size_t allocations = test::CountSteadyStateAllocations([&]() {
+    Encrypt(ctx, ptx, pub);
+    Decrypt(dptx, ctx, priv);
+  });
+
+  REQUIRE(ptx == dptx);
+  REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Encryption & decryption allocate nothing once warmed up") {
+  // The small parameters multiply through the RNS base, while the normal ones go through the NTT
+  KeyParameters small(16, 1337, 7);
+  test_encryption_allocations(small);
+  KeyParameters normal;
+  test_encryption_allocations(normal);
+}
@@ -7,6 +7,13 @@ using namespace rlwe::fv;
 
 #include <NTL/ZZ_pX.h>
 
+// Keys are stored in the evaluation domain, so they have to be brought back through the ring to be used as messages
+ZZX KeyToMessage(const Poly<uint64_t> & key, const KeyParameters & params) {
+  ZZX message;
+  params.GetRing().Lift(message, key);
+  return message;
+}
+
 TEST_CASE("Experimental homomorphic key exchange") {
   KeyParameters params;
   KeyParameters leveled_params(params.GetPolyModulusDegree(), ZZ(2305843009213693951ULL), params.GetCoeffModulus());
@@ -14,11 +21,11 @@ TEST_CASE("Experimental homomorphic key exchange") {
   NTL::ZZX a_shared = UniformSample(params.GetPolyModulusDegree(), ZZ(0), params.GetCoeffModulus()); 
 
   // Alice keeps these parameters private
-  NTL::ZZX e_alice = KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows());
+  NTL::ZZX e_alice = params.GetGaussianSampler().Sample(params.GetPolyModulusDegree());
   PrivateKey s_alice = GeneratePrivateKey(params);
   PrivateKey hs_alice = GeneratePrivateKey(leveled_params);
   Plaintext ptx_s_alice(leveled_params);
-  ptx_s_alice.SetMessage(s_alice.GetSecret());
+  ptx_s_alice.SetMessage(KeyToMessage(s_alice.GetSecret(), params));
 
   // Alice publishes these parameters
   PublicKey p_alice = GeneratePublicKey(s_alice, a_shared, e_alice);
@@ -26,11 +33,11 @@ TEST_CASE("Experimental homomorphic key exchange") {
   Ciphertext s_alice_encrypted_alice = Encrypt(ptx_s_alice, hp_alice);
 
   // Bob keeps these parameters private
-  NTL::ZZX e_bob = KnuthYaoSample(params.GetPolyModulusDegree(), params.GetProbabilityMatrix(), params.GetProbabilityMatrixRows());
+  NTL::ZZX e_bob = params.GetGaussianSampler().Sample(params.GetPolyModulusDegree());
   PrivateKey s_bob = GeneratePrivateKey(params);
   PrivateKey hs_bob = GeneratePrivateKey(leveled_params);
   Plaintext ptx_s_bob(leveled_params);
-  ptx_s_bob.SetMessage(s_bob.GetSecret());
+  ptx_s_bob.SetMessage(KeyToMessage(s_bob.GetSecret(), params));
 
   // Bob publishes these parameters
   PublicKey p_bob = GeneratePublicKey(s_bob, a_shared, e_bob);
@@ -39,7 +46,7 @@ TEST_CASE("Experimental homomorphic key exchange") {
 
   // Alice calculates this privately and then publishes the result
   Plaintext ptx_p_bob(leveled_params);
-  ptx_p_bob.SetMessage(p_bob.GetValues().a);
+  ptx_p_bob.SetMessage(KeyToMessage(p_bob.GetValues().a, params));
   Plaintext ptx_e_alice(leveled_params);
   ptx_e_alice.SetMessage(e_alice);
   Ciphertext key_bob_encrypted_bob = 
@@ -48,7 +55,7 @@ TEST_CASE("Experimental homomorphic key exchange") {
 
   // Bob calculates this privately and then publishes the result
   Plaintext ptx_p_alice(leveled_params);
-  ptx_p_alice.SetMessage(p_alice.GetValues().a);
+  ptx_p_alice.SetMessage(KeyToMessage(p_alice.GetValues().a, params));
   Plaintext ptx_e_bob(leveled_params);
   ptx_e_bob.SetMessage(e_bob);
   Ciphertext key_alice_encrypted_alice =
@@ -1,16 +1,14 @@
 #include "catch.hpp"
 #include "fv.h"
 #include "sample.h"
+#include "allocation.h"
 
 #include <NTL/ZZ_pX.h>
 
 using namespace rlwe;
 using namespace rlwe::fv;
 
-TEST_CASE("Homomorphic multiplication") {
-  // Set up parameters
-  KeyParameters params(1024, ZZ(1152921504606830600ULL), ZZ(7));  
-
+void test_multiplication(const KeyParameters & params) {
   // Compute keys
   PrivateKey priv = GeneratePrivateKey(params); 
   PublicKey pub = GeneratePublicKey(priv);
@@ -35,15 +33,29 @@ TEST_CASE("Homomorphic multiplication") {
   ZZ_pPush push;
   ZZ_p::init(params.GetPlainModulus());
   ZZ_pX m_p;
-  MulMod(m_p, conv<ZZ_pX>(ptx1.GetMessage()), conv<ZZ_pX>(ptx2.GetMessage()), params.GetPolyModulus());
+  MulMod(m_p, conv<ZZ_pX>(ptx1.GetMessage()), conv<ZZ_pX>(ptx2.GetMessage()), conv<ZZ_pX>(params.GetPolyModulus()));
   ZZX m = conv<ZZX>(m_p);
 
   REQUIRE(ptx.GetMessage() == m);
 }
 
+TEST_CASE("Homomorphic multiplication") {
+  // The modulus 1073692673 * 1073643521 is a product of NTT-friendly primes, so ciphertexts stay in full-RNS form
+  KeyParameters params(1024, ZZ(1152763181911621633ULL), ZZ(7));
+  REQUIRE(params.GetRing().GetRNSModulus() != NULL);
+  test_multiplication(params);
+}
+
+TEST_CASE("Homomorphic multiplication with an arbitrary modulus") {
+  // An even modulus falls back to Garner's algorithm
+  KeyParameters params(1024, ZZ(1152921504606830600ULL), ZZ(7));
+  REQUIRE(params.GetRing().GetRNSModulus() == NULL);
+  test_multiplication(params);
+}
+
 TEST_CASE("Relinearization version 1") {
   // Set up parameters
-  KeyParameters params(1024, ZZ(1152921504606830600ULL), ZZ(7));  
+  KeyParameters params(1024, ZZ(1152763181911621633ULL), ZZ(7));  
 
   // Compute keys
   PrivateKey priv = GeneratePrivateKey(params);
@@ -75,8 +87,75 @@ TEST_CASE("Relinearization version 1") {
   ZZ_pPush push;
   ZZ_p::init(params.GetPlainModulus());
   ZZ_pX m_p;
-  MulMod(m_p, conv<ZZ_pX>(ptx1.GetMessage()), conv<ZZ_pX>(ptx2.GetMessage()), params.GetPolyModulus());
+  MulMod(m_p, conv<ZZ_pX>(ptx1.GetMessage()), conv<ZZ_pX>(ptx2.GetMessage()), conv<ZZ_pX>(params.GetPolyModulus()));
   ZZX m = conv<ZZX>(m_p);
 
   REQUIRE(ptx.GetMessage() == m);
 }
+
+TEST_CASE("Homomorphic multiplication & relinearization allocate nothing once warmed up") {
+  KeyParameters params(1024, ZZ(1152763181911621633ULL), ZZ(7));
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+  EvaluationKey elk = GenerateEvaluationKey(priv, 2);
+
+  Plaintext ptx(params);
+  ptx.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Ciphertext ctx1 = Encrypt(ptx, pub);
+  Ciphertext ctx2 = Encrypt(ptx, pub);
+
+  // The product grows to three terms and is relinearized back down to two, keeping the third term's storage
+  Ciphertext product(ctx1);
+  Ciphertext ternary(params);
+  size_t allocations = test::CountSteadyStateAllocations([&]() {
+    product = ctx1;
+    product *= ctx2;
+    product.Relinearize(elk);
+    Multiply(ternary, ctx1, ctx2);
+  });
+
+  Ciphertext expected = ctx1 * ctx2;
+  REQUIRE(ternary == expected);
+  expected.Relinearize(elk);
+  REQUIRE(product == expected);
+  REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Ternary & chained homomorphic multiplication") {
+  KeyParameters params(1024, ZZ(1152763181911621633ULL), ZZ(7));
+  PrivateKey priv = GeneratePrivateKey(params);
+  PublicKey pub = GeneratePublicKey(priv);
+
+  Plaintext ptx1(params);
+  ptx1.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Plaintext ptx2(params);
+  ptx2.SetMessage(UniformSample(params.GetPolyModulusDegree(), params.GetPlainModulus()));
+  Ciphertext ctx1 = Encrypt(ptx1, pub);
+  Ciphertext ctx2 = Encrypt(ptx2, pub);
+  Ciphertext expected = ctx1 * ctx2;
+
+  // The output may be a fresh ciphertext or either operand
+  Ciphertext out(params);
+  Multiply(out, ctx1, ctx2);
+  REQUIRE(out == expected);
+  Ciphertext left(ctx1);
+  Multiply(left, left, ctx2);
+  REQUIRE(left == expected);
+  Ciphertext right(ctx2);
+  Multiply(right, ctx1, right);
+  REQUIRE(right == expected);
+
+  // Temporaries on either side are multiplied into in place, giving the same result
+  REQUIRE(Ciphertext(ctx1) * ctx2 == expected);
+  REQUIRE(ctx1 * Ciphertext(ctx2) == expected);
+  REQUIRE(Ciphertext(ctx1) * Ciphertext(ctx2) == expected);
+
+  // A chained expression mixing both operations decrypts to the same expression over the messages
+  Ciphertext chained = ctx1 * ctx2 + ctx1;
+  ZZ_pPush push;
+  ZZ_p::init(params.GetPlainModulus());
+  ZZ_pX m_p;
+  MulMod(m_p, conv<ZZ_pX>(ptx1.GetMessage()), conv<ZZ_pX>(ptx2.GetMessage()), conv<ZZ_pX>(params.GetPolyModulus()));
+  m_p = m_p + conv<ZZ_pX>(ptx1.GetMessage());
+  REQUIRE(Decrypt(chained, priv).GetMessage() == conv<ZZX>(m_p));
+}
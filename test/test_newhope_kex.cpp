@@ -1,5 +1,8 @@
 #include "catch.hpp"
 #include "newhope.h"
+#include "allocation.h"
+
+#include <string.h>
 
 using namespace rlwe;
 using namespace rlwe::newhope;
@@ -28,3 +31,153 @@ TEST_CASE("NewHope-Simple full key exchange") {
     REQUIRE(client.GetSharedKey()[i] == server.GetSharedKey()[i]);
   }
 }
+
+TEST_CASE("NewHope-Simple key exchange over caller-provided buffers") {
+  KeyParameters params;
+
+  // The packet lengths of the default parameters are known at compile time
+  static uint8_t clientbound[ServerPacketLength(DEFAULT_POLY_MODULUS_DEGREE, DEFAULT_COEFF_MODULUS_BIT_LENGTH)];
+  static uint8_t serverbound[ClientPacketLength(DEFAULT_POLY_MODULUS_DEGREE, DEFAULT_COEFF_MODULUS_BIT_LENGTH)];
+  REQUIRE(params.GetServerPacketLength() == sizeof(clientbound));
+  REQUIRE(params.GetClientPacketLength() == sizeof(serverbound));
+
+  Server server = CreateServer(params);
+  Client client = CreateClient(params);
+  REQUIRE(WritePacket(clientbound, server) == sizeof(clientbound));
+  ReadPacket(client, clientbound);
+  REQUIRE(WritePacket(serverbound, client) == sizeof(serverbound));
+
+  // Packets can also borrow the buffers without copying them
+  Packet packet(serverbound, sizeof(serverbound));
+  ReadPacket(server, packet);
+  for (size_t i = 0; i < SHARED_KEY_BYTE_LENGTH; i++) {
+    REQUIRE(client.GetSharedKey()[i] == server.GetSharedKey()[i]);
+  }
+
+  // The buffers hold exactly what the allocating variants produce
+  Packet allocated = CreatePacket(server);
+  REQUIRE(allocated.GetLength() == sizeof(clientbound));
+  REQUIRE(memcmp(allocated.GetBytes(), clientbound, sizeof(clientbound)) == 0);
+}
+
+TEST_CASE("NewHope-Simple key exchanges reuse cached seeds") {
+  KeyParameters params;
+  SeedCache & cache = params.GetSeedCache();
+  REQUIRE(cache.GetCapacity() == 0);
+  cache.SetCapacity(4);
+
+  // Several clients handshake with the same server, whose seed only needs to be expanded by the first of them
+  // The server's own expansion of its fresh seed leaves the cache alone
+  Server server = CreateServer(params);
+  REQUIRE(cache.GetSize() == 0);
+  REQUIRE(cache.GetMissCount() == 0);
+  Packet clientbound_packet = CreatePacket(server);
+  for (size_t t = 0; t < 3; t++) {
+    Client client = CreateClient(params);
+    ReadPacket(client, clientbound_packet);
+    Packet serverbound_packet = CreatePacket(client);
+    ReadPacket(server, serverbound_packet);
+    for (size_t i = 0; i < SHARED_KEY_BYTE_LENGTH; i++) {
+      REQUIRE(client.GetSharedKey()[i] == server.GetSharedKey()[i]);
+    }
+  }
+  REQUIRE(cache.GetSize() == 1);
+  REQUIRE(cache.GetMissCount() == 1);
+  REQUIRE(cache.GetHitCount() == 2);
+
+  // New servers don't evict the seeds that clients are reusing
+  for (size_t t = 0; t < 8; t++) {
+    CreateServer(params);
+  }
+  REQUIRE(cache.GetSize() == 1);
+  REQUIRE(cache.GetMissCount() == 1);
+
+  // A cached polynomial matches a freshly expanded one
+  const RingContext<uint32_t> & ring = params.GetRing();
+  Poly<uint32_t> cached, expanded;
+  ExpandSeed(cached, params, server.GetSeed());
+  Parse(expanded, params.GetPolyModulusDegree(), ring.GetModulus(), server.GetSeed());
+  ring.Reduce(expanded, expanded);
+  ring.ToEvaluationDomain(expanded, expanded);
+  REQUIRE(cached == expanded);
+}
+
+TEST_CASE("Seed cache evicts the least recently used seed") {
+  SeedCache cache(2);
+  uint8_t seeds[3][SEED_BYTE_LENGTH] = {{1}, {2}, {3}};
+  Poly<uint32_t> polys[3];
+  for (size_t i = 0; i < 3; i++) {
+    Parse(polys[i], 16, 12289, seeds[i]);
+  }
+
+  Poly<uint32_t> a;
+  cache.Insert(seeds[0], polys[0]);
+  cache.Insert(seeds[1], polys[1]);
+
+  // Using the first seed makes the second the least recently used
+  REQUIRE(cache.Lookup(a, seeds[0]));
+  REQUIRE(a == polys[0]);
+  cache.Insert(seeds[2], polys[2]);
+  REQUIRE(cache.GetSize() == 2);
+  REQUIRE(!cache.Lookup(a, seeds[1]));
+  REQUIRE(cache.Lookup(a, seeds[0]));
+  REQUIRE(cache.Lookup(a, seeds[2]));
+  REQUIRE(a == polys[2]);
+
+  // Shrinking drops entries, and a capacity of 0 stores nothing
+  cache.SetCapacity(1);
+  REQUIRE(cache.GetSize() == 1);
+  REQUIRE(cache.Lookup(a, seeds[2]));
+  cache.SetCapacity(0);
+  cache.Insert(seeds[1], polys[1]);
+  REQUIRE(cache.GetSize() == 0);
+}
+
+TEST_CASE("NewHope-Simple server answers a batch of clients") {
+  KeyParameters params;
+  Server server = CreateServer(params);
+  Packet clientbound_packet = CreatePacket(server);
+
+  // Every client answers the same server ephemeral
+  const size_t count = 9;
+  std::vector<Client> clients;
+  std::vector<Packet> serverbound_packets;
+  for (size_t t = 0; t < count; t++) {
+    clients.push_back(CreateClient(params));
+    ReadPacket(clients[t], clientbound_packet);
+    serverbound_packets.push_back(CreatePacket(clients[t]));
+  }
+
+  std::vector<SharedKey> shared_keys = ReadPacketBatch(server, serverbound_packets);
+  REQUIRE(shared_keys.size() == count);
+  for (size_t t = 0; t < count; t++) {
+    REQUIRE(memcmp(shared_keys[t].data(), clients[t].GetSharedKey(), SHARED_KEY_BYTE_LENGTH) == 0);
+  }
+
+  // The batch agrees with answering the clients one at a time
+  ReadPacket(server, serverbound_packets[count - 1]);
+  REQUIRE(memcmp(shared_keys[count - 1].data(), server.GetSharedKey(), SHARED_KEY_BYTE_LENGTH) == 0);
+}
+
+TEST_CASE("NewHope-Simple key exchange allocates nothing once warmed up") {
+  KeyParameters params;
+  Server server(params);
+  Client client(params);
+  Packet clientbound(params.GetServerPacketLength());
+  Packet serverbound(params.GetClientPacketLength());
+
+  // Both sides generate fresh keys on every call, writing into the same objects and packets
+  size_t allocations = test::CountSteadyStateAllocations([&]() {
+    Initialize(server);
+    Initialize(client);
+    WritePacket(clientbound, server);
+    ReadPacket(client, clientbound);
+    WritePacket(serverbound, client);
+    ReadPacket(server, serverbound);
+  });
+
+  for (size_t i = 0; i < SHARED_KEY_BYTE_LENGTH; i++) {
+    REQUIRE(client.GetSharedKey()[i] == server.GetSharedKey()[i]);
+  }
+  REQUIRE(allocations == 0);
+}
@@ -1,8 +1,11 @@
 #include "catch.hpp"
 #include "sample.h"
 #include "newhope.h"
+#include "keccak-tiny.h"
+#include "simd.h"
 
 #include <sodium.h>
+#include <string.h>
 
 using namespace rlwe;
 using namespace rlwe::newhope;
@@ -23,6 +26,39 @@ TEST_CASE("Polynomial compression & decompression") {
   REQUIRE(poly == decompressed);
 }
 
+TEST_CASE("Word-at-a-time packing matches bit-by-bit packing") {
+  // Lengths that do and do not fill whole 32-bit words, for every coefficient width
+  const size_t lengths[] = {1, 7, 64, 1024, 1027};
+  for (size_t len : lengths) {
+    for (size_t bits = 1; bits <= 32; bits++) {
+      Poly<uint32_t> poly;
+      UniformSample(poly, len, (uint32_t) 0xFFFFFFFF);
+
+      // Bits are written starting with the LSB of x^0, filling each byte from its MSB down
+      size_t bytes = (len * bits + 7) / 8;
+      uint8_t * expected = (uint8_t *) calloc(bytes, 1);
+      for (size_t j = 0; j < len; j++) {
+        for (size_t k = 0; k < bits; k++) {
+          size_t pos = j * bits + k;
+          expected[pos / 8] |= ((poly[j] >> k) & 1) << (7 - pos % 8);
+        }
+      }
+
+      uint8_t * packed = (uint8_t *) malloc(bytes);
+      REQUIRE(CompressPoly(packed, bits, poly) == bytes);
+      REQUIRE(memcmp(packed, expected, bytes) == 0);
+
+      Poly<uint32_t> unpacked;
+      REQUIRE(DecompressPoly(unpacked, len, packed, bits) == bytes);
+      for (size_t j = 0; j < len; j++) {
+        REQUIRE(unpacked[j] == (uint32_t) (poly[j] & ((1ULL << bits) - 1)));
+      }
+      free(expected);
+      free(packed);
+    }
+  }
+}
+
 TEST_CASE("NHSEncode & NHSDecode functions") {
   KeyParameters params;
 
@@ -76,3 +112,76 @@ TEST_CASE("NHSCompress & NHSDecompress functions") {
   }
   REQUIRE(nearly_equivalent);
 }
+
+TEST_CASE("Incremental SHAKE matches one-shot SHAKE") {
+  uint8_t input[500];
+  randombytes_buf(input, sizeof(input));
+
+  // Output long enough to span several blocks of both rates
+  const size_t outlen = 1000;
+  uint8_t expected128[outlen], expected256[outlen], actual[outlen];
+  shake128(expected128, outlen, input, sizeof(input));
+  shake256(expected256, outlen, input, sizeof(input));
+
+  // Absorb & squeeze in uneven pieces
+  const size_t pieces[] = {0, 1, 135, 168, 196};
+  keccak_state state;
+  shake128_init(&state);
+  for (size_t i = 0, offset = 0; i < 5; offset += pieces[i], i++) {
+    shake_absorb(&state, input + offset, pieces[i]);
+  }
+  shake_squeeze(&state, actual, 1);
+  shake_squeeze(&state, actual + 1, 200);
+  shake_squeezeblocks(&state, actual + 201, 4);
+  shake_squeeze(&state, actual + 201 + 4 * SHAKE128_RATE, outlen - 201 - 4 * SHAKE128_RATE);
+  REQUIRE(memcmp(actual, expected128, outlen) == 0);
+
+  shake256_init(&state);
+  shake_absorb(&state, input, 300);
+  shake_absorb(&state, input + 300, 200);
+  shake_squeeze(&state, actual, 7);
+  shake_squeeze(&state, actual + 7, outlen - 7);
+  REQUIRE(memcmp(actual, expected256, outlen) == 0);
+}
+
+TEST_CASE("Parsing seeds into polynomials") {
+  KeyParameters params;
+  size_t n = params.GetPolyModulusDegree();
+  uint32_t q = params.GetRing().GetModulus();
+
+  const size_t count = 7;
+  uint8_t seeds[count * SEED_BYTE_LENGTH];
+  randombytes_buf(seeds, sizeof(seeds));
+
+  // Reference: accept 16-bit big-endian candidates below 5q from a long enough SHAKE-128 output
+  Poly<uint32_t> expected[count];
+  uint8_t * output = (uint8_t *) malloc(8 * n);
+  for (size_t i = 0; i < count; i++) {
+    shake128(output, 8 * n, seeds + i * SEED_BYTE_LENGTH, SEED_BYTE_LENGTH);
+    expected[i].SetLength(n);
+    for (size_t idx = 0, pos = 0; idx < n; pos += 2) {
+      REQUIRE(pos + 1 < 8 * n);
+      uint32_t coeff = (output[pos] << 8) | output[pos + 1];
+      if (coeff < 5 * q) {
+        expected[i][idx++] = coeff;
+      }
+    }
+
+    Poly<uint32_t> actual;
+    Parse(actual, n, q, seeds + i * SEED_BYTE_LENGTH);
+    REQUIRE(actual == expected[i]);
+  }
+  free(output);
+
+  // The batched version must agree, with and without vector instructions
+  simd::InstructionSet original = simd::GetInstructionSet();
+  for (int set = simd::SCALAR; set <= simd::GetSupportedInstructionSet(); set++) {
+    simd::SetInstructionSet((simd::InstructionSet) set);
+    Poly<uint32_t> actual[count];
+    ParseBatch(actual, seeds, count, n, q);
+    for (size_t i = 0; i < count; i++) {
+      REQUIRE(actual[i] == expected[i]);
+    }
+  }
+  simd::SetInstructionSet(original);
+}
@@ -0,0 +1,88 @@
+#include "catch.hpp"
+#include "ntt.h"
+#include "sample.h"
+
+#include <NTL/ZZ_pX.h>
+
+#include <vector>
+
+using namespace rlwe;
+
+template <typename T>
+void test_ntt_multiplication(size_t n, T q) {
+  REQUIRE(NTT<T>::IsSupported(n, q));
+  NTT<T> ntt(n, q);
+
+  ZZ_pPush push;
+  ZZ_p::init(ZZ(q));
+
+  // Build the cyclotomic polynomial x^n + 1 for comparison against NTL
+  ZZ_pX cyclotomic;
+  SetCoeff(cyclotomic, n, 1);
+  SetCoeff(cyclotomic, 0, 1);
+  ZZ_pXModulus phi;
+  build(phi, cyclotomic);
+
+  // Generate two random polynomials in the ring
+  ZZ_pX a = conv<ZZ_pX>(UniformSample(n, ZZ(q)));
+  ZZ_pX b = conv<ZZ_pX>(UniformSample(n, ZZ(q)));
+
+  // Multiply them using both the NTT and NTL
+  ZZ_pX expected;
+  NTL::MulMod(expected, a, b, phi);
+  std::vector<T> a_words(n, 0);
+  std::vector<T> b_words(n, 0);
+  for (long i = 0; i <= deg(a); i++) {
+    a_words[i] = (T) to_ulong(rep(coeff(a, i)));
+  }
+  for (long i = 0; i <= deg(b); i++) {
+    b_words[i] = (T) to_ulong(rep(coeff(b, i)));
+  }
+  ntt.Multiply(a_words.data(), a_words.data(), b_words.data());
+
+  for (size_t i = 0; i < n; i++) {
+    REQUIRE(a_words[i] == (T) to_ulong(rep(coeff(expected, i))));
+  }
+}
+
+TEST_CASE("NTT multiplication using NewHope parameters") {
+  test_ntt_multiplication<uint32_t>(1024, 12289);
+}
+
+TEST_CASE("NTT multiplication using ring-TESLA parameters") {
+  test_ntt_multiplication<uint32_t>(512, 39960577);
+}
+
+TEST_CASE("NTT multiplication using 64-bit coefficients") {
+  test_ntt_multiplication<uint64_t>(1024, 5767169);
+}
+
+TEST_CASE("Forward & inverse NTT round trip") {
+  NTT<uint32_t> ntt(1024, 12289);
+
+  // Fill a buffer with arbitrary coefficients
+  uint32_t original[1024];
+  uint32_t transformed[1024];
+  for (size_t i = 0; i < 1024; i++) {
+    original[i] = (i * 7919) % 12289;
+    transformed[i] = original[i];
+  }
+
+  // Transforming and then inverting should give back the original coefficients
+  ntt.Forward(transformed);
+  ntt.Inverse(transformed);
+  for (size_t i = 0; i < 1024; i++) {
+    REQUIRE(transformed[i] == original[i]);
+  }
+}
+
+TEST_CASE("Rings without a negacyclic transform") {
+  // 1337 is not prime
+  REQUIRE(!NTT<uint64_t>::IsSupported(16, 1337));
+
+  // 2^61 - 1 is prime, but 2048 does not divide 2^61 - 2
+  REQUIRE(!NTT<uint64_t>::IsSupported(1024, 2305843009213693951ULL));
+
+  // n must be a power of 2
+  REQUIRE(!NTT<uint32_t>::IsSupported(1000, 12289));
+}
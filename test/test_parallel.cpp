@@ -0,0 +1,122 @@
+#include "catch.hpp"
+#include "parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace rlwe;
+
+TEST_CASE("Thread pool covers every loop iteration exactly once") {
+  ThreadPool pool(4);
+  REQUIRE(pool.GetThreadCount() == 4);
+
+  for (size_t count = 0; count < 50; count++) {
+    std::vector<std::atomic<int>> hits(count);
+    for (size_t i = 0; i < count; i++) {
+      hits[i] = 0;
+    }
+
+    pool.ParallelFor(count, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        hits[i]++;
+      }
+    });
+
+    for (size_t i = 0; i < count; i++) {
+      REQUIRE(hits[i] == 1);
+    }
+  }
+}
+
+TEST_CASE("Nested thread pool loops run inline") {
+  ThreadPool pool(4);
+  std::atomic<size_t> total(0);
+
+  pool.ParallelFor(8, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      pool.ParallelFor(8, [&](size_t inner_begin, size_t inner_end) {
+        total += inner_end - inner_begin;
+      });
+    }
+  });
+
+  REQUIRE(total == 64);
+}
+
+TEST_CASE("Thread pool loops with a grain size use small chunks") {
+  ThreadPool pool(3);
+
+  for (size_t grain_size = 1; grain_size < 6; grain_size++) {
+    std::vector<std::atomic<int>> hits(37);
+    for (size_t i = 0; i < hits.size(); i++) {
+      hits[i] = 0;
+    }
+
+    std::atomic<size_t> largest(0);
+    pool.ParallelFor(hits.size(), grain_size, [&](size_t begin, size_t end) {
+      size_t size = end - begin;
+      size_t seen = largest;
+      while (size > seen && !largest.compare_exchange_weak(seen, size)) {}
+      for (size_t i = begin; i < end; i++) {
+        hits[i]++;
+      }
+    });
+
+    REQUIRE(largest <= grain_size);
+    for (size_t i = 0; i < hits.size(); i++) {
+      REQUIRE(hits[i] == 1);
+    }
+  }
+}
+
+TEST_CASE("Thread pool loops from several threads run at the same time") {
+  ThreadPool pool(2);
+
+  // Each loop waits (for a while) until the other one has started, which only happens if neither waits for the other to finish
+  std::atomic<bool> entered[2];
+  std::atomic<bool> overlapped[2];
+  for (size_t k = 0; k < 2; k++) {
+    entered[k] = false;
+    overlapped[k] = false;
+  }
+  auto run = [&](size_t k) {
+    pool.ParallelFor(2, [&](size_t begin, size_t end) {
+      entered[k] = true;
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+      while (!entered[1 - k] && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+      if (entered[1 - k]) {
+        overlapped[k] = true;
+      }
+    });
+  };
+  std::thread first(run, 0);
+  std::thread second(run, 1);
+  first.join();
+  second.join();
+
+  REQUIRE(overlapped[0]);
+  REQUIRE(overlapped[1]);
+}
+
+TEST_CASE("Exceptions in thread pool loops reach the caller") {
+  ThreadPool pool(4);
+
+  // Every chunk still runs, whichever thread the exception was thrown on
+  std::atomic<size_t> total(0);
+  REQUIRE_THROWS_AS(pool.ParallelFor(100, 1, [&](size_t begin, size_t end) {
+    total += end - begin;
+    throw std::runtime_error("chunk failed");
+  }), std::runtime_error);
+  REQUIRE(total == 100);
+
+  // The pool carries on with later loops as usual
+  total = 0;
+  pool.ParallelFor(100, 1, [&](size_t begin, size_t end) {
+    total += end - begin;
+  });
+  REQUIRE(total == 100);
+}
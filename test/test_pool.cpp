@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "pool.h"
+#include "fv.h"
+
+#include <stdint.h>
+
+using namespace rlwe;
+
+TEST_CASE("Pool hands released blocks back out for the same size") {
+  pool::Clear();
+
+  void * block = pool::Allocate(1000);
+  REQUIRE(block != NULL);
+  REQUIRE((uintptr_t) block % POOL_BYTE_ALIGNMENT == 0);
+  pool::Release(block, 1000);
+  REQUIRE(pool::GetFreeBlockCount() == 1);
+
+  // Lengths that round up to the same number of aligned units share blocks, while other lengths don't
+  void * other = pool::Allocate(4000);
+  REQUIRE(other != block);
+  void * same = pool::Allocate(1001);
+  REQUIRE(same == block);
+  REQUIRE(pool::GetFreeBlockCount() == 0);
+
+  pool::Release(same, 1001);
+  pool::Release(other, 4000);
+  pool::Clear();
+  REQUIRE(pool::GetFreeBlockCount() == 0);
+}
+
+TEST_CASE("Pool reserves blocks for ring elements of a given degree") {
+  fv::KeyParameters params;
+  pool::Clear();
+
+  // A ciphertext takes one block per polynomial, and gives them back when it is destroyed
+  pool::Reserve<uint64_t>(params.GetPolyModulusDegree(), 2 * POOL_BLOCK_LIMIT);
+  REQUIRE(pool::GetFreeBlockCount() == 2 * POOL_BLOCK_LIMIT);
+  {
+    fv::Ciphertext ctx(params);
+    ctx.SetLength(2);
+    ctx[0].SetLength(params.GetPolyModulusDegree());
+    ctx[1].SetLength(params.GetPolyModulusDegree());
+    REQUIRE(pool::GetFreeBlockCount() == 2 * POOL_BLOCK_LIMIT - 2);
+  }
+  REQUIRE(pool::GetFreeBlockCount() == 2 * POOL_BLOCK_LIMIT);
+
+  pool::Clear();
+}
+
+TEST_CASE("Pool aligns large blocks to huge pages") {
+  pool::Clear();
+  pool::SetHugePageThreshold(POOL_HUGE_PAGE_BYTE_LENGTH / 2);
+
+  // Blocks under the threshold keep the usual alignment, and both kinds go back into the pool alike
+  void * large = pool::Allocate(POOL_HUGE_PAGE_BYTE_LENGTH);
+  void * small = pool::Allocate(4096);
+  REQUIRE(large != NULL);
+  REQUIRE((uintptr_t) large % POOL_HUGE_PAGE_BYTE_LENGTH == 0);
+  REQUIRE((uintptr_t) small % POOL_BYTE_ALIGNMENT == 0);
+  pool::Release(large, POOL_HUGE_PAGE_BYTE_LENGTH);
+  pool::Release(small, 4096);
+
+  pool::SetHugePageThreshold(0);
+  REQUIRE(pool::GetHugePageThreshold() == 0);
+  pool::Clear();
+}
@@ -0,0 +1,190 @@
+#include "catch.hpp"
+#include "parallel.h"
+#include "ring.h"
+#include "sample.h"
+
+#include <stdexcept>
+
+using namespace rlwe;
+
+template <typename T>
+void test_ring_multiplication(size_t n, const ZZ & q) {
+  RingContext<T> ring(n, q);
+
+  // Generate two random polynomials in the ring
+  ZZX a = UniformSample(n, q);
+  ZZX b = UniformSample(n, q);
+  Poly<T> a_words;
+  Poly<T> b_words;
+  ring.Reduce(a_words, a);
+  ring.Reduce(b_words, b);
+
+  // Multiply them using both the word-based ring and NTL
+  ZZ_pPush push;
+  ZZ_p::init(q);
+  ZZ_pX expected;
+  MulMod(expected, conv<ZZ_pX>(a), conv<ZZ_pX>(b), conv<ZZ_pX>(ring.GetPolyModulus()));
+  Poly<T> actual;
+  ring.Multiply(actual, a_words, b_words);
+
+  REQUIRE(conv<ZZX>(actual) == conv<ZZX>(expected));
+}
+
+TEST_CASE("Word-based ring multiplication with a transform") {
+  test_ring_multiplication<uint32_t>(1024, ZZ(12289));
+  test_ring_multiplication<uint64_t>(1024, ZZ(5767169));
+}
+
+TEST_CASE("Word-based ring multiplication without a transform") {
+  test_ring_multiplication<uint32_t>(16, ZZ(1337));
+  test_ring_multiplication<uint64_t>(64, ZZ(2305843009213693951ULL));
+}
+
+TEST_CASE("Word-based ring multiplication with a full-RNS modulus") {
+  test_ring_multiplication<uint32_t>(16, ZZ(97 * 193));
+  test_ring_multiplication<uint64_t>(1024, ZZ(1152763181911621633ULL));
+
+  // Only moduli that don't factor into NTT-friendly primes fall back to Garner's algorithm
+  RingContext<uint64_t> full(1024, ZZ(1152763181911621633ULL));
+  REQUIRE(full.GetRNSModulus() != NULL);
+  REQUIRE(full.GetRNSBase() == NULL);
+  RingContext<uint64_t> arbitrary(1024, ZZ(1152921504606830600ULL));
+  REQUIRE(arbitrary.GetRNSModulus() == NULL);
+  REQUIRE(arbitrary.GetRNSBase() != NULL);
+}
+
+TEST_CASE("Word-based ring multiplication in the evaluation domain") {
+  size_t n = 1024;
+  ZZ q(12289);
+  RingContext<uint32_t> ring(n, q);
+
+  Poly<uint32_t> a;
+  Poly<uint32_t> b;
+  ring.Reduce(a, UniformSample(n, q));
+  ring.Reduce(b, UniformSample(n, q));
+
+  Poly<uint32_t> expected;
+  ring.Multiply(expected, a, b);
+
+  // A single transformed operand still gives a product in the coefficient domain
+  Poly<uint32_t> a_hat;
+  ring.ToEvaluationDomain(a_hat, a);
+  REQUIRE(a_hat.GetDomain() == EVALUATION_DOMAIN);
+  Poly<uint32_t> mixed;
+  ring.Multiply(mixed, a_hat, b);
+  REQUIRE(mixed == expected);
+
+  // Two transformed operands give a product that stays in the evaluation domain
+  Poly<uint32_t> b_hat;
+  ring.ToEvaluationDomain(b_hat, b);
+  Poly<uint32_t> product;
+  ring.Multiply(product, a_hat, b_hat);
+  REQUIRE(product.GetDomain() == EVALUATION_DOMAIN);
+  ring.ToCoefficientDomain(product, product);
+  REQUIRE(product == expected);
+
+  // Round trip back to the original coefficients
+  ring.ToCoefficientDomain(a_hat, a_hat);
+  REQUIRE(a_hat == a);
+}
+
+TEST_CASE("Word-based ring multiplication by a sparse ternary polynomial") {
+  // The ring-TESLA parameters, along with a ring that has no transform
+  const size_t degrees[] = {512, 64};
+  const long moduli[] = {39960577, 1000003};
+  for (size_t k = 0; k < 2; k++) {
+    size_t n = degrees[k];
+    RingContext<uint32_t> ring(n, ZZ(moduli[k]));
+    uint32_t q = ring.GetModulus();
+
+    // The terms include both ends of the polynomial, so that shifts both do and do not wrap around
+    SparseTernaryPoly c(n);
+    c.AddTerm(0, false);
+    c.AddTerm(n - 1, true);
+    for (uint32_t j = 1; c.GetWeight() < 19; j += 7) {
+      if (!c.Contains(j % n)) {
+        c.AddTerm(j % n, j % 3 == 0);
+      }
+    }
+    Poly<uint32_t> c_dense;
+    c.ToDense(c_dense, q);
+
+    Poly<uint32_t> a, expected, product;
+    UniformSample(a, n, q);
+    ring.Multiply(expected, a, c_dense);
+    ring.Multiply(product, a, c);
+    REQUIRE(product == expected);
+
+    // The result may alias the input
+    ring.Multiply(a, a, c);
+    REQUIRE(a == expected);
+  }
+}
+
+TEST_CASE("Reducing & centering word-based polynomials") {
+  RingContext<uint64_t> ring(4, ZZ(17));
+
+  // 5 - 3x + 20x^3 + 2x^4, where x^4 wraps around to -1
+  ZZX poly;
+  SetCoeff(poly, 0, 5);
+  SetCoeff(poly, 1, -3);
+  SetCoeff(poly, 3, 20);
+  SetCoeff(poly, 4, 2);
+
+  Poly<uint64_t> words;
+  ring.Reduce(words, poly);
+  REQUIRE(words[0] == 3);
+  REQUIRE(words[1] == 14);
+  REQUIRE(words[2] == 0);
+  REQUIRE(words[3] == 3);
+
+  // Centering brings 14 back to -3
+  ZZX centered;
+  ring.Center(centered, words);
+  REQUIRE(coeff(centered, 0) == 3);
+  REQUIRE(coeff(centered, 1) == -3);
+  REQUIRE(coeff(centered, 3) == 3);
+}
+
+template <typename T>
+void test_shared_ring(size_t n, const ZZ & q) {
+  RingContext<T> ring(n, q);
+  ThreadPool pool(4);
+
+  // Compute a set of products serially first
+  size_t count = 16;
+  std::vector<Poly<T>> a(count);
+  std::vector<Poly<T>> b(count);
+  std::vector<Poly<T>> expected(count);
+  for (size_t i = 0; i < count; i++) {
+    ring.Reduce(a[i], UniformSample(n, q));
+    ring.Reduce(b[i], UniformSample(n, q));
+    ring.Multiply(expected[i], a[i], b[i]);
+  }
+
+  // Then recompute them from several threads at once, all using the same context
+  std::vector<Poly<T>> actual(count);
+  pool.ParallelFor(count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      ring.Multiply(actual[i], a[i], b[i]);
+    }
+  });
+
+  for (size_t i = 0; i < count; i++) {
+    REQUIRE(actual[i] == expected[i]);
+  }
+}
+
+TEST_CASE("Sharing a ring context between threads") {
+  test_shared_ring<uint32_t>(1024, ZZ(12289));
+  test_shared_ring<uint64_t>(256, ZZ(2305843009213693951ULL));
+}
+
+TEST_CASE("Ring moduli that don't fit in a word are rejected") {
+  // One bit of each word is kept as headroom
+  REQUIRE_NOTHROW(RingContext<uint64_t>(64, power2_ZZ(63) - 1));
+  REQUIRE_THROWS_AS(RingContext<uint64_t>(64, power2_ZZ(63)), std::invalid_argument);
+  REQUIRE_THROWS_AS(RingContext<uint64_t>(64, power2_ZZ(100) + 1), std::invalid_argument);
+  REQUIRE_THROWS_AS(RingContext<uint32_t>(64, power2_ZZ(31) + 1), std::invalid_argument);
+  REQUIRE_THROWS_AS(RingContext<uint64_t>(64, ZZ(1)), std::invalid_argument);
+}
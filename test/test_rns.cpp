@@ -0,0 +1,123 @@
+#include "catch.hpp"
+#include "ring.h"
+#include "polyutil.h"
+#include "sample.h"
+
+using namespace rlwe;
+
+TEST_CASE("RNS decomposition & reconstruction of centered coefficients") {
+  size_t n = 64;
+  ZZ q = conv<ZZ>("9214347247561474048");
+  RNSBase rns(n, 2 * NumBits(q));
+  REQUIRE(rns.GetLength() == 3);
+
+  uint64_t q_words = to_ulong(q);
+  Poly<uint64_t> poly;
+  UniformSample(poly, n, q_words);
+  poly[0] = 0;
+  poly[1] = q_words - 1;
+  poly[2] = q_words / 2;
+  poly[3] = q_words / 2 + 1;
+
+  uint64_t * residues = (uint64_t *) malloc(rns.GetLength() * n * sizeof(uint64_t));
+  rns.Decompose(residues, poly.GetData(), q_words);
+  Poly<uint64_t> reconstructed(n);
+  rns.Reduce(reconstructed.GetData(), residues, q_words);
+  free(residues);
+
+  REQUIRE(reconstructed == poly);
+}
+
+void test_tensor_scale_round(size_t n, const ZZ & q, uint64_t t) {
+  RingContext<uint64_t> ring(n, q);
+
+  // Generate two random vectors of polynomials in the ring
+  Vec<Poly<uint64_t>> a;
+  Vec<Poly<uint64_t>> b;
+  a.SetLength(2);
+  b.SetLength(3);
+  for (long i = 0; i < a.length(); i++) {
+    ring.Reduce(a[i], UniformSample(n, q));
+  }
+  for (long i = 0; i < b.length(); i++) {
+    ring.Reduce(b[i], UniformSample(n, q));
+  }
+
+  // Compute the reference over the integers using centered representatives
+  ZZX cyclotomic;
+  SetCoeff(cyclotomic, n, 1);
+  SetCoeff(cyclotomic, 0, 1);
+  Vec<ZZX> a_zz;
+  Vec<ZZX> b_zz;
+  a_zz.SetLength(a.length());
+  b_zz.SetLength(b.length());
+  for (long i = 0; i < a.length(); i++) {
+    ring.Center(a_zz[i], a[i]);
+  }
+  for (long i = 0; i < b.length(); i++) {
+    ring.Center(b_zz[i], b[i]);
+  }
+
+  Vec<Poly<uint64_t>> actual;
+  ring.TensorScaleRound(actual, a, b, t);
+  REQUIRE(actual.length() == a.length() + b.length() - 1);
+
+  for (long m = 0; m < actual.length(); m++) {
+    ZZX sum;
+    ZZX buffer;
+    for (long r = 0; r <= m; r++) {
+      long s = m - r;
+      if (r < a.length() && s < b.length()) {
+        MulMod(buffer, a_zz[r], b_zz[s], cyclotomic);
+        sum += buffer;
+      }
+    }
+    RoundPoly(sum, sum, ZZ(t), q, q);
+
+    Poly<uint64_t> expected;
+    ring.Reduce(expected, sum);
+    REQUIRE(actual[m] == expected);
+  }
+}
+
+TEST_CASE("RNS tensor product & downscaling") {
+  test_tensor_scale_round(64, ZZ(40961), 7);
+  test_tensor_scale_round(64, conv<ZZ>("1152921504606830600"), 7);
+  test_tensor_scale_round(64, conv<ZZ>("2305843009213693951"), 40961);
+}
+
+TEST_CASE("Full-RNS tensor product & downscaling") {
+  // The default FV parameters, then 1152763181911621633 = 1073692673 * 1073643521 with a small and a full-word scalar
+  test_tensor_scale_round(1024, ZZ(40961), 7);
+  test_tensor_scale_round(1024, conv<ZZ>("1152763181911621633"), 7);
+  test_tensor_scale_round(64, conv<ZZ>("1152763181911621633"), 18446744073709551557ULL);
+  test_tensor_scale_round(16, ZZ(97 * 193 * 257), 65537);
+}
+
+TEST_CASE("Moduli made up of distinct NTT-friendly primes get a full-RNS representation") {
+  REQUIRE(RNSModulus::IsSupported(1024, 40961, 128));
+  REQUIRE(RNSModulus::IsSupported(1024, 1152763181911621633ULL, 256));
+  REQUIRE(RNSModulus::IsSupported(16, 97 * 193 * 257, 64));
+
+  // Even moduli, repeated primes, primes that are not 1 mod 2n and primes past the NTT's headroom all fall back to Garner
+  REQUIRE(!RNSModulus::IsSupported(1024, 1152921504606830600ULL, 256));
+  REQUIRE(!RNSModulus::IsSupported(16, 97 * 97, 64));
+  REQUIRE(!RNSModulus::IsSupported(64, 2305843009213693951ULL, 256));
+  REQUIRE(!RNSModulus::IsSupported(16, 97 * 193 * 13, 64));
+  REQUIRE(!RNSModulus::IsSupported(1024, 40961, 8 * 64));
+
+  RNSModulus rns(1024, 1152763181911621633ULL, 256);
+  REQUIRE(rns.GetModulusLength() == 2);
+  REQUIRE(rns.GetModulusBase().GetPrime(0) * rns.GetModulusBase().GetPrime(1) == 1152763181911621633ULL);
+  REQUIRE(rns.GetExtendedBase().GetLength() == rns.GetModulusLength() + rns.GetExtensionLength());
+
+  // Composition is the inverse of decomposition
+  Poly<uint64_t> poly;
+  UniformSample(poly, 1024, rns.GetModulus());
+  uint64_t * residues = (uint64_t *) malloc(rns.GetModulusBase().GetLength() * 1024 * sizeof(uint64_t));
+  rns.GetModulusBase().Decompose(residues, poly.GetData(), rns.GetModulus());
+  Poly<uint64_t> composed(1024);
+  rns.Compose(composed.GetData(), residues);
+  free(residues);
+  REQUIRE(composed == poly);
+}
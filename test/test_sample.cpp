@@ -0,0 +1,198 @@
+#include "catch.hpp"
+#include "sample.h"
+
+#include <math.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace rlwe;
+
+// Checks that a sampler's output follows the discrete Gaussian it was built for
+static void CheckGaussianSampler(GaussianSamplerType type, float sigma, size_t samples) {
+  GaussianSampler * sampler = GaussianSampler::Create(type, sigma);
+  REQUIRE(sampler->GetType() == type);
+  size_t bound = sampler->GetBound();
+
+  // Probabilities of each magnitude, where 0 is drawn with either sign
+  double probabilities[bound];
+  double total = 0;
+  for (size_t i = 0; i < bound; i++) {
+    probabilities[i] = exp(-(double) (i * i) / 2 / sigma / sigma);
+    total += i == 0 ? probabilities[i] / 2 : probabilities[i];
+  }
+
+  Poly<uint32_t> poly;
+  uint32_t q = 12289;
+  sampler->Sample(poly, samples, q);
+  REQUIRE(poly.GetLength() == samples);
+
+  long counts[2 * bound - 1] = {0};
+  for (size_t i = 0; i < samples; i++) {
+    long value = poly[i] > q / 2 ? (long) poly[i] - (long) q : (long) poly[i];
+    REQUIRE(labs(value) < (long) bound);
+    counts[value + bound - 1]++;
+  }
+
+  // Each count must be within a few standard deviations of its expectation
+  for (long value = -(long) bound + 1; value < (long) bound; value++) {
+    double p = probabilities[labs(value)] / total / 2;
+    double expected = p * samples;
+    double deviation = sqrt(expected * (1 - p));
+    REQUIRE(fabs(counts[value + bound - 1] - expected) <= 6 * deviation + 1);
+  }
+
+  // The integer version draws from the same sampler
+  ZZX sampled = sampler->Sample(samples);
+  REQUIRE(deg(sampled) < (long) samples);
+  for (long i = 0; i <= deg(sampled); i++) {
+    REQUIRE(abs(coeff(sampled, i)) < bound);
+  }
+
+  delete sampler;
+}
+
+// The lengths are not multiples of the block size
+TEST_CASE("Knuth-Yao samples follow a discrete Gaussian") {
+  CheckGaussianSampler(KNUTH_YAO_SAMPLER, 3.2f, 100003);
+  CheckGaussianSampler(KNUTH_YAO_SAMPLER, 52.0f, 20003);
+}
+
+TEST_CASE("CDT samples follow a discrete Gaussian") {
+  CheckGaussianSampler(CDT_SAMPLER, 3.2f, 100003);
+  CheckGaussianSampler(CDT_SAMPLER, 52.0f, 20003);
+}
+
+TEST_CASE("Binomial samples follow a centered binomial distribution") {
+  // sigma = sqrt(8) gives psi_16, and each larger sigma needs wider words per sample
+  const float sigmas[] = {2.828f, 3.192f, 5.0f};
+  const size_t bit_counts[] = {16, 20, 50};
+  for (size_t t = 0; t < 3; t++) {
+    BinomialSampler sampler(sigmas[t]);
+    size_t k = sampler.GetBitCount();
+    REQUIRE(k == bit_counts[t]);
+    REQUIRE(sampler.GetBound() == k + 1);
+
+    const size_t samples = 100003;
+    int32_t * values = (int32_t *) malloc(samples * sizeof(int32_t));
+    sampler.Sample(values, samples);
+
+    long counts[2 * k + 1] = {0};
+    for (size_t i = 0; i < samples; i++) {
+      REQUIRE(labs(values[i]) <= (long) k);
+      counts[values[i] + k]++;
+    }
+
+    // The difference of two weights is distributed as Binomial(2k, 1/2) - k
+    double p = ldexp(1.0, -2 * (int) k);
+    for (size_t i = 0; i <= 2 * k; i++) {
+      double expected = p * samples;
+      double deviation = sqrt(expected * (1 - p));
+      REQUIRE(fabs(counts[i] - expected) <= 6 * deviation + 1);
+      p = p * (2 * k - i) / (i + 1);
+    }
+    free(values);
+  }
+}
+
+TEST_CASE("Seeded random streams are reproducible") {
+  uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH] = {1, 2, 3};
+  RandomStream stream1(seed);
+  RandomStream stream2(seed);
+
+  // The output does not depend on how it is split into requests
+  const size_t len = 3 * RANDOM_STREAM_BUFFER_BYTE_LENGTH + 100;
+  uint8_t * whole = (uint8_t *) malloc(len);
+  uint8_t * pieces = (uint8_t *) malloc(len);
+  stream1.GetBytes(whole, len);
+  const size_t splits[] = {1, 63, 4095, 2 * RANDOM_STREAM_BUFFER_BYTE_LENGTH + 1, 36};
+  size_t offset = 0;
+  for (size_t split : splits) {
+    stream2.GetBytes(pieces + offset, split);
+    offset += split;
+  }
+  REQUIRE(offset == len);
+  REQUIRE(memcmp(whole, pieces, len) == 0);
+
+  // Reseeding restarts the stream, while a different seed gives a different stream
+  stream1.SetSeed(seed);
+  stream1.GetBytes(pieces, len);
+  REQUIRE(memcmp(whole, pieces, len) == 0);
+  seed[0]++;
+  stream1.SetSeed(seed);
+  stream1.GetBytes(pieces, len);
+  REQUIRE(memcmp(whole, pieces, len) != 0);
+  free(whole);
+  free(pieces);
+
+  // Seeding the calling thread's stream makes the samplers reproducible
+  CDTSampler sampler(3.2f);
+  Poly<uint64_t> a1, a2, e1, e2;
+  RandomStream::GetInstance().SetSeed(seed);
+  UniformSample(a1, 256, (uint64_t) 40961);
+  sampler.Sample(e1, 256, (uint64_t) 40961);
+  RandomStream::GetInstance().SetSeed(seed);
+  UniformSample(a2, 256, (uint64_t) 40961);
+  sampler.Sample(e2, 256, (uint64_t) 40961);
+
+  // Later tests in the same process must not run on a fixed seed
+  RandomStream::GetInstance().Reseed();
+  REQUIRE(a1 == a2);
+  REQUIRE(e1 == e2);
+}
+
+TEST_CASE("Forked processes draw different random streams") {
+  // The parent's stream is set up (and even seeded) before forking, so the child starts with a copy of it
+  uint8_t seed[RANDOM_STREAM_SEED_BYTE_LENGTH] = {0};
+  RandomStream::GetInstance().SetSeed(seed);
+
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+  uint8_t bytes[64];
+  RandomStream::GetInstance().GetBytes(bytes, sizeof(bytes));
+  if (child == 0) {
+    // The child only reports its bytes, and leaves without running any of the parent's teardown
+    ssize_t written = write(fds[1], bytes, sizeof(bytes));
+    _exit(written == (ssize_t) sizeof(bytes) ? 0 : 1);
+  }
+
+  uint8_t child_bytes[64];
+  ssize_t count = read(fds[0], child_bytes, sizeof(child_bytes));
+  int status;
+  waitpid(child, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  RandomStream::GetInstance().Reseed();
+
+  REQUIRE(count == (ssize_t) sizeof(child_bytes));
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  REQUIRE(memcmp(bytes, child_bytes, sizeof(bytes)) != 0);
+}
+
+TEST_CASE("Uniform values from a random stream stay within their bound") {
+  RandomStream stream;
+  const uint64_t bounds[] = {1, 2, 3, 12289, 1ULL << 32, (1ULL << 32) + 1, 0xFFFFFFFFFFFFFFFFULL};
+  for (uint64_t bound : bounds) {
+    for (size_t i = 0; i < 1000; i++) {
+      REQUIRE(stream.Uniform(bound) < bound);
+    }
+  }
+
+  ZZ bound = power_ZZ(2, 130) + 7;
+  ZZ value;
+  for (size_t i = 0; i < 1000; i++) {
+    stream.Uniform(value, bound);
+    REQUIRE(value >= 0);
+    REQUIRE(value < bound);
+  }
+
+  // All of [0, 3) is reached
+  bool seen[3] = {false, false, false};
+  for (size_t i = 0; i < 1000; i++) {
+    seen[stream.Uniform(3)] = true;
+  }
+  REQUIRE((seen[0] && seen[1] && seen[2]));
+}
@@ -0,0 +1,119 @@
+#include "catch.hpp"
+#include "simd.h"
+#include "polyutil.h"
+
+#include <random>
+#include <vector>
+
+using namespace rlwe;
+
+template <typename T>
+static void CheckKernels(std::mt19937_64 & rng) {
+  const size_t lengths[] = {0, 1, 3, 7, 8, 15, 16, 17, 33, 64, 100};
+  const unsigned long shifts[] = {0, 1, 13, 8 * sizeof(T) - 1, 8 * sizeof(T), 8 * sizeof(T) + 5};
+  const T max = (T) -1;
+
+  for (size_t len : lengths) {
+    std::vector<T> values(len);
+    for (size_t i = 0; i < len; i++) {
+      values[i] = (T) rng();
+    }
+    T mask = (T) rng();
+
+    // Compare the active instruction set against the scalar kernels
+    simd::InstructionSet active = simd::GetInstructionSet();
+    std::vector<T> expected(len), actual(len);
+
+    simd::SetInstructionSet(simd::SCALAR);
+    simd::And(expected.data(), values.data(), len, mask);
+    simd::SetInstructionSet(active);
+    simd::And(actual.data(), values.data(), len, mask);
+    REQUIRE(actual == expected);
+
+    for (unsigned long bits : shifts) {
+      simd::SetInstructionSet(simd::SCALAR);
+      simd::RightShift(expected.data(), values.data(), len, bits);
+      simd::SetInstructionSet(active);
+      simd::RightShift(actual.data(), values.data(), len, bits);
+      REQUIRE(actual == expected);
+      for (size_t i = 0; i < len; i++) {
+        REQUIRE(actual[i] == (bits >= 8 * sizeof(T) ? 0 : values[i] >> bits));
+      }
+    }
+
+    // Small values around a modulus, so that both outcomes of the range checks occur
+    T mod = (T) 12289;
+    std::vector<T> small(len);
+    for (size_t i = 0; i < len; i++) {
+      small[i] = (T) (rng() % mod);
+    }
+    T bounds[][2] = {{0, max}, {0, mod}, {100, 12000}, {6000, 6001}, {mod, 0}, {max, max}};
+    for (auto & bound : bounds) {
+      bool in_range = true;
+      for (size_t i = 0; i < len; i++) {
+        in_range = in_range && small[i] >= bound[0] && small[i] <= bound[1];
+      }
+      REQUIRE(simd::IsInRange(small.data(), len, bound[0], bound[1]) == in_range);
+    }
+    T centered[] = {0, 1, 100, 6000, 6143, 6144, 6145, mod};
+    for (T bound : centered) {
+      bool in_range = true;
+      for (size_t i = 0; i < len; i++) {
+        in_range = in_range && (small[i] <= bound || small[i] >= mod - bound);
+      }
+      REQUIRE(simd::IsInCenteredRange(small.data(), len, bound, mod) == in_range);
+    }
+
+    // A single coefficient out of range must be caught wherever it lands
+    if (len > 0) {
+      std::vector<T> zeros(len, 0);
+      zeros[rng() % len] = 5000;
+      REQUIRE(!simd::IsInRange(zeros.data(), len, (T) 0, (T) 4999));
+      REQUIRE(!simd::IsInCenteredRange(zeros.data(), len, (T) 4999, mod));
+      REQUIRE(simd::IsInCenteredRange(zeros.data(), len, (T) 5000, mod));
+    }
+  }
+}
+
+TEST_CASE("Vectorized kernels agree with the scalar kernels") {
+  std::mt19937_64 rng(7);
+  simd::InstructionSet original = simd::GetInstructionSet();
+  REQUIRE(original == simd::GetSupportedInstructionSet());
+
+  for (int set = simd::SCALAR; set <= simd::GetSupportedInstructionSet(); set++) {
+    simd::SetInstructionSet((simd::InstructionSet) set);
+    REQUIRE(simd::GetInstructionSet() == set);
+    CheckKernels<uint32_t>(rng);
+    CheckKernels<uint64_t>(rng);
+  }
+
+  simd::SetInstructionSet(original);
+}
+
+template <typename T>
+static void CheckRounding(std::mt19937_64 & rng, T q, T t) {
+  Poly<T> poly(256);
+  ZZX centered;
+  for (size_t i = 0; i < poly.GetLength(); i++) {
+    // Include the coefficients on either side of q / 2 and at the ends
+    T c = i == 0 ? 0 : i == 1 ? q - 1 : i == 2 ? q / 2 : i == 3 ? q / 2 + 1 : (T) (rng() % q);
+    poly[i] = c;
+    SetCoeff(centered, i, c > q / 2 ? conv<ZZ>(c) - conv<ZZ>(q) : conv<ZZ>(c));
+  }
+
+  Poly<T> actual;
+  RoundPoly(actual, poly, t, q, t);
+  ZZX expected;
+  RoundPoly(expected, centered, conv<ZZ>(t), conv<ZZ>(q), conv<ZZ>(t));
+  for (size_t i = 0; i < poly.GetLength(); i++) {
+    REQUIRE(conv<ZZ>(actual[i]) == coeff(expected, i));
+  }
+}
+
+TEST_CASE("Word-based rounding agrees with the ZZX rounding") {
+  std::mt19937_64 rng(11);
+  CheckRounding<uint32_t>(rng, 1073479681, 256);
+  CheckRounding<uint32_t>(rng, 4294967291u, 4294967279u);
+  CheckRounding<uint64_t>(rng, 9214347247561474048ULL, 290764801);
+  CheckRounding<uint64_t>(rng, 18446744073709551557ULL, 18446744073709551533ULL);
+}
@@ -2,6 +2,9 @@
 #include "tesla.h"
 #include "sample.h"
 
+#include <sstream>
+#include <string.h>
+
 using namespace rlwe;
 using namespace rlwe::tesla;
 
@@ -39,3 +42,85 @@ TEST_CASE("Encoding a hash value into a polynomial") {
   Encode(replicated, hsh, params);
   REQUIRE(output == replicated);
 }
+
+TEST_CASE("Sparse and dense encodings agree") {
+  KeyParameters params;
+  uint32_t q = params.GetRing().GetModulus();
+
+  unsigned char hsh[crypto_hash_sha256_BYTES] = {7, 1, 9};
+  SparseTernaryPoly sparse;
+  Poly<uint32_t> dense;
+  Encode(sparse, hsh, params);
+  Encode(dense, hsh, params);
+  REQUIRE(sparse.GetLength() == params.GetPolyModulusDegree());
+  REQUIRE(sparse.GetWeight() == params.GetEncodingWeight());
+
+  Poly<uint32_t> expanded;
+  sparse.ToDense(expanded, q);
+  REQUIRE(expanded == dense);
+}
+
+TEST_CASE("Hash input formats") {
+  ZZX a1 = UniformSample(DEFAULT_POLY_MODULUS_DEGREE, ZZ(DEFAULT_COEFF_MODULUS));
+  ZZX a2 = UniformSample(DEFAULT_POLY_MODULUS_DEGREE, ZZ(DEFAULT_COEFF_MODULUS));
+  KeyParameters text_params(a1, a2, 
+      DEFAULT_POLY_MODULUS_DEGREE, DEFAULT_ERROR_STANDARD_DEVIATION, 
+      ZZ(DEFAULT_ERROR_BOUND), DEFAULT_ENCODING_WEIGHT, 
+      ZZ(DEFAULT_SIGNATURE_BOUND), ZZ(DEFAULT_SIGNATURE_BOUND_ADJUSTMENT), 
+      DEFAULT_LEAST_SIGNIFICANT_BITS, ZZ(DEFAULT_COEFF_MODULUS), 
+      DEFAULT_GAUSSIAN_SAMPLER, HASH_VERSION_TEXT);
+  KeyParameters binary_params(a1, a2);
+  REQUIRE(binary_params.GetHashVersion() == HASH_VERSION_BINARY);
+  REQUIRE(binary_params.GetHashCoeffByteLength() == 1);
+  REQUIRE(!(text_params == binary_params));
+
+  size_t n = DEFAULT_POLY_MODULUS_DEGREE;
+  uint32_t d = DEFAULT_LEAST_SIGNIFICANT_BITS;
+  Poly<uint32_t> p1, p2;
+  UniformSample(p1, n, (uint32_t) DEFAULT_COEFF_MODULUS);
+  UniformSample(p2, n, (uint32_t) DEFAULT_COEFF_MODULUS);
+  ZZX p1_zz, p2_zz;
+  conv(p1_zz, p1);
+  conv(p2_zz, p2);
+  std::string message = "woweee!";
+
+  // The text format is NTL's printout of the rounded polynomials, followed by the message
+  unsigned char expected[crypto_hash_sha256_BYTES];
+  unsigned char output[crypto_hash_sha256_BYTES];
+  ZZX q1, q2;
+  for (long i = 0; i <= deg(p1_zz); i++) {
+    SetCoeff(q1, i, coeff(p1_zz, i) >> d);
+  }
+  for (long i = 0; i <= deg(p2_zz); i++) {
+    SetCoeff(q2, i, coeff(p2_zz, i) >> d);
+  }
+  std::stringstream ss;
+  ss << q1 << q2 << message;
+  std::string text = ss.str();
+  crypto_hash_sha256(expected, reinterpret_cast<const unsigned char *>(text.c_str()), text.length());
+  Hash(output, p1, p2, message, text_params);
+  REQUIRE(memcmp(output, expected, crypto_hash_sha256_BYTES) == 0);
+  Hash(output, p1_zz, p2_zz, message, text_params);
+  REQUIRE(memcmp(output, expected, crypto_hash_sha256_BYTES) == 0);
+
+  // The binary format is the version, then a byte per rounded coefficient, then the message
+  std::string binary(1, (char) HASH_VERSION_BINARY);
+  for (size_t i = 0; i < n; i++) {
+    binary += (char) (p1[i] >> d);
+  }
+  for (size_t i = 0; i < n; i++) {
+    binary += (char) (p2[i] >> d);
+  }
+  binary += message;
+  crypto_hash_sha256(expected, reinterpret_cast<const unsigned char *>(binary.c_str()), binary.length());
+  Hash(output, p1, p2, message, binary_params);
+  REQUIRE(memcmp(output, expected, crypto_hash_sha256_BYTES) == 0);
+  Hash(output, p1_zz, p2_zz, message, binary_params);
+  REQUIRE(memcmp(output, expected, crypto_hash_sha256_BYTES) == 0);
+
+  // Signatures in the original format still work
+  SigningKey signer = GenerateSigningKey(text_params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+  Signature sig = Sign(message, signer);
+  REQUIRE(Verify(message, sig, verif));
+}
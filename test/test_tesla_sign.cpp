@@ -1,6 +1,10 @@
 #include "catch.hpp"
 #include "tesla.h"
 #include "sample.h"
+#include "allocation.h"
+
+#include <sstream>
+#include <string.h>
 
 using namespace rlwe;
 using namespace rlwe::tesla;
@@ -36,3 +40,146 @@ TEST_CASE("Rejecting a mismatched signature") {
   REQUIRE(!Verify("test", sig2, verif));
 }
 
+
+TEST_CASE("Verifying a batch of signatures under several keys") {
+  KeyParameters params;
+
+  SigningKey signer1 = GenerateSigningKey(params);
+  SigningKey signer2 = GenerateSigningKey(params);
+  VerificationKey verif1 = GenerateVerificationKey(signer1);
+  VerificationKey verif2 = GenerateVerificationKey(signer2);
+
+  // Every third item is checked against the wrong key, and every fifth against the wrong message
+  const size_t count = 11;
+  std::vector<std::string> messages;
+  std::vector<Signature> sigs;
+  std::vector<const VerificationKey *> verifs;
+  bool expected[count];
+  for (size_t i = 0; i < count; i++) {
+    std::string message = "message " + std::to_string(i);
+    sigs.push_back(Sign(message, i % 2 == 0 ? signer1 : signer2));
+    messages.push_back(i % 5 == 4 ? message + "!" : message);
+    bool wrong_key = i % 3 == 2;
+    verifs.push_back((i % 2 == 0) != wrong_key ? &verif1 : &verif2);
+    expected[i] = !wrong_key && i % 5 != 4;
+  }
+
+  bool results[count];
+  VerifyBatch(results, messages.data(), sigs.data(), verifs.data(), count);
+  for (size_t i = 0; i < count; i++) {
+    REQUIRE(results[i] == expected[i]);
+    REQUIRE(results[i] == Verify(messages[i], sigs[i], *verifs[i]));
+  }
+
+  // Under a single key, only the valid signatures by its signer pass
+  std::vector<bool> single = VerifyBatch(messages, sigs, verif1);
+  REQUIRE(single.size() == count);
+  for (size_t i = 0; i < count; i++) {
+    REQUIRE(single[i] == (i % 2 == 0 && i % 5 != 4));
+  }
+}
+
+TEST_CASE("Every honestly signed message verifies") {
+  KeyParameters params;
+
+  // Enough signatures that a rounding flaw rejecting even a small fraction of them would show up
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+  Signature sig(params);
+  size_t failures = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    Sign(sig, "test", signer);
+    if (!Verify("test", sig, verif)) {
+      failures++;
+    }
+  }
+  REQUIRE(failures == 0);
+}
+
+TEST_CASE("Verifying speculatively signed messages") {
+  KeyParameters params;
+
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+
+  const size_t candidate_counts[] = {1, 3, 8};
+  for (size_t candidate_count : candidate_counts) {
+    Signature sig = Sign("test", signer, candidate_count);
+    REQUIRE(Verify("test", sig, verif));
+    REQUIRE(!Verify("different", sig, verif));
+  }
+}
+
+// Stream buffer that serves the start of a message and then fails with an I/O error
+class FailingBuffer : public std::streambuf {
+  private:
+    std::string data;
+  public:
+    FailingBuffer(const std::string & message, size_t len) : data(message, 0, len) {
+      setg(&data[0], &data[0], &data[0] + data.size());
+    }
+  protected:
+    int_type underflow() {
+      throw std::ios_base::failure("read error");
+    }
+};
+
+TEST_CASE("Signing raw bytes and prehashed messages") {
+  KeyParameters params;
+
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+
+  // Raw bytes sign the same way as strings
+  std::string message(100000, 'x');
+  const unsigned char * bytes = reinterpret_cast<const unsigned char *>(message.data());
+  Signature sig = Sign(message, signer);
+  REQUIRE(Verify(bytes, message.size(), sig, verif));
+  Sign(sig, bytes, message.size(), signer);
+  REQUIRE(Verify(message, sig, verif));
+  REQUIRE(!Verify(bytes, message.size() - 1, sig, verif));
+
+  // Streaming the message gives the same digest as hashing it in memory
+  unsigned char digest[PREHASH_BYTE_LENGTH];
+  unsigned char streamed[PREHASH_BYTE_LENGTH];
+  Prehash(digest, bytes, message.size());
+  std::istringstream stream(message);
+  REQUIRE(Prehash(streamed, stream));
+  REQUIRE(memcmp(digest, streamed, PREHASH_BYTE_LENGTH) == 0);
+
+  // A stream that fails partway through is reported, rather than digested as a truncated message
+  FailingBuffer failing(message, message.size() / 2);
+  std::istream failing_stream(&failing);
+  REQUIRE(!Prehash(streamed, failing_stream));
+  REQUIRE(memcmp(digest, streamed, PREHASH_BYTE_LENGTH) != 0);
+
+  Signature prehashed(params);
+  SignPrehashed(prehashed, digest, signer);
+  REQUIRE(VerifyPrehashed(digest, prehashed, verif));
+
+  // Prehashed signatures never pass as signatures of the raw message or of the digest itself, and vice versa
+  REQUIRE(!Verify(message, prehashed, verif));
+  REQUIRE(!Verify(digest, PREHASH_BYTE_LENGTH, prehashed, verif));
+  Sign(sig, digest, PREHASH_BYTE_LENGTH, signer);
+  REQUIRE(!VerifyPrehashed(digest, sig, verif));
+  digest[0] ^= 1;
+  REQUIRE(!VerifyPrehashed(digest, prehashed, verif));
+}
+
+TEST_CASE("Signing & verifying allocate nothing once warmed up") {
+  KeyParameters params;
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+
+  // The number of signing attempts varies from call to call, but none of them should allocate
+  std::string message("test");
+  Signature sig(params);
+  bool valid = false;
+  size_t allocations = test::CountSteadyStateAllocations([&]() {
+    Sign(sig, message, signer);
+    valid = Verify(message, sig, verif);
+  });
+
+  REQUIRE(valid);
+  REQUIRE(allocations == 0);
+}
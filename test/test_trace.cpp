@@ -0,0 +1,65 @@
+#include "catch.hpp"
+#include "tesla.h"
+#include "trace.h"
+
+#include <sstream>
+
+using namespace rlwe;
+using namespace rlwe::tesla;
+
+TEST_CASE("Trace histograms bucket values by bit length") {
+  REQUIRE(trace::Histogram::GetBucket(0) == 0);
+  REQUIRE(trace::Histogram::GetBucket(1) == 1);
+  REQUIRE(trace::Histogram::GetBucket(2) == 2);
+  REQUIRE(trace::Histogram::GetBucket(3) == 2);
+  REQUIRE(trace::Histogram::GetBucket(1024) == 11);
+  REQUIRE(trace::Histogram::GetBucket(UINT64_MAX) == TRACE_HISTOGRAM_BUCKET_COUNT - 1);
+
+  trace::Histogram first, second;
+  first.count = 2;
+  first.sum = 10;
+  first.min = 3;
+  first.max = 7;
+  second.Merge(first);
+  REQUIRE(second.count == 2);
+  REQUIRE(second.min == 3);
+  REQUIRE(second.max == 7);
+  REQUIRE(second.GetMean() == 5);
+}
+
+TEST_CASE("Tracing ring-TESLA signatures") {
+  KeyParameters params;
+  SigningKey signer = GenerateSigningKey(params);
+  VerificationKey verif = GenerateVerificationKey(signer);
+
+  trace::Reset();
+  const size_t count = 5;
+  for (size_t i = 0; i < count; i++) {
+    Signature sig = Sign("Message", signer);
+    REQUIRE(Verify("Message", sig, verif));
+  }
+  trace::ThreadTrace total = trace::GetTotal();
+
+  if (trace::IsEnabled()) {
+    // Every signature needs at least one attempt, and every rejected attempt was rejected for z or w
+    const trace::Histogram & attempts = total.distributions[trace::DISTRIBUTION_SIGN_ATTEMPTS];
+    REQUIRE(attempts.count == count);
+    REQUIRE(attempts.min >= 1);
+    REQUIRE(attempts.sum - count == 
+        total.counters[trace::COUNTER_SIGN_REJECTED_Z] + total.counters[trace::COUNTER_SIGN_REJECTED_W]);
+
+    // Each attempt hashes once, as does each verification
+    REQUIRE(total.stages[trace::STAGE_HASH].count == attempts.sum + count);
+    REQUIRE(total.stages[trace::STAGE_SAMPLE].count >= attempts.sum);
+    REQUIRE(total.stages[trace::STAGE_RING_MULTIPLY].count > 0);
+  }
+  else {
+    REQUIRE(trace::GetThreadTraces().empty());
+    REQUIRE(total.stages[trace::STAGE_HASH].count == 0);
+  }
+
+  std::stringstream json;
+  trace::WriteJSON(json);
+  REQUIRE(json.str().find(trace::IsEnabled() ? "\"enabled\": true" : "\"enabled\": false") != std::string::npos);
+  REQUIRE(json.str().find("\"sign_attempts\"") != std::string::npos);
+}